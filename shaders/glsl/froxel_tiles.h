@@ -0,0 +1,9 @@
+// tiles of the froxel grid that FroxelTileLists bins into, must match FroxelTiles.h
+#define FROXEL_TILES 16u
+#define FROXEL_TILE_COUNT (FROXEL_TILES * FROXEL_TILES * FROXEL_TILES)
+
+uint froxelTile(uvec3 froxel, uvec3 resolution)
+{
+    uvec3 tile = min(froxel * FROXEL_TILES / resolution, uvec3(FROXEL_TILES - 1u));
+    return (tile.z * FROXEL_TILES + tile.y) * FROXEL_TILES + tile.x;
+}
@@ -0,0 +1,27 @@
+// point lights per froxel tile, binned by LightClusters; the limits must match LightClusters.h. Needs
+// froxel_tiles.h, and LIGHT_CLUSTERS_BINDING set to the buffer's binding in set 0
+#define MAX_POINT_LIGHTS 4096
+
+struct PointLight
+{
+    vec3 position;
+    float range;
+    vec3 color;
+    float cutoff;
+    vec3 attenuationFactors; // constant, linear and quadratic in order
+};
+
+layout(std430, set = 0, binding = LIGHT_CLUSTERS_BINDING) readonly buffer LightClusters
+{
+    // first reference and count per tile
+    uvec2 lightTiles[FROXEL_TILE_COUNT];
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    uint lightReferences[];
+};
+
+// quadratic falloff, lowered by the cutoff so it reaches zero at the light's range
+float pointLightAttenuation(PointLight light, float dist)
+{
+    vec3 f = light.attenuationFactors;
+    return max(1.0f / (f.x + f.y * dist + f.z * dist * dist) - light.cutoff, 0.0f);
+}
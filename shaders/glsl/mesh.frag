@@ -39,9 +39,20 @@ layout(set = 0, binding = 4) uniform VolumeGenerationInputs
     float absorptionFactor;
     float height;
     bool noise;
+    float skyBlendRatio;
+    bool splitAlpha;
+    float fogRange;
+    float depthPackExponent;
+    uint interleave;
+    uint interleaveOrder;
 };
 
+layout(set = 0, binding = 5) uniform sampler3D transmittanceVolume;
+
 #include "volumetric_fog_util.h"
+#include "froxel_tiles.h"
+#define LIGHT_CLUSTERS_BINDING 6
+#include "light_clusters.h"
 
 layout(set = 1, binding = 0) uniform sampler2D albedoMap;
 layout(set = 1, binding = 1) uniform sampler2D normalMap;
@@ -66,7 +77,9 @@ layout(location = 0) out vec4 color;
 */
 vec3 fetchNormalFromMap()
 {
-    vec3 tangentNormal = texture(normalMap, vIn.uv).xyz * 2.0 - 1.0;
+    // normal maps are cooked to BC5, which only stores x and y
+    vec2 xy = texture(normalMap, vIn.uv).rg * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(xy, sqrt(max(0.0, 1.0 - dot(xy, xy))));
 
     vec3 N   = normalize(vIn.normal);
     vec3 T  = normalize(vIn.tangent);
@@ -172,17 +185,21 @@ vec3 computeIrradiance(vec3 N, vec3 V, vec3 albedo, vec3 F0, float roughness, fl
 	vec3 radiance = scene.dirLight.color * getShadowValue(shadower.lightPV, L, shadowMap, vec4(vIn.fragWorldPos, 1.0f), N, 0.00025f);
 	Lo += computeCookTorranceReflectance(N, V, L, H, radiance, albedo, F0, roughness, metallic);
 
-	// Point-Light Irradiance
-	for(int i = 0; i < scene.nrPointLights; ++i)
+	// Point-Light Irradiance, from the lights of the froxel tile the fragment is in. Behind the fog range, the last slab of tiles holds the lights
+	// The froxel grid's depth starts at the near plane
+	float gridDepth = max(linearizeDepth(gl_FragCoord.z, scene.zNear, scene.zFar) - scene.zNear, 0.0f);
+	vec3 froxel = vec3(gl_FragCoord.xy / scene.viewport, depthToVolumeZPos(gridDepth)) * vec3(resolution);
+	uvec2 lights = lightTiles[froxelTile(min(uvec3(froxel), resolution - 1u), resolution)];
+	for(uint i = 0u; i < lights.y; ++i)
 	{
-		PointLight P = scene.pointLights[i];
+		PointLight P = pointLights[lightReferences[lights.x + i]];
 		// Per-light radiance
 		vec3 L = (P.position - vIn.fragWorldPos);
 		float dist = length(L);
 		L = normalize(L);
 		vec3 H = normalize(V + L);
 		// Using quadratic attenuation for more control over the lighting distance
-		float attenuation = 1.0f / (P.attenuationFactors[0] + P.attenuationFactors[1] * dist + P.attenuationFactors[2] * dist * dist);
+		float attenuation = pointLightAttenuation(P, dist);
 		// Point Lights have the same radiance regardles of the angle we look at it. This is because their radiant intensity and radiant flux (we model radiant flux as the light color basically) are the same and constant.
 		// So, we can use radiant flux (light color) as the light intensity in the radiance formula. Note that this assumption holds as we assume point lights has no area or volume.
 		vec3 radiance = P.color * attenuation;
@@ -224,7 +241,7 @@ void main()
 
 	// Add Fog (Need to test how to incorporate HDR tonemapping and gamma correction. I think first operate on linear space and finally apply HDR tonemapping and gamma correction alltogether)
     float linearDepth = linearizeDepth(gl_FragCoord.z, scene.zNear, scene.zFar);
-	outColor = applyFog(scatteringVolume, outColor, vec3(gl_FragCoord.xy / scene.viewport, clamp(depthToVolumeZPos(linearDepth), 0.0, 1.0)));
+	outColor = applyFog(scatteringVolume, transmittanceVolume, splitAlpha, outColor, vec3(gl_FragCoord.xy / scene.viewport, clamp(depthToVolumeZPos(linearDepth), 0.0, 1.0)));
 
 	// HDR tonemapping (Reinhardt operator)
 	outColor = outColor / (outColor + vec3(1.0f));
@@ -1,4 +1,7 @@
 #version 460
+#extension GL_GOOGLE_include_directive : enable
+
+#include "vertex_decode.h"
 
 layout(location = 0) in vec3 vertex_position;
 layout(location = 1) in vec2 vertex_uv;
@@ -11,28 +14,29 @@ struct DirLight
     vec3 color;
 };
 
-struct PointLight
-{
-    vec3 position;
-    vec3 color;
-    vec3 attenuationFactors; // constant, linear and quadratic in order
-};
-
-#define MAX_NR_OF_POINT_LIGHTS 16
 layout(set = 0, binding = 0) uniform Scene
 {
     mat4 projectionView;
     vec3 camPos;
     DirLight dirLight;
-    PointLight pointLights[MAX_NR_OF_POINT_LIGHTS];
-    int nrPointLights;
     float ambientFactor;
 } scene;
 
-layout(set = 2, binding = 0) uniform ModelTransforms
+layout(set = 1, binding = 5) uniform MeshDecode
+{
+    VertexDecode decode;
+};
+
+// all instances of the mesh, and the ones visible in this pass; gl_InstanceIndex counts from the draw's firstInstance
+layout(set = 2, binding = 0) readonly buffer InstanceTransforms
+{
+    mat4 models[];
+};
+
+layout(set = 2, binding = 1) readonly buffer VisibleInstances
 {
-    mat4 model;
-} modelTransform;
+    uint instances[];
+};
 
 
 layout(location = 0) out VOut
@@ -45,10 +49,11 @@ layout(location = 0) out VOut
 
 void main()
 {
-    vec4 intermediateWorldPos = modelTransform.model * vec4(vertex_position, 1.0);
-    mat3 normalTransformation = mat3(inverse(transpose(modelTransform.model))); 
-    vOut.normal = normalTransformation * vertex_normal;
-    vOut.tangent = normalTransformation * vertex_tangent;
+    mat4 model = models[instances[gl_InstanceIndex]];
+    vec4 intermediateWorldPos = model * vec4(decodePosition(decode, vertex_position), 1.0);
+    mat3 normalTransformation = mat3(inverse(transpose(model))); 
+    vOut.normal = normalTransformation * decodeDirection(decode, vertex_normal);
+    vOut.tangent = normalTransformation * decodeDirection(decode, vertex_tangent);
     vOut.fragWorldPos = vec3(intermediateWorldPos);
     vOut.uv = vertex_uv;
     gl_Position = scene.projectionView * intermediateWorldPos;
@@ -4,24 +4,14 @@ struct DirLight
     vec3 color;
 };
 
-struct PointLight
-{
-    vec3 position;
-    vec3 color;
-    vec3 attenuationFactors; // constant, linear and quadratic in order
-};
-
-#define MAX_NR_OF_POINT_LIGHTS 16
 struct Scene
 {
     mat4 projectionView;
     mat4 invProjectionView;
     vec3 camPos;
     DirLight dirLight;
-    PointLight pointLights[MAX_NR_OF_POINT_LIGHTS];
     float zNear;
     float zFar;
-    int nrPointLights;
     float ambientFactor;
     vec2 viewport;
 };
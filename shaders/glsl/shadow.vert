@@ -1,4 +1,7 @@
 #version 460
+#extension GL_GOOGLE_include_directive : enable
+
+#include "vertex_decode.h"
 
 layout(location = 0) in vec3 vertex_position;
 
@@ -8,13 +11,23 @@ layout(set = 0, binding = 0) uniform Scene
 } scene;
 
 // TODO: compute mvp on host
-layout(set = 1, binding = 0) uniform ModelTransforms
+layout(set = 1, binding = 0) readonly buffer InstanceTransforms
+{
+    mat4 models[];
+};
+
+layout(set = 1, binding = 1) readonly buffer VisibleInstances
+{
+    uint instances[];
+};
+
+layout(set = 2, binding = 0) uniform MeshDecode
 {
-    mat4 model;
-} modelTransform;
+    VertexDecode decode;
+};
 
 void main()
 {
-    vec4 intermediateWorldPos = modelTransform.model * vec4(vertex_position, 1.0);
+    vec4 intermediateWorldPos = models[instances[gl_InstanceIndex]] * vec4(decodePosition(decode, vertex_position), 1.0);
     gl_Position = scene.projectionView * intermediateWorldPos;
 }
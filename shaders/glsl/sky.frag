@@ -31,8 +31,15 @@ layout(set = 0, binding = 2) uniform VolumeGenerationInputs
     float height;
     bool noise;
     float skyBlendRatio;
+    bool splitAlpha;
+    float fogRange;
+    float depthPackExponent;
+    uint interleave;
+    uint interleaveOrder;
 };
 
+layout(set = 0, binding = 3) uniform sampler3D transmittanceVolume;
+
 #include "volumetric_fog_util.h"
 
 layout(location = 0) in VIn
@@ -51,5 +58,5 @@ void main()
     vec3 upColor = vec3(0.2f, 0.35f, 0.75f);
     vec3 downColor = vec3(0.65f, 0.65f, 0.65f);
     vec3 skyColor = mix(downColor, upColor, vec3(mixAlpha, mixAlpha, mixAlpha));
-    color = vec4(applyFog(scatteringVolume, mix(vec3(0.0), skyColor, vec3(skyBlendRatio)), vec3(gl_FragCoord.xy / scene.viewport, 1.0f)), 1.0f);
+    color = vec4(applyFog(scatteringVolume, transmittanceVolume, splitAlpha, mix(vec3(0.0), skyColor, vec3(skyBlendRatio)), vec3(gl_FragCoord.xy / scene.viewport, 1.0f)), 1.0f);
 }
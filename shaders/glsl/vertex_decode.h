@@ -0,0 +1,24 @@
+// Decoding of the packed vertex format (VertexQuantization.h). For unpacked meshes the decode uniform is the
+// identity, so both formats go through the same path.
+struct VertexDecode {
+    vec3 positionOffset;
+    vec3 positionScale;
+    bool packed;
+};
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+vec3 decodePosition(VertexDecode decode, vec3 position) {
+    return decode.positionOffset + position * decode.positionScale;
+}
+
+// packed directions arrive as two snorm components, z reads as 0
+vec3 decodeDirection(VertexDecode decode, vec3 direction) {
+    return decode.packed ? octahedralDecode(direction.xy) : direction;
+}
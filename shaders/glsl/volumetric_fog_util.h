@@ -22,11 +22,7 @@
     SOFTWARE.
 */
 
-#define FOG_RANGE 300.0 // TODO: Make it parameterizable? If we add ImGui
-#define DEPTH_PACK_EXPONENT 1.8
-#define VOLUME_WIDTH  512.0
-#define VOLUME_HEIGHT 256.0
-#define VOLUME_DEPTH  128.0
+// the froxel grid's fogRange and depthPackExponent come with VolumeGenerationInputs, see FogGrid
 
 #define PI 3.14159265358979323846
 
@@ -56,12 +52,12 @@ vec3 worldPositionFromNdcCoords(vec2 ndcPos, float linearDepth)
 
 float volumeZPosToDepth(float volumePosZ)
 {
-    return pow(abs(volumePosZ), DEPTH_PACK_EXPONENT) * FOG_RANGE;
+    return pow(abs(volumePosZ), depthPackExponent) * fogRange;
 }
 
 float depthToVolumeZPos(float depth)
 {
-    return pow(abs(depth / FOG_RANGE), 1.0f / DEPTH_PACK_EXPONENT);
+    return pow(abs(depth / fogRange), 1.0f / depthPackExponent);
 }
 
 float getPhaseFunction(float cosPhi, float gFactor)
@@ -77,8 +73,12 @@ vec4 getRotatedPhaseFunctionSH(vec3 dir, float g)
     return vec4(1.0f, dir.y, dir.z, dir.x) * vec4(1.0f, g, g, g);
 }
 
-vec3 applyFog(sampler3D scatteringVolume, vec3 color, vec3 screenSpace) {
+// with splitAlpha, the transmittance is in the red channel of transmittanceVolume, otherwise in scatteringVolume's alpha
+vec3 applyFog(sampler3D scatteringVolume, sampler3D transmittanceVolume, bool splitAlpha, vec3 color, vec3 screenSpace) {
 	vec3 uvw = screenSpace;//volumeTextureSpaceFromScreenSpace(screenSpace);
 	vec4 inScatteringTransmittance = texture(scatteringVolume, uvw);
+	if(splitAlpha) {
+		inScatteringTransmittance.a = texture(transmittanceVolume, uvw).r;
+	}
 	return vec3(color * inScatteringTransmittance.a + inScatteringTransmittance.rgb);
 }
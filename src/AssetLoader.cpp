@@ -0,0 +1,151 @@
+#include <filesystem>
+
+#include "tga/tga_utils.hpp"
+
+#include "AssetLoader.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "MappedFile.h"
+
+struct AssetLoader::PendingMesh {
+    Mesh mesh;
+    size_t remaining;
+    MeshCallback onLoaded;
+};
+
+AssetLoader::AssetLoader(tga::Interface &tgai, TextureRegistry &textures) : tgai{&tgai}, textures{&textures} {}
+
+AssetLoader::~AssetLoader() = default;
+
+void AssetLoader::toMainThread(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        mainThreadTasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void AssetLoader::complete(PendingMesh &pending)
+{
+    if(--pending.remaining == 0) {
+        pending.onLoaded(std::move(pending.mesh));
+        --pendingMeshes;
+    }
+}
+
+void AssetLoader::loadMesh(const std::string &objPath, bool recook, MeshCallback onLoaded)
+{
+    auto pending = std::make_shared<PendingMesh>();
+    pending->remaining = 1 + Mesh::TEXTURE_SUFFIXES.size();
+    pending->onLoaded = std::move(onLoaded);
+    ++pendingMeshes;
+
+    pool.submit([this, pending, objPath, recook]() {
+        auto geometry = std::make_shared<CookedMesh>(loadCookedMesh(objPath, recook));
+        toMainThread([this, pending, geometry]() {
+            pending->mesh.verticesArray = std::move(geometry->vertices);
+            pending->mesh.indicesArray = std::move(geometry->indices);
+            pending->mesh.lods = std::move(geometry->lods);
+            complete(*pending);
+        });
+    });
+
+    std::string texturesPath = std::filesystem::path(objPath).replace_extension().string();
+    for(size_t slot = 0; slot < Mesh::TEXTURE_SUFFIXES.size(); ++slot) {
+        std::string path = Mesh::texturePath(texturesPath, slot);
+        if(path.empty()) {
+            loadFlatTexture(pending, slot);
+        } else {
+            loadTexture(pending, slot, path, recook);
+        }
+    }
+}
+
+void AssetLoader::loadFlatTexture(std::shared_ptr<PendingMesh> pending, size_t slot)
+{
+    toMainThread([this, pending, slot]() {
+        const std::array<uint8_t, 4> &texel = Mesh::FLAT_TEXTURES[slot];
+        tga::Format format = slot == 0 ? tga::Format::r8g8b8a8_srgb : tga::Format::r8g8b8a8_unorm;
+        uint64_t key = hashBytes(texel.data(), texel.size(), hashBytes(&format, sizeof(format)));
+        const tga::Texture *texture = textures->acquire(key);
+        if(!texture) {
+            tga::StagingBuffer staging = tgai->createStagingBuffer({ texel.size(), texel.data() });
+            textures->insert(key, tgai->createTexture(tga::TextureInfo{ 1, 1, format, tga::SamplerMode::linear, tga::AddressMode::repeat }.setSrcData(staging)), texel.size());
+            tgai->free(staging);
+            texture = textures->acquire(key);
+        }
+        *pending->mesh.textureSlots()[slot] = *texture;
+        pending->mesh.textureKeys[slot] = key;
+        complete(*pending);
+    });
+}
+
+void AssetLoader::loadTexture(std::shared_ptr<PendingMesh> pending, size_t slot, std::string path, bool recook)
+{
+    auto fail = [this, pending, path]() {
+        printf("Error while loading the texture on path: %s\n", path.c_str());
+        complete(*pending);
+    };
+    // Cooking (or just validating the cache) happens on a worker. Knowing the cooked size lets the main thread
+    // allocate the staging buffer, so the mip chain is read straight into mapped staging memory.
+    pool.submit([this, pending, slot, path, fail, recook]() {
+        auto cooked = std::make_shared<CookedTexture>(cookTexture(path, slot == Mesh::NORMAL_MAP_SLOT, recook));
+        if(!*cooked) {
+            toMainThread(fail);
+            return;
+        }
+        toMainThread([this, pending, slot, fail, cooked]() {
+            uint64_t key = cooked->contentHash;
+            auto receive = [this, pending, slot, fail, key](const tga::Texture *texture) {
+                if(!texture) {
+                    fail();
+                    return;
+                }
+                *pending->mesh.textureSlots()[slot] = *texture;
+                pending->mesh.textureKeys[slot] = key;
+                complete(*pending);
+            };
+            if(const tga::Texture *shared = textures->acquire(key)) {
+                receive(shared);
+                return;
+            }
+            auto &receivers = texturesInFlight[key];
+            receivers.push_back(receive);
+            if(receivers.size() > 1) {
+                return;
+            }
+            tga::StagingBuffer staging = tgai->createStagingBuffer({ cooked->dataSize });
+            void *target = tgai->getMapping(staging);
+            pool.submit([this, cooked, staging, target]() {
+                bool read = readCookedTexture(*cooked, target);
+                toMainThread([this, cooked, staging, read]() {
+                    uint64_t key = cooked->contentHash;
+                    if(read) {
+                        textures->insert(key, tgai->createTexture(cookedTextureInfo(*cooked, staging)), cooked->dataSize);
+                    }
+                    tgai->free(staging);
+                    auto receivers = std::move(texturesInFlight.at(key));
+                    texturesInFlight.erase(key);
+                    for(auto &receive : receivers) {
+                        receive(read ? textures->acquire(key) : nullptr);
+                    }
+                });
+            });
+        });
+    });
+}
+
+void AssetLoader::finish()
+{
+    while(pendingMeshes > 0) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            taskAvailable.wait(lock, [this]() { return !mainThreadTasks.empty(); });
+            task = std::move(mainThreadTasks.front());
+            mainThreadTasks.pop_front();
+        }
+        task();
+    }
+}
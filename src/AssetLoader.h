@@ -0,0 +1,55 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tga/tga.hpp"
+#include "Mesh.h"
+#include "TextureRegistry.h"
+#include "ThreadPool.h"
+
+/*
+ * Loads meshes and their textures concurrently. Worker threads parse geometry and cook or read textures; everything that
+ * touches the tga::Interface (staging buffers, texture creation) is queued back to the thread calling finish(),
+ * which processes uploads in the order items complete. Textures are shared through the registry, an image that is
+ * already registered or in flight is not read again.
+ */
+class AssetLoader {
+public:
+    using MeshCallback = std::function<void(Mesh &&)>;
+
+    AssetLoader(tga::Interface &tgai, TextureRegistry &textures);
+    ~AssetLoader();
+    AssetLoader(const AssetLoader &) = delete;
+    AssetLoader &operator=(const AssetLoader &) = delete;
+
+    /* onLoaded is called from finish() once geometry and all textures are on the GPU */
+    void loadMesh(const std::string &objPath, bool recook, MeshCallback onLoaded);
+    /* runs queued uploads until every requested mesh is complete */
+    void finish();
+
+private:
+    struct PendingMesh;
+
+    void loadTexture(std::shared_ptr<PendingMesh> pending, size_t slot, std::string path, bool recook);
+    /* 1x1 Mesh::FLAT_TEXTURES[slot], shared like any other texture */
+    void loadFlatTexture(std::shared_ptr<PendingMesh> pending, size_t slot);
+    void complete(PendingMesh &pending);
+    void toMainThread(std::function<void()> task);
+
+    tga::Interface *tgai;
+    TextureRegistry *textures;
+    /* receivers of textures that are being read, by content hash; nullptr on failure */
+    std::unordered_map<uint64_t, std::vector<std::function<void(const tga::Texture *)>>> texturesInFlight;
+    size_t pendingMeshes = 0;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::deque<std::function<void()>> mainThreadTasks;
+    // declared last, so workers are joined before the queue they post to goes away
+    ThreadPool pool;
+};
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+
+#include "BenchmarkSummary.h"
+
+TimingStats timingStats(std::vector<double> samples)
+{
+    TimingStats stats;
+    if(samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    // nearest rank
+    auto percentile = [&](double p) { return samples[std::min(samples.size() - 1, static_cast<size_t>(std::ceil(p * samples.size())) - 1)]; };
+    stats.count = samples.size();
+    stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = percentile(0.5);
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    return stats;
+}
+
+namespace {
+
+void writeString(std::ostream &out, const std::string &s)
+{
+    out << '"';
+    for(char c : s) {
+        if(c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+void writeStats(std::ostream &out, const TimingStats &stats)
+{
+    out << "{\"count\": " << stats.count << ", \"mean\": " << stats.mean << ", \"min\": " << stats.min << ", \"max\": " << stats.max
+        << ", \"median\": " << stats.median << ", \"p95\": " << stats.p95 << ", \"p99\": " << stats.p99 << "}";
+}
+
+void writeTimes(std::ostream &out, const std::vector<std::pair<std::string, double>> &times)
+{
+    out << "{";
+    const char *separator = "";
+    for(const auto &[name, ms] : times) {
+        out << separator;
+        writeString(out, name);
+        out << ": " << ms;
+        separator = ", ";
+    }
+    out << "}";
+}
+
+}
+
+bool writeBenchmarkSummary(const std::string &path, const BenchmarkSummary &summary)
+{
+    std::ofstream out{path, std::ios::trunc};
+    if(!out) {
+        return false;
+    }
+    out << "{\n  \"demo\": ";
+    writeString(out, summary.demo);
+    out << ",\n  \"resolution\": [" << summary.resolution[0] << ", " << summary.resolution[1] << "]";
+    out << ",\n  \"fogGrid\": [" << summary.fogGrid[0] << ", " << summary.fogGrid[1] << ", " << summary.fogGrid[2] << "]";
+    out << ",\n  \"fogPrecision\": ";
+    writeString(out, summary.fogPrecision);
+    out << ",\n  \"fogInterleave\": " << summary.fogInterleave;
+    out << ",\n  \"fogInterleaveOrder\": ";
+    writeString(out, summary.fogInterleaveOrder);
+    out << ",\n  \"warmupFrames\": " << summary.warmupFrames;
+    out << ",\n  \"framesInFlight\": " << summary.framesInFlight;
+    out << ",\n  \"frameMs\": ";
+    writeStats(out, summary.frame);
+    out << ",\n  \"gpuFrameMs\": ";
+    writeStats(out, summary.gpu);
+    out << ",\n  \"cpuStageMs\": ";
+    writeTimes(out, summary.cpuStages);
+    out << ",\n  \"passGpuMs\": ";
+    writeTimes(out, summary.passes);
+    out << "\n}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* of a series of timings in milliseconds */
+struct TimingStats {
+    size_t count = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+};
+
+TimingStats timingStats(std::vector<double> samples);
+
+/* result of a headless run, written as JSON for scripts comparing runs */
+struct BenchmarkSummary {
+    std::string demo;
+    std::array<uint32_t, 2> resolution;
+    std::array<uint32_t, 3> fogGrid;
+    std::string fogPrecision;
+    /* froxel subsets lit in turn, see FogInterleave */
+    uint32_t fogInterleave;
+    std::string fogInterleaveOrder;
+    uint32_t warmupFrames;
+    /* 1 if each frame was waited for after submission */
+    uint32_t framesInFlight;
+    /* whole frames on the CPU, submission included; the interval between frames when they overlap the GPU */
+    TimingStats frame;
+    /* the frame's command buffer from when the GPU could start on it to completion, only for frames whose completion
+       was observed */
+    TimingStats gpu;
+    /* mean per measured frame */
+    std::vector<std::pair<std::string, double>> cpuStages;
+    /* mean of one pass recorded alone */
+    std::vector<std::pair<std::string, double>> passes;
+};
+
+/* false if the file could not be written */
+bool writeBenchmarkSummary(const std::string &path, const BenchmarkSummary &summary);
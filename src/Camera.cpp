@@ -51,6 +51,21 @@ const glm::uvec2 Camera::getViewport()
     return viewport;
 }
 
+float Camera::getPitch() const
+{
+    return pitch;
+}
+
+float Camera::getYaw() const
+{
+    return yaw;
+}
+
+float Camera::getRoll() const
+{
+    return roll;
+}
+
 void Camera::setFov(float fov_in)
 {
     fov = fov_in;
@@ -61,6 +76,14 @@ void Camera::setViewport(glm::uvec2 dims)
     viewport = dims;
 }
 
+void Camera::setPose(const glm::vec3& pos_in, float pitch_in, float yaw_in, float roll_in)
+{
+    position = pos_in;
+    pitch = pitch_in;
+    yaw = yaw_in;
+    roll = roll_in;
+}
+
 void Camera::move(const glm::vec3& direction, float deltaTime, float speed)
 {
     position += deltaTime * speed * direction;
@@ -16,9 +16,14 @@ public:
     const glm::vec3 up() const;
     const glm::vec3 front() const; //gaze
     const glm::uvec2 getViewport();
+    float getPitch() const;
+    float getYaw() const;
+    float getRoll() const;
 
     void setFov(float fov_in);
     void setViewport(glm::uvec2 dims);
+    //Places the camera directly, e.g. along a recorded path. Angles in radians
+    void setPose(const glm::vec3& pos_in, float pitch_in, float yaw_in, float roll_in);
 
     //Transformations
     //Translation
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "CameraPath.h"
+#include "MappedFile.h"
+
+namespace {
+
+constexpr char PATH_MAGIC[8] = { 'F', 'O', 'G', 'P', 'A', 'T', 'H', '\0' };
+constexpr uint32_t PATH_VERSION = 1;
+
+struct PathHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t keyCount;
+    uint32_t settingsCount;
+};
+
+/* Settings with fixed size fields, bool and padding do not go to disk as they are */
+struct SettingsRecord {
+    uint32_t key;
+    int32_t demoIdx;
+    float lightDir[3];
+    float lightColor[3];
+    float historyFactor;
+    float density;
+    float constantDensity;
+    float anisotropy;
+    float absorption;
+    float height;
+    uint32_t noise;
+    float skyBlendRatio;
+    float fogRange;
+    float depthExponent;
+};
+
+static_assert(sizeof(CameraPath::Key) == 28, "keys are written as they are");
+
+SettingsRecord toRecord(uint32_t key, const Settings &settings)
+{
+    return { key, settings.demoIdx,
+             { settings.lightDir.x, settings.lightDir.y, settings.lightDir.z },
+             { settings.lightColor.x, settings.lightColor.y, settings.lightColor.z },
+             settings.historyFactor, settings.density, settings.constantDensity, settings.anisotropy, settings.absorption,
+             settings.height, settings.noise ? 1u : 0u, settings.skyBlendRatio, settings.fogRange, settings.depthExponent };
+}
+
+Settings fromRecord(const SettingsRecord &record)
+{
+    return Settings{
+        .demoIdx = record.demoIdx,
+        .lightDir = glm::vec3(record.lightDir[0], record.lightDir[1], record.lightDir[2]),
+        .lightColor = glm::vec3(record.lightColor[0], record.lightColor[1], record.lightColor[2]),
+        .historyFactor = record.historyFactor,
+        .density = record.density,
+        .constantDensity = record.constantDensity,
+        .anisotropy = record.anisotropy,
+        .absorption = record.absorption,
+        .height = record.height,
+        .noise = record.noise != 0,
+        .skyBlendRatio = record.skyBlendRatio,
+        .fogRange = record.fogRange,
+        .depthExponent = record.depthExponent
+    };
+}
+
+constexpr size_t CHANNELS = 6;
+
+void channels(const CameraPath::Key &key, double out[CHANNELS])
+{
+    out[0] = key.position.x;
+    out[1] = key.position.y;
+    out[2] = key.position.z;
+    out[3] = key.pitch;
+    out[4] = key.yaw;
+    out[5] = key.roll;
+}
+
+}
+
+void CameraPath::record(double time, const Camera &camera, const Settings &settings)
+{
+    if(keys.empty()) {
+        startTime = time;
+    }
+    Key key{ static_cast<float>(time - startTime), camera.getPosition(), camera.getPitch(), camera.getYaw(), camera.getRoll() };
+    if(!keys.empty() && key.time <= keys.back().time) {
+        // no time has passed for the stored precision, the later pose wins
+        key.time = keys.back().time;
+        keys.pop_back();
+    }
+    keys.push_back(key);
+    uint32_t index = static_cast<uint32_t>(keys.size() - 1);
+    if(!settingsChanges.empty() && settingsChanges.back().first == index) {
+        settingsChanges.pop_back();
+    }
+    if(settingsChanges.empty() || !(settingsChanges.back().second == settings)) {
+        settingsChanges.emplace_back(index, settings);
+    }
+}
+
+bool CameraPath::save(const std::string &path) const
+{
+    PathHeader header{};
+    std::memcpy(header.magic, PATH_MAGIC, sizeof(PATH_MAGIC));
+    header.version = PATH_VERSION;
+    header.keySize = sizeof(Key);
+    header.keyCount = static_cast<uint32_t>(keys.size());
+    header.settingsCount = static_cast<uint32_t>(settingsChanges.size());
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(keys.data()), keys.size() * sizeof(Key));
+    for(auto &[key, settings] : settingsChanges) {
+        SettingsRecord record = toRecord(key, settings);
+        out.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    }
+    return static_cast<bool>(out);
+}
+
+bool CameraPath::load(const std::string &path, std::string &error)
+{
+    MappedFile file{path};
+    PathHeader header;
+    if(!file || file.size() < sizeof(header)) {
+        error = "cannot read " + path;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if(std::memcmp(header.magic, PATH_MAGIC, sizeof(PATH_MAGIC)) != 0 || header.version != PATH_VERSION || header.keySize != sizeof(Key)) {
+        error = path + " is not a camera path of version " + std::to_string(PATH_VERSION);
+        return false;
+    }
+    if(file.size() != sizeof(header) + size_t(header.keyCount) * sizeof(Key) + size_t(header.settingsCount) * sizeof(SettingsRecord)
+       || header.keyCount == 0 || header.settingsCount == 0) {
+        error = path + " is truncated or empty";
+        return false;
+    }
+    keys.resize(header.keyCount);
+    std::memcpy(keys.data(), file.data() + sizeof(header), keys.size() * sizeof(Key));
+    const uint8_t *records = file.data() + sizeof(header) + keys.size() * sizeof(Key);
+    settingsChanges.clear();
+    for(uint32_t i = 0; i < header.settingsCount; ++i) {
+        SettingsRecord record;
+        std::memcpy(&record, records + i * sizeof(record), sizeof(record));
+        settingsChanges.emplace_back(record.key, fromRecord(record));
+    }
+    // strictly ascending, as record() writes them
+    bool ordered = std::adjacent_find(keys.begin(), keys.end(), [](const Key &a, const Key &b) { return a.time >= b.time; }) == keys.end()
+        && settingsChanges.front().first == 0
+        && std::adjacent_find(settingsChanges.begin(), settingsChanges.end(), [](const auto &a, const auto &b) { return a.first >= b.first; }) == settingsChanges.end()
+        && settingsChanges.back().first < keys.size();
+    if(!ordered) {
+        error = path + " has keys out of order";
+        keys.clear();
+        settingsChanges.clear();
+        return false;
+    }
+    startTime = 0.0;
+    return true;
+}
+
+bool CameraPath::empty() const
+{
+    return keys.empty();
+}
+
+size_t CameraPath::keyCount() const
+{
+    return keys.size();
+}
+
+double CameraPath::duration() const
+{
+    return keys.empty() ? 0.0 : keys.back().time;
+}
+
+uint32_t CameraPath::frameCount(double dt) const
+{
+    return static_cast<uint32_t>(std::floor(duration() / dt)) + 1;
+}
+
+CameraPath::Key CameraPath::sample(double time) const
+{
+    if(time <= keys.front().time) {
+        return keys.front();
+    }
+    if(time >= keys.back().time) {
+        return keys.back();
+    }
+    // keys[i].time <= time < keys[i + 1].time
+    size_t i = std::upper_bound(keys.begin(), keys.end(), time, [](double t, const Key &key) { return t < key.time; }) - keys.begin() - 1;
+    const Key &k0 = keys[i > 0 ? i - 1 : i];
+    const Key &k1 = keys[i];
+    const Key &k2 = keys[i + 1];
+    const Key &k3 = keys[i + 2 < keys.size() ? i + 2 : i + 1];
+    double p0[CHANNELS], p1[CHANNELS], p2[CHANNELS], p3[CHANNELS];
+    channels(k0, p0);
+    channels(k1, p1);
+    channels(k2, p2);
+    channels(k3, p3);
+    // in double, so the rounding to float at the end hides differences in how builds order or fuse the operations
+    double h = double(k2.time) - double(k1.time);
+    double u = (time - k1.time) / h;
+    double u2 = u * u, u3 = u2 * u;
+    double h00 = 2.0 * u3 - 3.0 * u2 + 1.0, h10 = u3 - 2.0 * u2 + u, h01 = -2.0 * u3 + 3.0 * u2, h11 = u3 - u2;
+    double span1 = double(k2.time) - double(k0.time), span2 = double(k3.time) - double(k1.time);
+    double out[CHANNELS];
+    for(size_t c = 0; c < CHANNELS; ++c) {
+        // central differences over the neighbours, one-sided at the ends of the path
+        double m1 = span1 > 0.0 ? (p2[c] - p0[c]) / span1 : 0.0;
+        double m2 = span2 > 0.0 ? (p3[c] - p1[c]) / span2 : 0.0;
+        out[c] = h00 * p1[c] + h10 * h * m1 + h01 * p2[c] + h11 * h * m2;
+    }
+    return { static_cast<float>(time), glm::vec3(out[0], out[1], out[2]), static_cast<float>(out[3]), static_cast<float>(out[4]), static_cast<float>(out[5]) };
+}
+
+const Settings &CameraPath::settings(double time) const
+{
+    size_t key = std::upper_bound(keys.begin(), keys.end(), time, [](double t, const Key &k) { return t < k.time; }) - keys.begin();
+    key = key > 0 ? key - 1 : 0;
+    auto it = std::upper_bound(settingsChanges.begin(), settingsChanges.end(), key, [](size_t k, const auto &change) { return k < change.first; });
+    return std::prev(it)->second;
+}
+
+int CameraPath::maxDemoIdx() const
+{
+    int idx = 0;
+    for(auto &[key, settings] : settingsChanges) {
+        idx = std::max(idx, settings.demoIdx);
+    }
+    return idx;
+}
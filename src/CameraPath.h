@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "Settings.h"
+
+/*
+ * A camera flight recorded frame by frame, with the settings in effect, for replaying the same views in perf and
+ * quality runs. The file stores 28 bytes per frame (time, position, pitch, yaw, roll as floats) and the settings only
+ * when they changed. Playback samples the path at arbitrary times, so it can run at a fixed time step independent of
+ * the frame rate it was recorded at: positions and angles are interpolated with cubic Hermite splines whose tangents
+ * follow the neighbouring keys, settings switch at the key they were changed at.
+ */
+class CameraPath {
+public:
+    struct Key {
+        /* milliseconds since the first key */
+        float time;
+        glm::vec3 position;
+        /* in radians */
+        float pitch;
+        float yaw;
+        float roll;
+    };
+
+    /* appends a frame, time in milliseconds and increasing */
+    void record(double time, const Camera &camera, const Settings &settings);
+    bool save(const std::string &path) const;
+    /* false with error set if the file is missing, truncated or of another version */
+    bool load(const std::string &path, std::string &error);
+
+    bool empty() const;
+    size_t keyCount() const;
+    /* milliseconds from the first to the last key */
+    double duration() const;
+    /* frames a playback at time step dt (milliseconds) takes to reach the end */
+    uint32_t frameCount(double dt) const;
+    /* the pose at time t in milliseconds, clamped to the path */
+    Key sample(double time) const;
+    const Settings &settings(double time) const;
+    /* the highest Settings::demoIdx the path switches to */
+    int maxDemoIdx() const;
+
+private:
+    std::vector<Key> keys;
+    /* index of the first key they apply to, ascending */
+    std::vector<std::pair<uint32_t, Settings>> settingsChanges;
+    double startTime = 0.0;
+};
@@ -0,0 +1,511 @@
+#include <cmath>
+#include <iostream>
+
+#include <glm/gtc/packing.hpp>
+
+#include "CpuFogEngine.h"
+#include "parallel.h"
+#include "simd.h"
+#include "util.h"
+
+using simd::float4;
+using simd::vec3x4;
+
+// must match volumetric_fog_generate.h
+static const glm::vec3 POISSON_SAMPLES[] = {
+    {0.7235649381936251f, 0.3138471669743047f, 0.3201859810948713f},
+    {0.9023263454488455f, 0.1021536974445034f, 0.7728286021842685f},
+    {0.707535577489901f, 0.7793034184152576f, 0.1783810674632729f},
+    {0.6448693804632389f, 0.7572636913351743f, 0.7008060842666394f},
+    {0.5283278004896363f, 0.08963895760397314f, 0.6416003295537631f},
+    {0.1945595074918383f, 0.8768175519738776f, 0.8383091365372217f},
+    {0.3962390299362931f, 0.5889969185665176f, 0.16038235099607745f},
+    {0.42665565633375147f, 0.5199040470573899f, 0.8392925000334579f},
+    {0.016575921662339232f, 0.02782739808605425f, 0.6579822665975691f},
+    {0.9053817004840065f, 0.5071589150137468f, 0.848557535237008f},
+    {0.9719270337852532f, 0.7932234918934737f, 0.46719431136597156f},
+    {0.18561505112152382f, 0.08741559201323862f, 0.24237215202068418f},
+    {0.3361849182100367f, 0.758483593873007f, 0.5263712323764304f},
+    {0.04827339058227498f, 0.5292256549317347f, 0.9465748311306693f},
+    {0.9645553232327962f, 0.01671040541958768f, 0.37611294123403893f},
+    {0.6720574315907052f, 0.12000941884375096f, 0.029772375614268987f},
+    {0.4910912042746283f, 0.9904295677963227f, 0.99393447098164f},
+    {0.021958886572755743f, 0.4193473556770484f, 0.36153393894970104f},
+};
+static constexpr uint32_t SAMPLE_NUM = sizeof(POISSON_SAMPLES) / sizeof(POISSON_SAMPLES[0]);
+
+static uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+static uint32_t hash3(uint32_t x, uint32_t y, uint32_t z)
+{
+    return hash(hash(hash(x) ^ y) ^ z);
+}
+
+// must match volumetric_fog_util.h
+static float volumeZPosToDepth(const CpuFogEngine::Inputs &in, float volumePosZ)
+{
+    return std::pow(std::abs(volumePosZ), in.depthPackExponent) * in.fogRange;
+}
+
+static float depthToVolumeZPos(const CpuFogEngine::Inputs &in, float depth)
+{
+    return std::pow(std::abs(depth / in.fogRange), 1.0f / in.depthPackExponent);
+}
+
+/* column-major mat4 times (p, 1) for four points at once */
+static void transformPoint(const glm::mat4 &m, const vec3x4 &p, float4 out[4])
+{
+    for(int r = 0; r < 4; r++) {
+        out[r] = float4(m[0][r]) * p.x + float4(m[1][r]) * p.y + float4(m[2][r]) * p.z + float4(m[3][r]);
+    }
+}
+
+CpuFogEngine::CpuFogEngine(std::array<uint32_t, 3> resolution, const NoiseVolume &noise) : m_resolution{resolution}, noise{&noise}
+{
+    size_t voxelCount = size_t(resolution[0]) * resolution[1] * resolution[2];
+    lightingVolumes[0].assign(voxelCount, glm::vec4(0.0f));
+    lightingVolumes[1].assign(voxelCount, glm::vec4(0.0f));
+    m_scatteringVolume.assign(voxelCount, glm::vec4(0.0f));
+}
+
+void CpuFogEngine::setShadowMap(std::vector<float> depth, uint32_t width, uint32_t height)
+{
+    shadowMap = std::move(depth);
+    shadowMapWidth = width;
+    shadowMapHeight = height;
+}
+
+void CpuFogEngine::setHistory(std::vector<glm::vec4> history)
+{
+    lightingVolumes[current ^ 1] = std::move(history);
+}
+
+void CpuFogEngine::setPrecision(FogPrecision precision)
+{
+    this->precision = precision;
+}
+
+void CpuFogEngine::setLocalFog(const LocalFogBins *bins)
+{
+    localFog = bins;
+}
+
+void CpuFogEngine::setLights(const LightClusters *lights)
+{
+    this->lights = lights;
+}
+
+void CpuFogEngine::quantize(std::vector<glm::vec4> &volume) const
+{
+    if(precision == FogPrecision::full) {
+        return;
+    }
+    parallelFor(volume.size(), 4096, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            volume[i] = quantizeFogVoxel(volume[i], precision);
+        }
+    });
+}
+
+void CpuFogEngine::generate(const Inputs &inputs, const glm::mat4 &lightPV)
+{
+    current ^= 1;
+    glm::vec4 *out = lightingVolumes[current].data();
+    const glm::vec4 *history = lightingVolumes[current ^ 1].data();
+    uint32_t rows = m_resolution[1] * m_resolution[2];
+    parallelFor(rows, 16, [&](size_t begin, size_t end) {
+        for(size_t row = begin; row < end; row++) {
+            uint32_t y = static_cast<uint32_t>(row % m_resolution[1]);
+            uint32_t z = static_cast<uint32_t>(row / m_resolution[1]);
+            generateRow(inputs, lightPV, y, z, out + row * m_resolution[0], history);
+        }
+    });
+    quantize(lightingVolumes[current]);
+}
+
+void CpuFogEngine::accumulate()
+{
+    const glm::vec4 *in = lightingVolumes[current].data();
+    glm::vec4 *out = m_scatteringVolume.data();
+    parallelFor(m_resolution[1], 4, [&](size_t begin, size_t end) {
+        for(size_t y = begin; y < end; y++) {
+            accumulateRow(static_cast<uint32_t>(y), in, out);
+        }
+    });
+    quantize(m_scatteringVolume);
+}
+
+float CpuFogEngine::shadowValue(glm::vec3 lightspacePosition, float bias) const
+{
+    if(shadowMap.empty() || lightspacePosition.z >= 1.0f) {
+        return 1.0f;
+    }
+    // same footprint as textureGather at a texel corner, with the opaque white border of the shadow map
+    auto texel = [this](int32_t x, int32_t y) {
+        if(x < 0 || y < 0 || x >= static_cast<int32_t>(shadowMapWidth) || y >= static_cast<int32_t>(shadowMapHeight)) {
+            return 1.0f;
+        }
+        return shadowMap[y * shadowMapWidth + x];
+    };
+    float tx = (lightspacePosition.x * 0.5f + 0.5f) * shadowMapWidth;
+    float ty = (lightspacePosition.y * 0.5f + 0.5f) * shadowMapHeight;
+    float fx = std::floor(tx);
+    float fy = std::floor(ty);
+    float fractX = tx - fx;
+    float fractY = ty - fy;
+    int32_t x1 = static_cast<int32_t>(fx);
+    int32_t y1 = static_cast<int32_t>(fy);
+    int32_t x0 = x1 - 1;
+    int32_t y0 = y1 - 1;
+    float reference = lightspacePosition.z - bias;
+    float gx = texel(x0, y1) > reference ? 1.0f : 0.0f;
+    float gy = texel(x1, y1) > reference ? 1.0f : 0.0f;
+    float gz = texel(x1, y0) > reference ? 1.0f : 0.0f;
+    float gw = texel(x0, y0) > reference ? 1.0f : 0.0f;
+    float top = gx + (gy - gx) * fractX;
+    float bottom = gw + (gz - gw) * fractX;
+    return top + (bottom - top) * (1.0f - fractY);
+}
+
+glm::vec4 CpuFogEngine::sampleHistory(const glm::vec4 *history, glm::vec3 uvw) const
+{
+    // trilinear filtering with clampEdge addressing
+    float t[3];
+    int32_t i0[3], i1[3];
+    for(int c = 0; c < 3; c++) {
+        float coord = uvw[c] * m_resolution[c] - 0.5f;
+        float f = std::floor(coord);
+        t[c] = coord - f;
+        int32_t maxIdx = static_cast<int32_t>(m_resolution[c]) - 1;
+        i0[c] = std::clamp(static_cast<int32_t>(f), 0, maxIdx);
+        i1[c] = std::clamp(static_cast<int32_t>(f) + 1, 0, maxIdx);
+    }
+    auto at = [&](int32_t x, int32_t y, int32_t z) {
+        return float4::load(&history[(size_t(z) * m_resolution[1] + y) * m_resolution[0] + x].x);
+    };
+    float4 c00 = simd::mix(at(i0[0], i0[1], i0[2]), at(i1[0], i0[1], i0[2]), t[0]);
+    float4 c10 = simd::mix(at(i0[0], i1[1], i0[2]), at(i1[0], i1[1], i0[2]), t[0]);
+    float4 c01 = simd::mix(at(i0[0], i0[1], i1[2]), at(i1[0], i0[1], i1[2]), t[0]);
+    float4 c11 = simd::mix(at(i0[0], i1[1], i1[2]), at(i1[0], i1[1], i1[2]), t[0]);
+    float4 c = simd::mix(simd::mix(c00, c10, t[1]), simd::mix(c01, c11, t[1]), t[2]);
+    glm::vec4 result;
+    c.store(&result.x);
+    return result;
+}
+
+void CpuFogEngine::generateRow(const Inputs &in, const glm::mat4 &lightPV, uint32_t y, uint32_t z, glm::vec4 *out, const glm::vec4 *history) const
+{
+    const uint32_t width = m_resolution[0];
+    const float4 invRes[3] = { 2.0f / m_resolution[0], 2.0f / m_resolution[1], 1.0f / m_resolution[2] };
+    const bool reprojectionOn = in.historyFactor > 0.0f;
+    const vec3x4 camPos{ in.cameraPos.x, in.cameraPos.y, in.cameraPos.z };
+    const vec3x4 lightDir{ in.dirLight.direction.x, in.dirLight.direction.y, in.dirLight.direction.z };
+
+    auto worldPosition = [&](float4 ndcX, float4 ndcY, float4 linearDepth) {
+        vec3x4 eyeRay{
+            float4(in.cameraXAxis.x) * ndcX + float4(in.cameraYAxis.x) * ndcY + in.cameraZAxis.x,
+            float4(in.cameraXAxis.y) * ndcX + float4(in.cameraYAxis.y) * ndcY + in.cameraZAxis.y,
+            float4(in.cameraXAxis.z) * ndcX + float4(in.cameraYAxis.z) * ndcY + in.cameraZAxis.z,
+        };
+        return camPos + eyeRay * (float4(in.zNear) + linearDepth);
+    };
+
+    auto sampleNoise = [this](vec3x4 p) {
+        // trilinear with repeat addressing, as the GPU samples the r8 noise volume
+        const float size = static_cast<float>(noise->params.size);
+        float4 t[3] = { p.x * float4(size) - 0.5f, p.y * float4(size) - 0.5f, p.z * float4(size) - 0.5f };
+        float4 f[3] = { simd::floor(t[0]), simd::floor(t[1]), simd::floor(t[2]) };
+        float taps[8][4];
+        for(int l = 0; l < 4; l++) {
+            int32_t x0 = static_cast<int32_t>(f[0][l]);
+            int32_t y0 = static_cast<int32_t>(f[1][l]);
+            int32_t z0 = static_cast<int32_t>(f[2][l]);
+            for(int c = 0; c < 8; c++) {
+                taps[c][l] = noise->texel(x0 + (c & 1), y0 + ((c >> 1) & 1), z0 + (c >> 2));
+            }
+        }
+        float4 a[3] = { t[0] - f[0], t[1] - f[1], t[2] - f[2] };
+        float4 z0 = simd::mix(simd::mix(float4::load(taps[0]), float4::load(taps[1]), a[0]), simd::mix(float4::load(taps[2]), float4::load(taps[3]), a[0]), a[1]);
+        float4 z1 = simd::mix(simd::mix(float4::load(taps[4]), float4::load(taps[5]), a[0]), simd::mix(float4::load(taps[6]), float4::load(taps[7]), a[0]), a[1]);
+        return simd::mix(z0, z1, a[2]);
+    };
+
+    // the unjittered depth only depends on the slice
+    float linearDepthNoJitter = volumeZPosToDepth(in, (z + 0.5f) / m_resolution[2]);
+
+    // the four columns of a batch share their 4x4x4 block, i.e. the GPU's workgroup, and with it their turn
+    auto litThisFrame = [&](uint32_t x) {
+        if(in.interleave <= 1) {
+            return true;
+        }
+        uint32_t turn = in.interleaveOrder == static_cast<uint32_t>(FogInterleaveOrder::checkerboard) ? x / 4 + y / 4 + z / 4 : z / 4;
+        return turn % in.interleave == static_cast<uint32_t>(in.frameNumber) % in.interleave;
+    };
+
+    for(uint32_t x = 0; x < width; x += 4) {
+        uint32_t lanes = std::min(4u, width - x);
+        float h[4][4];
+        int historyMask = 0;
+        if(reprojectionOn) {
+            float4 ndcNoJitterX = (float4(static_cast<float>(x), x + 1.0f, x + 2.0f, x + 3.0f) + 0.5f) * invRes[0] - 1.0f;
+            float4 ndcNoJitterY = (float4(static_cast<float>(y)) + 0.5f) * invRes[1] - 1.0f;
+            vec3x4 worldPosNoJitter = worldPosition(ndcNoJitterX, ndcNoJitterY, linearDepthNoJitter);
+            float4 pp[4];
+            transformPoint(in.prevFrameVP, worldPosNoJitter, pp);
+            float4 invW = float4(1.0f) / pp[3];
+            float4 u = pp[0] * invW * 0.5f + 0.5f;
+            float4 v = pp[1] * invW * 0.5f + 0.5f;
+            float4 prevDepth = pp[2] * invW;
+            float4 prevLinearDepth = float4(in.zNear * in.zFar) / (float4(in.zFar) + prevDepth * (in.zNear - in.zFar));
+            float4 inRange = (u >= 0.0f) & (u <= 1.0f) & (v >= 0.0f) & (v <= 1.0f);
+            int mask = simd::movemask(inRange);
+            for(uint32_t l = 0; l < 4 && mask; l++) {
+                float w = depthToVolumeZPos(in, prevLinearDepth[l]);
+                if(!(mask & (1 << l)) || w < 0.0f || w > 1.0f) {
+                    continue;
+                }
+                glm::vec4 fogPrevFrame = sampleHistory(history, glm::vec3(u[l], v[l], w));
+                for(int c = 0; c < 4; c++) {
+                    h[c][l] = fogPrevFrame[c];
+                }
+                historyMask |= 1 << l;
+            }
+        }
+        const int allLanes = (1 << lanes) - 1;
+        const bool lit = litThisFrame(x);
+        // waiting for their turn, froxels carry their history over; those that came into view have none to carry
+        if(!lit && (historyMask & allLanes) == allLanes) {
+            for(uint32_t l = 0; l < lanes; l++) {
+                out[x + l] = glm::vec4(h[0][l], h[1][l], h[2][l], h[3][l]);
+            }
+            continue;
+        }
+
+        float tid[3][4];
+        for(int l = 0; l < 4; l++) {
+            uint32_t xl = std::min(x + l, width - 1);
+            glm::vec3 jitter = glm::vec3(0.0f);
+            if(reprojectionOn) {
+                jitter = POISSON_SAMPLES[hash(static_cast<uint32_t>(in.frameNumber) ^ hash3(xl, y, z)) % SAMPLE_NUM] - 0.5f;
+            }
+            tid[0][l] = std::max(xl + jitter.x, 0.0f);
+            tid[1][l] = std::max(y + jitter.y, 0.0f);
+            tid[2][l] = std::max(z + jitter.z, 0.0f);
+        }
+        float4 ndcX = (float4::load(tid[0]) + 0.5f) * invRes[0] - 1.0f;
+        float4 ndcY = (float4::load(tid[1]) + 0.5f) * invRes[1] - 1.0f;
+        float4 ndcZ = (float4::load(tid[2]) + 0.5f) * invRes[2];
+
+        float depth[4], thickness[4];
+        for(int l = 0; l < 4; l++) {
+            depth[l] = volumeZPosToDepth(in, ndcZ[l]);
+            thickness[l] = (volumeZPosToDepth(in, ndcZ[l] + 1.0f / m_resolution[2]) - depth[l]) * 0.01f;
+        }
+        float4 linearDepth = float4::load(depth);
+        float4 layerThickness = float4::load(thickness);
+
+        vec3x4 worldPos = worldPosition(ndcX, ndcY, linearDepth);
+
+        // calculateDensityFunction
+        uint32_t tiles[4];
+        bool anyLocal = false;
+        for(uint32_t l = 0; l < 4 && localFog; l++) {
+            tiles[l] = localFog->lists().tileOf(std::min(x + l, width - 1), y, z);
+            anyLocal = anyLocal || !localFog->tileEmpty(tiles[l]);
+        }
+        float4 dustDensity = simd::clamp(simd::exp(-worldPos.y * in.height), 0.0f, 1.0f) * in.density;
+        float4 noiseValue = 1.0f;
+        if(in.noise || anyLocal) {
+            vec3x4 p = worldPos * float4(0.0025f) + vec3x4{ in.time, 0.0f, 0.0f };
+            noiseValue = simd::clamp(sampleNoise(p) * 1.5f - 0.5f, 0.0f, 1.0f);
+        }
+        if(in.noise) {
+            dustDensity = noiseValue * dustDensity;
+        }
+        if(anyLocal) {
+            float local[4];
+            for(int l = 0; l < 4; l++) {
+                local[l] = localFog->density(tiles[l], glm::vec3(worldPos.x[l], worldPos.y[l], worldPos.z[l]), noiseValue[l]);
+            }
+            dustDensity = dustDensity + float4::load(local);
+        }
+        float4 scattering = (float4(in.constantDensity) + dustDensity) * layerThickness;
+        float4 absorption = float4(in.absorptionFactor) * layerThickness;
+        vec3x4 viewDir = simd::normalize(worldPos - camPos);
+
+        float4 shadow = 1.0f;
+        if(!shadowMap.empty()) {
+            float4 lp[4];
+            transformPoint(lightPV, worldPos, lp);
+            float4 invW = float4(1.0f) / lp[3];
+            float4 lx = lp[0] * invW, ly = lp[1] * invW, lz = lp[2] * invW;
+            float4 bias = simd::max(float4(-0.0005f * 5.0f) * (float4(1.0f) - simd::abs(simd::dot(lightDir, viewDir))), -0.0005f);
+            float s[4];
+            for(int l = 0; l < 4; l++) {
+                s[l] = shadowValue(glm::vec3(lx[l], ly[l], lz[l]), bias[l]);
+            }
+            shadow = float4::load(s);
+        }
+
+        // Henyey-Greenstein phase function, as getPhaseFunction in volumetric_fog_util.h
+        float4 cosPhi = simd::dot(lightDir, viewDir);
+        float g = in.anisotropy;
+        float4 denom = simd::abs(float4(1.0f + g * g) - float4(2.0f * g) * cosPhi);
+        float4 phase = float4(1.0f - g * g) / (denom * simd::sqrt(denom)) * float4(1.0f / 4.0f * static_cast<float>(M_PI));
+
+        float4 sun = shadow * phase;
+
+        // getPointLightsRadiance
+        float pointLights[3][4] = {};
+        for(uint32_t l = 0; l < 4 && lights; l++) {
+            uint32_t tile = lights->lists().tileOf(std::min(x + l, width - 1), y, z);
+            if(lights->tileEmpty(tile)) {
+                continue;
+            }
+            glm::vec3 radiance = lights->fogRadiance(tile, glm::vec3(worldPos.x[l], worldPos.y[l], worldPos.z[l]), glm::vec3(viewDir.x[l], viewDir.y[l], viewDir.z[l]), g);
+            for(int c = 0; c < 3; c++) {
+                pointLights[c][l] = radiance[c];
+            }
+        }
+
+        const glm::vec3 fogAlbedo = glm::vec3(0.8f, 0.8f, 0.7f);
+        float4 result[4] = {
+            (sun * in.dirLight.color.x + 0.1f + float4::load(pointLights[0])) * fogAlbedo.x * scattering,
+            (sun * in.dirLight.color.y + 0.1f + float4::load(pointLights[1])) * fogAlbedo.y * scattering,
+            (sun * in.dirLight.color.z + 0.1f + float4::load(pointLights[2])) * fogAlbedo.z * scattering,
+            scattering + absorption,
+        };
+
+        float r[4][4];
+        for(int c = 0; c < 4; c++) {
+            result[c].store(r[c]);
+        }
+        for(uint32_t l = 0; l < 4; l++) {
+            if(!(historyMask & (1 << l))) {
+                continue;
+            }
+            for(int c = 0; c < 4; c++) {
+                // lit froxels blend with their history, the others keep it
+                r[c][l] = lit ? r[c][l] + (h[c][l] - r[c][l]) * in.historyFactor : h[c][l];
+            }
+        }
+        for(int c = 0; c < 4; c++) {
+            result[c] = float4::load(r[c]);
+        }
+
+        simd::transpose(result[0], result[1], result[2], result[3]);
+        for(uint32_t l = 0; l < lanes; l++) {
+            result[l].store(&out[x + l].x);
+        }
+    }
+}
+
+void CpuFogEngine::accumulateRow(uint32_t y, const glm::vec4 *in, glm::vec4 *out) const
+{
+    const uint32_t width = m_resolution[0];
+    const size_t sliceStride = size_t(width) * m_resolution[1];
+    const size_t rowOffset = size_t(y) * width;
+    // four columns at once: transpose to structure-of-arrays, march front to back, transpose back
+    for(uint32_t x = 0; x < width; x += 4) {
+        uint32_t lanes = std::min(4u, width - x);
+        float4 light[3] = { 0.0f, 0.0f, 0.0f };
+        float4 extinction = 0.0f;
+        for(uint32_t z = 0; z < m_resolution[2]; z++) {
+            const glm::vec4 *src = in + z * sliceStride + rowOffset + x;
+            float4 v[4];
+            for(uint32_t l = 0; l < 4; l++) {
+                v[l] = float4::load(&src[std::min(l, lanes - 1)].x);
+            }
+            simd::transpose(v[0], v[1], v[2], v[3]);
+            if(z == 0) {
+                light[0] = v[0]; light[1] = v[1]; light[2] = v[2];
+                extinction = v[3];
+            } else {
+                // AccumulateScattering
+                float4 transmittance = simd::clamp(simd::exp(-extinction), 0.0f, 1.0f);
+                light[0] = light[0] + transmittance * v[0];
+                light[1] = light[1] + transmittance * v[1];
+                light[2] = light[2] + transmittance * v[2];
+                extinction = extinction + v[3];
+            }
+            // postprocessAndStore: replace extinction with transmittance
+            float4 r[4] = { light[0], light[1], light[2], simd::clamp(simd::exp(-extinction), 0.0f, 1.0f) };
+            simd::transpose(r[0], r[1], r[2], r[3]);
+            glm::vec4 *dst = out + z * sliceStride + rowOffset + x;
+            for(uint32_t l = 0; l < lanes; l++) {
+                r[l].store(&dst[l].x);
+            }
+        }
+    }
+}
+
+const std::vector<glm::vec4> &CpuFogEngine::lightingVolume() const
+{
+    return lightingVolumes[current];
+}
+
+const std::vector<glm::vec4> &CpuFogEngine::historyVolume() const
+{
+    return lightingVolumes[current ^ 1];
+}
+
+const std::vector<glm::vec4> &CpuFogEngine::scatteringVolume() const
+{
+    return m_scatteringVolume;
+}
+
+std::array<uint32_t, 3> CpuFogEngine::resolution() const
+{
+    return m_resolution;
+}
+
+glm::vec4 quantizeFogVoxel(glm::vec4 value, FogPrecision precision)
+{
+    auto half = [](float f) { return glm::unpackHalf1x16(glm::packHalf1x16(f)); };
+    switch(precision) {
+        case FogPrecision::full:
+            return value;
+        case FogPrecision::half:
+            return { half(value.x), half(value.y), half(value.z), half(value.w) };
+        case FogPrecision::packed:
+            return { glm::unpackF2x11_1x10(glm::packF2x11_1x10(glm::vec3(value))), half(value.w) };
+    }
+    return value;
+}
+
+FogParityReport compareFogVolumes(const glm::vec4 *reference, const glm::vec4 *actual, size_t count, float absTolerance, float relTolerance)
+{
+    FogParityReport report{ count, 0, 0.0f, 0.0f, 0 };
+    double squaredSum = 0.0;
+    for(size_t i = 0; i < count; i++) {
+        bool mismatch = false;
+        for(int c = 0; c < 4; c++) {
+            float error = std::abs(actual[i][c] - reference[i][c]);
+            // NaN never compares as within tolerance
+            mismatch |= !(error <= absTolerance + relTolerance * std::abs(reference[i][c]));
+            squaredSum += double(error) * error;
+            if(error > report.maxAbsError) {
+                report.maxAbsError = error;
+                report.worstIndex = i;
+            }
+        }
+        report.mismatches += mismatch;
+    }
+    report.rmsError = count ? static_cast<float>(std::sqrt(squaredSum / (4.0 * count))) : 0.0f;
+    return report;
+}
+
+std::ostream &operator<<(std::ostream &os, const FogParityReport &report)
+{
+    return os << (report.passed() ? "PASS" : "FAIL") << ": " << report.mismatches << "/" << report.count
+              << " voxels outside tolerance, max abs error " << report.maxAbsError << " (voxel " << report.worstIndex
+              << "), rms error " << report.rmsError;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <iosfwd>
+#include <vector>
+
+#include "FogInputs.h"
+#include "LightClusters.h"
+#include "LocalFogVolumes.h"
+#include "NoiseVolume.h"
+
+/*
+ * CPU implementation of volumetric_fog_generate.h and volumetric_fog_raymarch.h.
+ * Given the same FogInputs, light matrix and noise volume as the GPU passes, it produces the same
+ * lighting and scattering volumes (up to filtering precision), so fog output can be checked and timed on machines
+ * without a GPU. Volumes are stored x-major, i.e. index = (z * height + y) * width + x, like a 3D texture.
+ */
+class CpuFogEngine {
+public:
+    using Inputs = FogInputs;
+
+    /* the noise volume must outlive the engine */
+    CpuFogEngine(std::array<uint32_t, 3> resolution, const NoiseVolume &noise);
+
+    /* Depth values as written by the shadow pass. Without a shadow map, every froxel is lit. */
+    void setShadowMap(std::vector<float> depth, uint32_t width, uint32_t height);
+    /* Replaces the volume that the next generate() reprojects from */
+    void setHistory(std::vector<glm::vec4> history);
+    /* Rounds the volumes to the GPU's storage format after each pass, so later passes read what the GPU's read */
+    void setPrecision(FogPrecision precision);
+    /* local fog volumes binned for the inputs passed to generate(), nullptr for none; must outlive their use */
+    void setLocalFog(const LocalFogBins *bins);
+    /* point lights binned for the inputs passed to generate(), nullptr for none; must outlive their use */
+    void setLights(const LightClusters *lights);
+
+    /* density/lighting injection, equivalent to one dispatch of volumetric_fog_generate.h */
+    void generate(const Inputs &inputs, const glm::mat4 &lightPV);
+    /* front-to-back accumulation of the last generated volume, equivalent to volumetric_fog_raymarch.h */
+    void accumulate();
+
+    const std::vector<glm::vec4> &lightingVolume() const;
+    const std::vector<glm::vec4> &historyVolume() const;
+    const std::vector<glm::vec4> &scatteringVolume() const;
+    std::array<uint32_t, 3> resolution() const;
+
+private:
+    void generateRow(const Inputs &inputs, const glm::mat4 &lightPV, uint32_t y, uint32_t z, glm::vec4 *out, const glm::vec4 *history) const;
+    void accumulateRow(uint32_t y, const glm::vec4 *in, glm::vec4 *out) const;
+    void quantize(std::vector<glm::vec4> &volume) const;
+    float shadowValue(glm::vec3 lightspacePosition, float bias) const;
+    glm::vec4 sampleHistory(const glm::vec4 *history, glm::vec3 uvw) const;
+
+    std::array<uint32_t, 3> m_resolution;
+    const NoiseVolume *noise;
+    const LocalFogBins *localFog = nullptr;
+    const LightClusters *lights = nullptr;
+    std::vector<float> shadowMap;
+    uint32_t shadowMapWidth = 0;
+    uint32_t shadowMapHeight = 0;
+    std::array<std::vector<glm::vec4>, 2> lightingVolumes;
+    size_t current = 0;
+    std::vector<glm::vec4> m_scatteringVolume;
+    FogPrecision precision = FogPrecision::full;
+};
+
+/* the value a froxel reads back as after storing it with the given precision */
+glm::vec4 quantizeFogVoxel(glm::vec4 value, FogPrecision precision);
+
+struct FogParityReport {
+    size_t count;
+    size_t mismatches;
+    float maxAbsError;
+    float rmsError;
+    size_t worstIndex;
+
+    bool passed() const { return mismatches == 0; }
+};
+
+/* A component matches if |actual - reference| <= absTolerance + relTolerance * |reference| */
+FogParityReport compareFogVolumes(const glm::vec4 *reference, const glm::vec4 *actual, size_t count, float absTolerance, float relTolerance);
+std::ostream &operator<<(std::ostream &os, const FogParityReport &report);
@@ -0,0 +1,94 @@
+#include <cmath>
+
+#include "Culling.h"
+#include "simd.h"
+
+using simd::float4;
+
+Aabb transformAabb(const Aabb &box, const glm::mat4 &model)
+{
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+    // each world axis is covered by the absolute contributions of all three local half extents
+    glm::vec3 worldExtent{0.0f};
+    for(int column = 0; column < 3; column++) {
+        for(int row = 0; row < 3; row++) {
+            worldExtent[row] += std::fabs(model[column][row]) * extent[column];
+        }
+    }
+    return { worldCenter - worldExtent, worldCenter + worldExtent };
+}
+
+Frustum::Frustum(const glm::mat4 &viewProjection)
+{
+    // Gribb and Hartmann: each clip space inequality is a combination of the matrix' rows
+    auto row = [&](int r) { return glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]); };
+    planes = {
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(2),
+        row(3) - row(2),
+    };
+    for(glm::vec4 &plane : planes) {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        plane /= length;
+    }
+}
+
+void BoundsBatch::clear()
+{
+    count = 0;
+    for(std::vector<float> *lane : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+        lane->clear();
+    }
+}
+
+void BoundsBatch::push(const Aabb &box)
+{
+    if(count % 4 == 0) {
+        // zero-sized padding, its results are never read
+        for(std::vector<float> *lane : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+            lane->resize(count + 4, 0.0f);
+        }
+    }
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    centerX[count] = center.x;
+    centerY[count] = center.y;
+    centerZ[count] = center.z;
+    extentX[count] = extent.x;
+    extentY[count] = extent.y;
+    extentZ[count] = extent.z;
+    count++;
+}
+
+size_t BoundsBatch::size() const
+{
+    return count;
+}
+
+size_t cullBoxes(const Frustum &frustum, const BoundsBatch &boxes, std::vector<uint8_t> &visible)
+{
+    visible.resize(boxes.count);
+    size_t visibleCount = 0;
+    for(size_t i = 0; i < boxes.count; i += 4) {
+        float4 cx = float4::load(&boxes.centerX[i]), cy = float4::load(&boxes.centerY[i]), cz = float4::load(&boxes.centerZ[i]);
+        float4 ex = float4::load(&boxes.extentX[i]), ey = float4::load(&boxes.extentY[i]), ez = float4::load(&boxes.extentZ[i]);
+        float4 outside{0.0f};
+        for(const glm::vec4 &plane : frustum.planes) {
+            // signed distance of the centre plus the box' projected radius onto the plane normal
+            float4 distance = cx * plane.x + cy * plane.y + cz * plane.z + plane.w;
+            float4 radius = ex * std::fabs(plane.x) + ey * std::fabs(plane.y) + ez * std::fabs(plane.z);
+            outside = outside | (distance + radius < float4(0.0f));
+        }
+        int mask = simd::movemask(outside);
+        for(size_t lane = 0; lane < 4 && i + lane < boxes.count; lane++) {
+            visible[i + lane] = (mask >> lane & 1) == 0;
+            visibleCount += visible[i + lane];
+        }
+    }
+    return visibleCount;
+}
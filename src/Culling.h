@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tga/tga.hpp"
+
+/*
+ * CPU visibility tests of instance bounds against view frustums. Boxes are kept structure-of-arrays, so the
+ * plane tests run on four instances at a time with simd::float4.
+ */
+
+struct Aabb {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+};
+
+/* the box around the transformed box, model may rotate and scale but not project */
+Aabb transformAabb(const Aabb &box, const glm::mat4 &model);
+
+/* the six planes of a Vulkan clip volume (0 <= z <= w), normals pointing inwards */
+struct Frustum {
+    std::array<glm::vec4, 6> planes;
+
+    explicit Frustum(const glm::mat4 &viewProjection);
+};
+
+/* world-space boxes as centres and half extents, padded to a multiple of four */
+class BoundsBatch {
+public:
+    void clear();
+    void push(const Aabb &box);
+    size_t size() const;
+
+private:
+    friend size_t cullBoxes(const Frustum &frustum, const BoundsBatch &boxes, std::vector<uint8_t> &visible);
+    size_t count = 0;
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+};
+
+/* visible[i] becomes 1 for every box inside or intersecting the frustum, 0 otherwise. Returns the visible count.
+   Boxes crossing a plane's extension outside the frustum near a corner are kept, the test is conservative. */
+size_t cullBoxes(const Frustum &frustum, const BoundsBatch &boxes, std::vector<uint8_t> &visible);
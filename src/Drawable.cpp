@@ -1,25 +1,171 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
 #include "Drawable.h"
 
-Drawable::Drawable(tga::Interface &tgai, const Mesh &mesh) : indexCount{mesh.indicesArray.size()}, tgai{&tgai} {
-    size_t vb_size = mesh.verticesArray.size() * sizeof(tga::Vertex);
-    size_t eb_size = mesh.indicesArray.size() * sizeof(int32_t);
-    auto vbo_staging = tgai.createStagingBuffer({vb_size, reinterpret_cast<uint8_t*>(const_cast<tga::Vertex*>(mesh.verticesArray.data()))});
-    vertexBuffer = tgai.createBuffer({tga::BufferUsage::vertex, vb_size, vbo_staging});
-    tgai.free(vbo_staging);
-    auto ebo_staging = tgai.createStagingBuffer({eb_size, reinterpret_cast<uint8_t*>(const_cast<uint32_t*>(mesh.indicesArray.data()))});
-    indexBuffer = tgai.createBuffer({tga::BufferUsage::index, eb_size, ebo_staging});
-    tgai.free(ebo_staging);
+namespace {
+
+tga::Buffer upload(tga::Interface &tgai, tga::BufferUsage usage, const void *data, size_t size)
+{
+    auto staging = tgai.createStagingBuffer({size, reinterpret_cast<const uint8_t*>(data)});
+    tga::Buffer buffer = tgai.createBuffer({usage, size, staging});
+    tgai.free(staging);
+    return buffer;
+}
+
+}
+
+Drawable::Drawable(tga::Interface &tgai, const Mesh &mesh, bool packed)
+    : lods{mesh.lods}, m_vertexCount{mesh.verticesArray.size()}, m_packed{packed}, indexType{tga::IndexType::uint32}, tgai{&tgai} {
+    if(lods.empty()) {
+        lods.push_back({ 0, static_cast<uint32_t>(mesh.indicesArray.size()), 0.0f });
+    }
+    if(!mesh.verticesArray.empty()) {
+        m_bounds = { mesh.verticesArray[0].position, mesh.verticesArray[0].position };
+        for(const tga::Vertex &v : mesh.verticesArray) {
+            m_bounds.min = glm::min(m_bounds.min, v.position);
+            m_bounds.max = glm::max(m_bounds.max, v.position);
+        }
+        boundsCenter = (m_bounds.min + m_bounds.max) * 0.5f;
+        boundsRadius = glm::length(m_bounds.max - m_bounds.min) * 0.5f;
+    }
+    VertexDecode decode{};
+    size_t vb_size, pb_size, eb_size;
+    // positions are split into their own stream as well, so the shadow pass fetches a fraction of each vertex
+    if(packed) {
+        QuantizedVertices quantized = quantizeVertices(mesh.verticesArray);
+        decode = quantized.decode;
+        m_quantizationError = quantized.error;
+        vb_size = quantized.vertices.size() * sizeof(PackedVertex);
+        vertexBuffer = upload(tgai, tga::BufferUsage::vertex, quantized.vertices.data(), vb_size);
+        std::vector<std::array<uint16_t, 4>> positions(quantized.vertices.size());
+        for(size_t i = 0; i < positions.size(); i++) {
+            std::copy(std::begin(quantized.vertices[i].position), std::end(quantized.vertices[i].position), positions[i].begin());
+        }
+        pb_size = positions.size() * sizeof(positions[0]);
+        positionBuffer = upload(tgai, tga::BufferUsage::vertex, positions.data(), pb_size);
+    } else {
+        vb_size = mesh.verticesArray.size() * sizeof(tga::Vertex);
+        vertexBuffer = upload(tgai, tga::BufferUsage::vertex, mesh.verticesArray.data(), vb_size);
+        std::vector<glm::vec3> positions(mesh.verticesArray.size());
+        for(size_t i = 0; i < positions.size(); i++) {
+            positions[i] = mesh.verticesArray[i].position;
+        }
+        pb_size = positions.size() * sizeof(glm::vec3);
+        positionBuffer = upload(tgai, tga::BufferUsage::vertex, positions.data(), pb_size);
+    }
+    if(packed && mesh.verticesArray.size() <= 65536) {
+        indexType = tga::IndexType::uint16;
+        std::vector<uint16_t> indices(mesh.indicesArray.begin(), mesh.indicesArray.end());
+        eb_size = indices.size() * sizeof(uint16_t);
+        indexBuffer = upload(tgai, tga::BufferUsage::index, indices.data(), eb_size);
+    } else {
+        eb_size = mesh.indicesArray.size() * sizeof(int32_t);
+        indexBuffer = upload(tgai, tga::BufferUsage::index, mesh.indicesArray.data(), eb_size);
+    }
+    m_geometryBytes = vb_size + pb_size + eb_size;
+    m_decodeBuffer = upload(tgai, tga::BufferUsage::uniform, &decode, sizeof(decode));
 }
 
 Drawable::~Drawable()
 {
+    tgai->free(m_decodeBuffer);
     tgai->free(indexBuffer);
+    tgai->free(positionBuffer);
     tgai->free(vertexBuffer);
 }
 
-void Drawable::draw(tga::CommandRecorder &recorder) const
+size_t Drawable::geometryBytes() const
+{
+    return m_geometryBytes;
+}
+
+tga::Buffer Drawable::decodeBuffer() const
+{
+    return m_decodeBuffer;
+}
+
+bool Drawable::packed() const
+{
+    return m_packed;
+}
+
+const QuantizationError &Drawable::quantizationError() const
+{
+    return m_quantizationError;
+}
+
+size_t Drawable::vertexCount() const
+{
+    return m_vertexCount;
+}
+
+size_t Drawable::vertexStride() const
+{
+    return m_packed ? sizeof(PackedVertex) : sizeof(tga::Vertex);
+}
+
+size_t Drawable::positionStride() const
+{
+    return m_packed ? sizeof(PackedVertex::position) : sizeof(glm::vec3);
+}
+
+size_t Drawable::indexStride() const
+{
+    return indexType == tga::IndexType::uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+const Aabb &Drawable::bounds() const
+{
+    return m_bounds;
+}
+
+size_t Drawable::lodCount() const
+{
+    return lods.size();
+}
+
+size_t Drawable::triangleCount(size_t lod) const
+{
+    return lods[lod].indexCount / 3;
+}
+
+size_t Drawable::selectLod(const glm::mat4 &model, const glm::mat4 &viewProjection, float viewportHeight, float pixelError) const
+{
+    glm::vec4 center = viewProjection * model * glm::vec4(boundsCenter, 1.0f);
+    float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+    // clip w of the bounding sphere's closest point; constant for orthographic projections like the shadow's
+    glm::vec3 projectionW{viewProjection[0][3], viewProjection[1][3], viewProjection[2][3]};
+    float spread = glm::length(projectionW) * boundsRadius * scale;
+    if(center.w + spread <= 0.0f) {
+        // entirely behind the camera
+        return lods.size() - 1;
+    }
+    float w = center.w - spread;
+    if(w <= 0.0f) {
+        return 0;
+    }
+    // object space units to pixels at that depth, along the projection's y axis
+    glm::vec3 projectionY{viewProjection[0][1], viewProjection[1][1], viewProjection[2][1]};
+    float pixelsPerUnit = glm::length(projectionY) * scale * 0.5f * viewportHeight / w;
+    size_t lod = 0;
+    while(lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerUnit < pixelError) {
+        lod++;
+    }
+    return lod;
+}
+
+void Drawable::draw(tga::CommandRecorder &recorder, size_t lod, uint32_t instanceCount, uint32_t firstInstance) const
 {
     recorder.bindVertexBuffer(vertexBuffer);
-    recorder.bindIndexBuffer(indexBuffer);
-    recorder.drawIndexed(indexCount, 0, 0);
+    recorder.bindIndexBuffer(indexBuffer, indexType);
+    recorder.drawIndexed(lods[lod].indexCount, lods[lod].indexOffset, 0, instanceCount, firstInstance);
+}
+
+void Drawable::drawPositions(tga::CommandRecorder &recorder, size_t lod, uint32_t instanceCount, uint32_t firstInstance) const
+{
+    recorder.bindVertexBuffer(positionBuffer);
+    recorder.bindIndexBuffer(indexBuffer, indexType);
+    recorder.drawIndexed(lods[lod].indexCount, lods[lod].indexOffset, 0, instanceCount, firstInstance);
 }
@@ -1,21 +1,54 @@
 #pragma once
 #include "tga/tga.hpp"
 #include "Mesh.h"
+#include "VertexQuantization.h"
+#include "Culling.h"
 
 class Drawable {
 public:
-    Drawable(tga::Interface &tgai, const Mesh &mesh);
+    /* packed uploads PackedVertex data and, below 65536 vertices, 16 bit indices */
+    Drawable(tga::Interface &tgai, const Mesh &mesh, bool packed = false);
     ~Drawable();
 
     Drawable(const Drawable &other) = delete;
     Drawable &operator=(const Drawable &other) = delete;
 
     const tga::InputSet &inputSet() const;
-    void draw(tga::CommandRecorder &recorder) const;
+    void draw(tga::CommandRecorder &recorder, size_t lod = 0, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+    /* draws from the position-only stream, for passes using positionLayout() */
+    void drawPositions(tga::CommandRecorder &recorder, size_t lod = 0, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+    /* object space bounds of the vertices */
+    const Aabb &bounds() const;
+    size_t lodCount() const;
+    size_t triangleCount(size_t lod) const;
+    /* the coarsest LOD whose error, projected at the closest point of the bounds, stays below pixelError pixels.
+       viewportHeight is the render target height in pixels */
+    size_t selectLod(const glm::mat4 &model, const glm::mat4 &viewProjection, float viewportHeight, float pixelError = 1.0f) const;
+    /* size of the vertex, position and index buffers on the GPU */
+    size_t geometryBytes() const;
+    /* VertexDecode uniform for mesh.vert/shadow.vert */
+    tga::Buffer decodeBuffer() const;
+    bool packed() const;
+    /* quantization error of the packed vertices, zero for unpacked ones */
+    const QuantizationError &quantizationError() const;
+    size_t vertexCount() const;
+    size_t vertexStride() const;
+    size_t positionStride() const;
+    size_t indexStride() const;
 
 private:
-    size_t indexCount;
+    std::vector<MeshLod> lods;
+    Aabb m_bounds;
+    glm::vec3 boundsCenter{0.0f};
+    float boundsRadius = 0.0f;
+    size_t m_vertexCount;
+    size_t m_geometryBytes;
+    bool m_packed;
+    QuantizationError m_quantizationError{};
+    tga::IndexType indexType;
     tga::Interface *tgai;
     tga::Buffer vertexBuffer;
+    tga::Buffer positionBuffer;
     tga::Buffer indexBuffer;
+    tga::Buffer m_decodeBuffer;
 };
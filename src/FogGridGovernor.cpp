@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include "FogGridGovernor.h"
+
+static double froxelCount(const std::array<uint32_t, 3> &resolution)
+{
+    return double(resolution[0]) * resolution[1] * resolution[2];
+}
+
+FogGridGovernor::FogGridGovernor(std::vector<std::array<uint32_t, 3>> levels, size_t level, double budgetMs)
+    : levels{std::move(levels)}, m_level{std::min(level, this->levels.size() - 1)}, budgetMs{budgetMs}
+{
+}
+
+bool FogGridGovernor::update(double costMs)
+{
+    if(++samples <= SETTLE_SAMPLES) {
+        return false;
+    }
+    costSum += costMs;
+    if(samples < SETTLE_SAMPLES + DECISION_SAMPLES) {
+        return false;
+    }
+    double mean = cost();
+    size_t next = m_level;
+    if(mean > budgetMs && m_level > 0) {
+        next = m_level - 1;
+    } else if(m_level + 1 < levels.size()) {
+        double predicted = mean * froxelCount(levels[m_level + 1]) / froxelCount(levels[m_level]);
+        if(predicted <= budgetMs * STEP_UP_HEADROOM) {
+            next = m_level + 1;
+        }
+    }
+    if(next == m_level) {
+        // keep following the cost, a heavier view may push it over later
+        samples = SETTLE_SAMPLES;
+        costSum = 0.0;
+        return false;
+    }
+    setLevel(next);
+    return true;
+}
+
+void FogGridGovernor::setLevel(size_t level)
+{
+    m_level = std::min(level, levels.size() - 1);
+    samples = 0;
+    costSum = 0.0;
+}
+
+void FogGridGovernor::setBudget(double budgetMs)
+{
+    this->budgetMs = budgetMs;
+}
+
+const std::array<uint32_t, 3> &FogGridGovernor::resolution() const
+{
+    return levels[m_level];
+}
+
+size_t FogGridGovernor::level() const
+{
+    return m_level;
+}
+
+size_t FogGridGovernor::levelCount() const
+{
+    return levels.size();
+}
+
+double FogGridGovernor::budget() const
+{
+    return budgetMs;
+}
+
+double FogGridGovernor::cost() const
+{
+    return samples > SETTLE_SAMPLES ? costSum / (samples - SETTLE_SAMPLES) : 0.0;
+}
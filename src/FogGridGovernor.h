@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Keeps the GPU cost of the fog passes within a budget by stepping through a ladder of froxel grid resolutions,
+ * coarsest first. It is fed samples of the fog passes' cost alone, not the frame's, and averages those since the
+ * last change; once enough are in, it steps down if they exceed the budget, and up only if the next resolution is
+ * predicted to fit, scaling the cost by the froxel ratio.
+ */
+class FogGridGovernor {
+public:
+    /* a fog pass budget that leaves most of a 144 Hz frame to the rest */
+    static constexpr double DEFAULT_BUDGET_MS = 2.0;
+    /* samples skipped after a change, while the new volumes and pipelines warm up */
+    static constexpr uint32_t SETTLE_SAMPLES = 1;
+    /* samples averaged before deciding */
+    static constexpr uint32_t DECISION_SAMPLES = 4;
+    /* a finer grid must fit within this fraction of the budget */
+    static constexpr double STEP_UP_HEADROOM = 0.85;
+
+    FogGridGovernor(std::vector<std::array<uint32_t, 3>> levels, size_t level, double budgetMs);
+
+    /* a sample of the fog passes' cost at resolution(), true if the resolution changed */
+    bool update(double costMs);
+    /* jumps to a level, e.g. picked by hand, and measures it afresh */
+    void setLevel(size_t level);
+    void setBudget(double budgetMs);
+
+    const std::array<uint32_t, 3> &resolution() const;
+    size_t level() const;
+    size_t levelCount() const;
+    double budget() const;
+    /* mean cost since the last change, 0 until the first samples settled */
+    double cost() const;
+
+private:
+    std::vector<std::array<uint32_t, 3>> levels;
+    size_t m_level;
+    double budgetMs;
+    uint32_t samples = 0;
+    double costSum = 0.0;
+};
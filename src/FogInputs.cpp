@@ -0,0 +1,95 @@
+#include "FogInputs.h"
+
+size_t fogPrecisionBytes(FogPrecision precision)
+{
+    switch(precision) {
+        case FogPrecision::full: return 16;
+        case FogPrecision::half: return 8;
+        case FogPrecision::packed: return 4 + 2;
+    }
+    return 0;
+}
+
+float fogPrecisionEpsilon(FogPrecision precision)
+{
+    switch(precision) {
+        case FogPrecision::full: return 0.0f;
+        // 10 explicit mantissa bits of a half, 5 of the blue channel of r11g11b10
+        case FogPrecision::half: return std::ldexp(1.0f, -11);
+        case FogPrecision::packed: return std::ldexp(1.0f, -6);
+    }
+    return 0.0f;
+}
+
+const char *fogPrecisionName(FogPrecision precision)
+{
+    switch(precision) {
+        case FogPrecision::full: return "full";
+        case FogPrecision::half: return "half";
+        case FogPrecision::packed: return "packed";
+    }
+    return "?";
+}
+
+bool parseFogPrecision(std::string_view name, FogPrecision &precision)
+{
+    for(FogPrecision candidate : { FogPrecision::full, FogPrecision::half, FogPrecision::packed }) {
+        if(name == fogPrecisionName(candidate)) {
+            precision = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *fogInterleaveOrderName(FogInterleaveOrder order)
+{
+    switch(order) {
+        case FogInterleaveOrder::checkerboard: return "checkerboard";
+        case FogInterleaveOrder::slices: return "slices";
+    }
+    return "?";
+}
+
+bool parseFogInterleaveOrder(std::string_view name, FogInterleaveOrder &order)
+{
+    for(FogInterleaveOrder candidate : { FogInterleaveOrder::checkerboard, FogInterleaveOrder::slices }) {
+        if(name == fogInterleaveOrderName(candidate)) {
+            order = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t fogVolumeBytes(std::array<uint32_t, 3> resolution, FogPrecision precision)
+{
+    size_t froxels = size_t(resolution[0]) * resolution[1] * resolution[2];
+    return froxels * (fogPrecisionBytes(precision) - (precision == FogPrecision::packed ? 2 : 0));
+}
+
+size_t fogAlphaVolumeBytes(std::array<uint32_t, 3> resolution)
+{
+    return size_t(resolution[0]) * resolution[1] * resolution[2] * 2;
+}
+
+void setFogCameraInputs(FogInputs &inputs, const Camera &camera)
+{
+    inputs.cameraPos = camera.getPosition();
+
+    glm::mat4 projection = camera.projection();
+    float projWidth = projection[0][0];
+    float projHeight = projection[1][1];
+
+    glm::mat4 invView = glm::inverse(camera.view());
+    inputs.cameraXAxis = invView * glm::vec4(1.0f / projWidth, 0, 0, 0);
+    inputs.cameraYAxis = invView * glm::vec4(0, 1.0f / projHeight, 0, 0);
+    inputs.cameraZAxis = invView * glm::vec4(0, 0, -1, 0);
+    inputs.zNear = camera.zNear();
+    inputs.zFar  = camera.zFar();
+}
+
+FroxelFrustum fogFroxelFrustum(const FogInputs &inputs)
+{
+    return { inputs.cameraPos, inputs.cameraXAxis, inputs.cameraYAxis, inputs.cameraZAxis, inputs.zNear, inputs.resolution, inputs.fogRange, inputs.depthPackExponent };
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "FroxelTiles.h"
+#include "Lights.h"
+
+/*
+ * What the fog passes are configured and fed with, shared by FogVolumeGenerationPass and the CPU reference in
+ * CpuFogEngine. Nothing here touches the GPU, so the CPU reference builds without TGA.
+ */
+
+/* storage of the lighting and scattering volumes: rgba32f, rgba16f, or r11g11b10f with the alpha channel (extinction
+   or transmittance) in a separate r16f volume */
+enum class FogPrecision { full, half, packed };
+
+/* bytes per froxel of one volume, alpha included */
+size_t fogPrecisionBytes(FogPrecision precision);
+/* relative rounding error of the coarsest channel */
+float fogPrecisionEpsilon(FogPrecision precision);
+const char *fogPrecisionName(FogPrecision precision);
+/* false for unknown names */
+bool parseFogPrecision(std::string_view name, FogPrecision &precision);
+
+/* the froxel grid: slice z of depth slices starts (z / depth)^depthExponent * range in front of the near plane, the
+   exponent packs more slices close to the camera */
+struct FogGrid {
+    std::array<uint32_t, 3> resolution;
+    float range = 300.0f;
+    float depthExponent = 1.8f;
+
+    bool operator==(const FogGrid &other) const = default;
+};
+
+/* which froxels share a turn: checkerboard alternates 4x4x4 blocks along all three axes, slices alternates blocks of
+   four depth slices. Blocks are the generation pass's workgroups, so froxels that wait skip the lighting as a whole */
+enum class FogInterleaveOrder { checkerboard, slices };
+
+const char *fogInterleaveOrderName(FogInterleaveOrder order);
+/* false for unknown names */
+bool parseFogInterleaveOrder(std::string_view name, FogInterleaveOrder &order);
+
+/* the generation pass lights one of ways subsets of the froxels per frame, the others are reprojected from the
+   history. Each froxel converges ways times slower; 1 lights all of them every frame */
+struct FogInterleave {
+    uint32_t ways = 1;
+    FogInterleaveOrder order = FogInterleaveOrder::checkerboard;
+
+    bool operator==(const FogInterleave &other) const = default;
+};
+
+/* the generation and raymarch passes' uniform buffer, must match volumetric_fog_generate.h */
+struct FogInputs {
+    alignas(16) std::array<uint32_t, 3> resolution;
+    alignas(16) glm::vec3 cameraPos;
+    alignas(16) glm::vec3 cameraXAxis;
+    alignas(16) glm::vec3 cameraYAxis;
+    alignas(16) glm::vec3 cameraZAxis;
+    alignas(4)  float zNear;
+    alignas(4)  float zFar;
+    alignas(16) glm::mat4 prevFrameVP;
+    alignas(16) DirLight dirLight;
+    alignas(4) float time;
+    alignas(4) int frameNumber;
+    alignas(4) float historyFactor;
+    alignas(4) float density;
+    alignas(4) float constantDensity;
+    alignas(4) float anisotropy;
+    alignas(4) float absorptionFactor;
+    alignas(4) float height;
+    alignas(4) bool noise;
+    alignas(4) float skyBlendRatio;
+    /* 1 if the alpha channels are in separate volumes, see FogPrecision::packed */
+    alignas(4) uint32_t splitAlpha;
+    alignas(4) float fogRange;
+    alignas(4) float depthPackExponent;
+    /* see FogInterleave */
+    alignas(4) uint32_t interleave;
+    alignas(4) uint32_t interleaveOrder;
+};
+
+/* bytes of one lighting or scattering volume, without the separate alpha volume of FogPrecision::packed */
+size_t fogVolumeBytes(std::array<uint32_t, 3> resolution, FogPrecision precision);
+size_t fogAlphaVolumeBytes(std::array<uint32_t, 3> resolution);
+/* camera position, frustum axes and clip distances as the shaders expect them */
+void setFogCameraInputs(FogInputs &inputs, const Camera &camera);
+/* the froxel grid the inputs describe, to bin against */
+FroxelFrustum fogFroxelFrustum(const FogInputs &inputs);
@@ -0,0 +1,119 @@
+#include <chrono>
+#include <iostream>
+
+#include "tga/tga_utils.hpp"
+
+#include "FogParityCheck.h"
+#include "util.h"
+
+FogParityCheck::FogParityCheck(tga::Interface &tgai, const FogVolumeGenerationPass &fp, const ShadowPass &sp, const LightClusters &lights)
+    : tgai{&tgai}, fp{&fp}, sp{&sp}, lights{&lights}
+{
+    auto volumeShader = tga::loadShader("../shaders/readback_volume_comp.spv", tga::ShaderType::compute, tgai);
+    volumeCp = tgai.createComputePass({ volumeShader, tga::InputLayout{ { tga::BindingType::sampler, tga::BindingType::storageBuffer } } });
+    tgai.free(volumeShader);
+    auto shadowMapShader = tga::loadShader("../shaders/readback_shadow_map_comp.spv", tga::ShaderType::compute, tgai);
+    shadowMapCp = tgai.createComputePass({ shadowMapShader, tga::InputLayout{ { tga::BindingType::sampler, tga::BindingType::storageBuffer } } });
+    tgai.free(shadowMapShader);
+
+    auto res = fp.volumeResolution();
+    size_t volumeSize = size_t(res[0]) * res[1] * res[2] * sizeof(glm::vec4);
+    volumeBuffer = tgai.createBuffer({ tga::BufferUsage::storage, volumeSize });
+    volumeStaging = tgai.createStagingBuffer({ volumeSize });
+    auto shadowRes = sp.resolution();
+    size_t shadowMapSize = size_t(shadowRes[0]) * shadowRes[1] * sizeof(float);
+    shadowMapBuffer = tgai.createBuffer({ tga::BufferUsage::storage, shadowMapSize });
+    shadowMapStaging = tgai.createStagingBuffer({ shadowMapSize });
+}
+
+FogParityCheck::~FogParityCheck()
+{
+    tgai->free(volumeBuffer);
+    tgai->free(volumeStaging);
+    tgai->free(shadowMapBuffer);
+    tgai->free(shadowMapStaging);
+    tgai->free(volumeCp);
+    tgai->free(shadowMapCp);
+}
+
+void FogParityCheck::dispatchAndDownload(tga::ComputePass cp, tga::InputSet inputs, std::array<uint32_t, 3> groups, tga::Buffer buffer, tga::StagingBuffer staging, size_t size)
+{
+    tga::CommandRecorder recorder{ *tgai };
+    recorder.setComputePass(cp);
+    recorder.bindInputSet(inputs);
+    recorder.dispatch(groups[0], groups[1], groups[2]);
+    recorder.barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::Transfer);
+    recorder.bufferDownload(buffer, staging, size);
+    tga::CommandBuffer cmd = recorder.endRecording();
+    tgai->execute(cmd);
+    tgai->waitForCompletion(cmd);
+    tgai->free(cmd);
+    tgai->free(inputs);
+}
+
+std::vector<glm::vec4> FogParityCheck::readbackVolume(tga::Texture volume, tga::Texture alphaVolume)
+{
+    auto res = fp->volumeResolution();
+    size_t count = size_t(res[0]) * res[1] * res[2];
+    auto download = [&](tga::Texture texture) {
+        tga::InputSet inputs = tgai->createInputSet({ volumeCp, { tga::Binding(texture, 0), tga::Binding(volumeBuffer, 1) }, 0 });
+        dispatchAndDownload(volumeCp, inputs, { ceilDiv(res[0], 8u), ceilDiv(res[1], 8u), res[2] }, volumeBuffer, volumeStaging, count * sizeof(glm::vec4));
+        const glm::vec4 *data = static_cast<const glm::vec4 *>(tgai->getMapping(volumeStaging));
+        return std::vector<glm::vec4>(data, data + count);
+    };
+    std::vector<glm::vec4> values = download(volume);
+    if(fp->precision() == FogPrecision::packed) {
+        // single channel textures read back as (alpha, 0, 0, 1)
+        std::vector<glm::vec4> alpha = download(alphaVolume);
+        for(size_t i = 0; i < count; i++) {
+            values[i].w = alpha[i].x;
+        }
+    }
+    return values;
+}
+
+std::vector<float> FogParityCheck::readbackShadowMap()
+{
+    auto res = sp->resolution();
+    size_t count = size_t(res[0]) * res[1];
+    tga::InputSet inputs = tgai->createInputSet({ shadowMapCp, { tga::Binding(sp->shadowMap(), 0), tga::Binding(shadowMapBuffer, 1) }, 0 });
+    dispatchAndDownload(shadowMapCp, inputs, { ceilDiv(res[0], 8u), ceilDiv(res[1], 8u), 1 }, shadowMapBuffer, shadowMapStaging, count * sizeof(float));
+    const float *data = static_cast<const float *>(tgai->getMapping(shadowMapStaging));
+    return std::vector<float>(data, data + count);
+}
+
+bool FogParityCheck::run(uint32_t nf, float absTolerance, float relTolerance)
+{
+    typedef std::chrono::high_resolution_clock clock;
+    typedef std::chrono::duration<double, std::milli> duration;
+
+    CpuFogEngine engine{ fp->volumeResolution(), fp->noiseVolume() };
+    // both sides round to the storage format, what remains differs by at most a rounding step
+    engine.setPrecision(fp->precision());
+    engine.setLocalFog(&fp->localFog());
+    engine.setLights(lights);
+    relTolerance += 2.0f * fogPrecisionEpsilon(fp->precision());
+    auto shadowRes = sp->resolution();
+    engine.setShadowMap(readbackShadowMap(), shadowRes[0], shadowRes[1]);
+    // the generation pass of frame nf read the other lighting volume as its history, which it left untouched
+    engine.setHistory(readbackVolume(fp->lightingVolume(nf + 1), fp->lightingAlphaVolume(nf + 1)));
+
+    clock::time_point start = clock::now();
+    engine.generate(fp->inputs(), sp->lightViewProjection());
+    clock::time_point generated = clock::now();
+    engine.accumulate();
+    clock::time_point accumulated = clock::now();
+    std::cout << "[Fog parity] CPU generation: " << duration(generated - start).count() << " ms, accumulation: "
+              << duration(accumulated - generated).count() << " ms\n";
+
+    std::vector<glm::vec4> gpuLighting = readbackVolume(fp->lightingVolume(nf), fp->lightingAlphaVolume(nf));
+    FogParityReport lighting = compareFogVolumes(engine.lightingVolume().data(), gpuLighting.data(), gpuLighting.size(), absTolerance, relTolerance);
+    std::cout << "[Fog parity] lighting volume   " << lighting << "\n";
+    gpuLighting = {};
+
+    std::vector<glm::vec4> gpuScattering = readbackVolume(fp->scatteringVolume(), fp->scatteringAlphaVolume());
+    FogParityReport scattering = compareFogVolumes(engine.scatteringVolume().data(), gpuScattering.data(), gpuScattering.size(), absTolerance, relTolerance);
+    std::cout << "[Fog parity] scattering volume " << scattering << "\n";
+
+    return lighting.passed() && scattering.passed();
+}
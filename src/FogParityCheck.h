@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+
+#include "tga/tga.hpp"
+#include "ShadowPass.h"
+#include "FogVolumeGenerationPass.h"
+#include "CpuFogEngine.h"
+
+/*
+ * Reads the fog volumes of a finished frame back from the GPU and compares them against CpuFogEngine,
+ * fed with the exact same inputs, shadow map and history volume.
+ */
+class FogParityCheck {
+public:
+    static constexpr float DEFAULT_ABS_TOLERANCE = 1e-4f;
+    static constexpr float DEFAULT_REL_TOLERANCE = 2e-2f;
+
+    /* lights are the point lights the frame was clustered with, see Scene::lightClusters() */
+    FogParityCheck(tga::Interface &tgai, const FogVolumeGenerationPass &fp, const ShadowPass &sp, const LightClusters &lights);
+    ~FogParityCheck();
+    FogParityCheck(const FogParityCheck &) = delete;
+    FogParityCheck &operator=(const FogParityCheck &) = delete;
+
+    /* nf is the backbuffer index of the last frame, whose command buffer must have completed */
+    bool run(uint32_t nf, float absTolerance = DEFAULT_ABS_TOLERANCE, float relTolerance = DEFAULT_REL_TOLERANCE);
+
+private:
+    /* with FogPrecision::packed, the alpha channel comes from alphaVolume, otherwise it is the same texture */
+    std::vector<glm::vec4> readbackVolume(tga::Texture volume, tga::Texture alphaVolume);
+    std::vector<float> readbackShadowMap();
+    void dispatchAndDownload(tga::ComputePass cp, tga::InputSet inputs, std::array<uint32_t, 3> groups, tga::Buffer buffer, tga::StagingBuffer staging, size_t size);
+
+    tga::Interface *tgai;
+    const FogVolumeGenerationPass *fp;
+    const ShadowPass *sp;
+    const LightClusters *lights;
+    tga::ComputePass volumeCp;
+    tga::ComputePass shadowMapCp;
+    tga::Buffer volumeBuffer;
+    tga::StagingBuffer volumeStaging;
+    tga::Buffer shadowMapBuffer;
+    tga::StagingBuffer shadowMapStaging;
+};
@@ -1,112 +1,234 @@
-#include <cstring>
+#include <algorithm>
 #include <cmath>
+#include <string>
 
 #include "FogVolumeGenerationPass.h"
 #include "util.h"
 
-FogVolumeGenerationPass::FogVolumeGenerationPass(tga::Interface &tgai, std::array<uint32_t, 3> resolution, const ShadowPass &sp) : tgai{&tgai}, startTime{std::chrono::system_clock::now()}, resolution{resolution}
-{
-    size_t textureMemorySize = resolution[0] * resolution[1] * resolution[2] * sizeof(glm::vec4);
-    tga::StagingBuffer zeroStaging = tgai.createStagingBuffer({textureMemorySize});
-    void *zeros = tgai.getMapping(zeroStaging);
-    std::memset(zeros, 0, textureMemorySize);
-    tga::TextureInfo texInfo{ resolution[0], resolution[1], tga::Format::r32g32b32a32_sfloat,
-                              tga::SamplerMode::linear, tga::AddressMode::clampEdge,
-                              tga::TextureType::_3D, resolution[2], zeroStaging, 0 };
-    lightingVolumes[0] = tgai.createTexture(texInfo);
-    lightingVolumes[1] = tgai.createTexture(texInfo);
-    m_scatteringVolume = tgai.createTexture(texInfo);
-    tgai.free(zeroStaging);
-
-    generationInputsStaging = tgai.createStagingBuffer({ sizeof(VolumeGenerationInputs), nullptr });
-    generationInputsData = reinterpret_cast<VolumeGenerationInputs *>(tgai.getMapping(generationInputsStaging));
-    generationInputsData->resolution = resolution;
-    generationInputsBuffer = tgai.createBuffer({ tga::BufferUsage::uniform, sizeof(VolumeGenerationInputs), generationInputsStaging });
-
-    auto volumeGenerationShader = tga::loadShader("../shaders/volumetric_fog_comp.spv", tga::ShaderType::compute, tgai);
-    cp = tgai.createComputePass({ volumeGenerationShader, tga::InputLayout{ { tga::BindingType::storageImage, tga::BindingType::sampler, tga::BindingType::uniformBuffer, tga::BindingType::uniformBuffer, tga::BindingType::sampler, tga::BindingType::sampler } } });
-    tgai.free(volumeGenerationShader);
+namespace {
 
-    perlinNoise = tga::loadTexture("../assets/textures/perlin.png", tga::Format::r32_sfloat, tga::SamplerMode::linear, tga::AddressMode::repeat, tgai, false);
+tga::Format volumeFormat(FogPrecision precision)
+{
+    switch(precision) {
+        case FogPrecision::full: return tga::Format::r32g32b32a32_sfloat;
+        case FogPrecision::half: return tga::Format::r16g16b16a16_sfloat;
+        case FogPrecision::packed: return tga::Format::b10g11r11_ufloat_pack32;
+    }
+    return tga::Format::undefined;
+}
 
-    generationInputs[0] = tgai.createInputSet({ cp, { tga::Binding(lightingVolumes[0], 0), tga::Binding(lightingVolumes[1], 1), tga::Binding(generationInputsBuffer, 2), tga::Binding(sp.inputBuffer(), 3), tga::Binding(sp.shadowMap(), 4), tga::Binding(perlinNoise, 5) }, 0 });
-    generationInputs[1] = tgai.createInputSet({ cp, { tga::Binding(lightingVolumes[1], 0), tga::Binding(lightingVolumes[0], 1), tga::Binding(generationInputsBuffer, 2), tga::Binding(sp.inputBuffer(), 3), tga::Binding(sp.shadowMap(), 4), tga::Binding(perlinNoise, 5) }, 0 });
+const char *shaderSuffix(FogPrecision precision)
+{
+    switch(precision) {
+        case FogPrecision::full: return "";
+        case FogPrecision::half: return "_half";
+        case FogPrecision::packed: return "_packed";
+    }
+    return "";
+}
 
-    auto volumeAccumulationShader = tga::loadShader("../shaders/volumetric_fog_raymarch_comp.spv", tga::ShaderType::compute, tgai);
-    accCp = tgai.createComputePass({ volumeAccumulationShader, tga::InputLayout{ { tga::BindingType::storageImage, tga::BindingType::storageImage, tga::BindingType::uniformBuffer } } });
-    /* reusing generation inputs */
-    accumulationInputs[0] = tgai.createInputSet({ accCp, { tga::Binding(lightingVolumes[0], 0), tga::Binding(m_scatteringVolume, 1), tga::Binding(generationInputsBuffer, 2) }, 0 });
-    accumulationInputs[1] = tgai.createInputSet({ accCp, { tga::Binding(lightingVolumes[1], 0), tga::Binding(m_scatteringVolume, 1), tga::Binding(generationInputsBuffer, 2) }, 0 });
+}
+
+tga::TextureInfo FogVolumeGenerationPass::volumeInfo(std::array<uint32_t, 3> resolution, FogPrecision precision)
+{
+    return { resolution[0], resolution[1], volumeFormat(precision), tga::SamplerMode::linear, tga::AddressMode::clampEdge, tga::TextureType::_3D, resolution[2] };
+}
+
+tga::TextureInfo FogVolumeGenerationPass::alphaVolumeInfo(std::array<uint32_t, 3> resolution)
+{
+    return { resolution[0], resolution[1], tga::Format::r16_sfloat, tga::SamplerMode::linear, tga::AddressMode::clampEdge, tga::TextureType::_3D, resolution[2] };
+}
+
+FogVolumeGenerationPass::FogVolumeGenerationPass(tga::Interface &tgai, const FogGrid &grid, FogPrecision precision, const ShadowPass &sp, const NoiseVolume &noise,
+                                                 uint32_t slots, tga::Buffer lightBuffer, tga::Texture scatteringVolume, tga::Texture scatteringAlphaVolume)
+    : tgai{&tgai}, sp{&sp}, noise{&noise}, startTime{std::chrono::system_clock::now()}, m_grid{grid}, m_precision{precision},
+      m_scatteringVolume{scatteringVolume}, m_scatteringAlphaVolume{scatteringAlphaVolume}, lightBuffer{lightBuffer}
+{
+    generationInputsStaging = SlotStaging(tgai, sizeof(VolumeGenerationInputs), slots);
+    generationInputsData.resolution = grid.resolution;
+    generationInputsBuffer = tgai.createBuffer({ tga::BufferUsage::uniform, sizeof(VolumeGenerationInputs) });
+    localFogStaging = SlotStaging(tgai, LocalFogBins::BUFFER_SIZE, slots);
+    localFogBuffer = tgai.createBuffer({ tga::BufferUsage::storage, LocalFogBins::BUFFER_SIZE });
+
+    bool split = precision == FogPrecision::packed;
+    std::string suffix = shaderSuffix(precision);
+    auto volumeGenerationShader = tga::loadShader("../shaders/volumetric_fog" + suffix + "_comp.spv", tga::ShaderType::compute, tgai);
+    tga::SetLayout generationLayout = split
+        ? tga::SetLayout{ { tga::BindingType::storageImage, tga::BindingType::sampler, tga::BindingType::uniformBuffer, tga::BindingType::uniformBuffer, tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::storageBuffer, tga::BindingType::storageBuffer, tga::BindingType::storageImage, tga::BindingType::sampler } }
+        : tga::SetLayout{ { tga::BindingType::storageImage, tga::BindingType::sampler, tga::BindingType::uniformBuffer, tga::BindingType::uniformBuffer, tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::storageBuffer, tga::BindingType::storageBuffer } };
+    cp = tgai.createComputePass({ volumeGenerationShader, tga::InputLayout{ generationLayout } });
+    tgai.free(volumeGenerationShader);
+
+    uint32_t noiseSize = noise.params.size;
+    tga::StagingBuffer noiseStaging = tgai.createStagingBuffer({ noise.texels.size(), noise.texels.data() });
+    noiseTexture = tgai.createTexture({ noiseSize, noiseSize, tga::Format::r8_unorm, tga::SamplerMode::linear, tga::AddressMode::repeat, tga::TextureType::_3D, noiseSize, noiseStaging });
+    tgai.free(noiseStaging);
+
+    auto volumeAccumulationShader = tga::loadShader("../shaders/volumetric_fog_raymarch" + suffix + "_comp.spv", tga::ShaderType::compute, tgai);
+    tga::SetLayout accumulationLayout = split
+        ? tga::SetLayout{ { tga::BindingType::storageImage, tga::BindingType::storageImage, tga::BindingType::uniformBuffer, tga::BindingType::storageImage, tga::BindingType::storageImage } }
+        : tga::SetLayout{ { tga::BindingType::storageImage, tga::BindingType::storageImage, tga::BindingType::uniformBuffer } };
+    accCp = tgai.createComputePass({ volumeAccumulationShader, tga::InputLayout{ accumulationLayout } });
     tgai.free(volumeAccumulationShader);
+
+    createVolumes();
 }
 
 FogVolumeGenerationPass::~FogVolumeGenerationPass()
+{
+    freeVolumes();
+    tgai->free(generationInputsBuffer);
+    tgai->free(localFogBuffer);
+    tgai->free(noiseTexture);
+    tgai->free(cp);
+}
+
+void FogVolumeGenerationPass::createVolumes()
+{
+    // no initial contents, update() disables the history for the first frame so it is never read before written
+    bool split = m_precision == FogPrecision::packed;
+    for(size_t i = 0; i < lightingVolumes.size(); ++i) {
+        lightingVolumes[i] = tgai->createTexture(volumeInfo(m_grid.resolution, m_precision));
+        if(split) {
+            lightingAlphaVolumes[i] = tgai->createTexture(alphaVolumeInfo(m_grid.resolution));
+        }
+    }
+
+    for(uint32_t i = 0; i < 2; ++i) {
+        uint32_t prev = 1 - i;
+        std::vector<tga::Binding> bindings{ tga::Binding(lightingVolumes[i], 0), tga::Binding(lightingVolumes[prev], 1), tga::Binding(generationInputsBuffer, 2), tga::Binding(sp->inputBuffer(), 3), tga::Binding(sp->shadowMap(), 4), tga::Binding(noiseTexture, 5), tga::Binding(localFogBuffer, 6), tga::Binding(lightBuffer, 7) };
+        if(split) {
+            bindings.insert(bindings.end(), { tga::Binding(lightingAlphaVolumes[i], 8), tga::Binding(lightingAlphaVolumes[prev], 9) });
+        }
+        generationInputs[i] = tgai->createInputSet({ cp, bindings, 0 });
+    }
+    /* reusing generation inputs */
+    for(uint32_t i = 0; i < 2; ++i) {
+        std::vector<tga::Binding> bindings{ tga::Binding(lightingVolumes[i], 0), tga::Binding(m_scatteringVolume, 1), tga::Binding(generationInputsBuffer, 2) };
+        if(split) {
+            bindings.insert(bindings.end(), { tga::Binding(lightingAlphaVolumes[i], 3), tga::Binding(m_scatteringAlphaVolume, 4) });
+        }
+        accumulationInputs[i] = tgai->createInputSet({ accCp, bindings, 0 });
+    }
+}
+
+void FogVolumeGenerationPass::freeVolumes()
 {
     tgai->free(lightingVolumes[0]);
     tgai->free(lightingVolumes[1]);
-    tgai->free(m_scatteringVolume);
+    if(m_precision == FogPrecision::packed) {
+        tgai->free(lightingAlphaVolumes[0]);
+        tgai->free(lightingAlphaVolumes[1]);
+    }
     tgai->free(generationInputs[0]);
     tgai->free(generationInputs[1]);
-    tgai->free(generationInputsBuffer);
-    tgai->free(generationInputsStaging);
     tgai->free(accumulationInputs[0]);
     tgai->free(accumulationInputs[1]);
-    tgai->free(cp);
 }
 
-void FogVolumeGenerationPass::update(const Scene &scene, uint32_t nf, float historyFactor, float density, float constantDensity, float anisotropy, float absorption, float height, bool noise, float skyBlendRatio)
+void FogVolumeGenerationPass::setGrid(const FogGrid &grid, tga::Texture scatteringVolume, tga::Texture scatteringAlphaVolume)
 {
-    float time = std::fmod(std::chrono::duration_cast<std::chrono::duration<float>>(startTime - std::chrono::system_clock::now()).count() / 60.0f, 1.0f);
+    if(grid.resolution != m_grid.resolution) {
+        freeVolumes();
+        m_grid = grid;
+        m_scatteringVolume = scatteringVolume;
+        m_scatteringAlphaVolume = scatteringAlphaVolume;
+        createVolumes();
+    }
+    m_grid = grid;
+    // the history's froxels are laid out differently, reprojecting from it would smear
+    prevFrameVP.reset();
+}
 
-    const Camera &camera = scene.camera();
-    generationInputsData->cameraPos = camera.getPosition();
+void FogVolumeGenerationPass::setTime(std::optional<double> seconds)
+{
+    fixedTime = seconds;
+}
 
-    glm::mat4 projection = camera.projection();
-    float projWidth = projection[0][0];
-    float projHeight = projection[1][1];
+void FogVolumeGenerationPass::setInterleave(const FogInterleave &interleave)
+{
+    m_interleave = interleave;
+    m_interleave.ways = std::max(m_interleave.ways, 1u);
+}
+
+const FogInterleave &FogVolumeGenerationPass::interleave() const
+{
+    return m_interleave;
+}
 
+void FogVolumeGenerationPass::setLocalVolumes(const std::vector<LocalFogVolume> &volumes)
+{
+    m_localFog.setVolumes(volumes);
+}
+
+const LocalFogBins &FogVolumeGenerationPass::localFog() const
+{
+    return m_localFog;
+}
+
+std::array<size_t, 2> FogVolumeGenerationPass::localFogUpload() const
+{
+    return { m_localFog.volumes().size(), m_localFog.lists().uploadReferences() };
+}
+
+void FogVolumeGenerationPass::update(const Scene &scene, uint32_t frameNumber, uint32_t slot, float historyFactor, float density, float constantDensity, float anisotropy, float absorption, float height, bool noise, float skyBlendRatio)
+{
+    double elapsed = fixedTime ? *fixedTime : std::chrono::duration<double>(std::chrono::system_clock::now() - startTime).count();
+    float time = static_cast<float>(std::fmod(-elapsed / 60.0, 1.0));
+
+    setFogCameraInputs(generationInputsData, scene.camera());
     glm::mat4 vp = scene.viewProjection();
-    glm::mat4 invView = glm::inverse(camera.view());
-    generationInputsData->cameraXAxis = invView * glm::vec4(1.0f / projWidth, 0, 0, 0);
-    generationInputsData->cameraYAxis = invView * glm::vec4(0, 1.0f / projHeight, 0, 0);
-    generationInputsData->cameraZAxis = invView * glm::vec4(0, 0, -1, 0);
-    generationInputsData->zNear = camera.zNear();
-    generationInputsData->zFar  = camera.zFar();
-    generationInputsData->dirLight = scene.dirLight();
-    generationInputsData->frameNumber = nf;
+    generationInputsData.dirLight = scene.dirLight();
+    generationInputsData.frameNumber = frameNumber;
     if(prevFrameVP) {
-        generationInputsData->prevFrameVP = *prevFrameVP;
+        generationInputsData.prevFrameVP = *prevFrameVP;
     } else {
-        generationInputsData->prevFrameVP = vp;
+        generationInputsData.prevFrameVP = vp;
     }
-    generationInputsData->resolution = resolution;
-    generationInputsData->time = time;
-    generationInputsData->historyFactor = historyFactor;
-    generationInputsData->density = density;
-    generationInputsData->constantDensity = constantDensity;
-    generationInputsData->anisotropy = anisotropy;
-    generationInputsData->absorptionFactor = absorption;
-    generationInputsData->height = height;
-    generationInputsData->noise = noise;
-    generationInputsData->skyBlendRatio = skyBlendRatio;
+    generationInputsData.resolution = m_grid.resolution;
+    generationInputsData.fogRange = m_grid.range;
+    generationInputsData.depthPackExponent = m_grid.depthExponent;
+    generationInputsData.time = time;
+    // the volume written before has no contents on the first frame
+    generationInputsData.historyFactor = prevFrameVP ? historyFactor : 0.0f;
+    generationInputsData.density = density;
+    generationInputsData.constantDensity = constantDensity;
+    generationInputsData.anisotropy = anisotropy;
+    generationInputsData.absorptionFactor = absorption;
+    generationInputsData.height = height;
+    generationInputsData.noise = noise;
+    generationInputsData.skyBlendRatio = skyBlendRatio;
+    generationInputsData.splitAlpha = m_precision == FogPrecision::packed;
+    generationInputsData.interleave = m_interleave.ways;
+    generationInputsData.interleaveOrder = static_cast<uint32_t>(m_interleave.order);
     prevFrameVP = vp;
+    generationInputsStaging.write(slot, &generationInputsData, sizeof(VolumeGenerationInputs));
+
+    m_localFog.bin(fogFroxelFrustum(generationInputsData));
+    m_localFog.write(localFogStaging.as<uint8_t>(slot));
 }
 
-void FogVolumeGenerationPass::upload(tga::CommandRecorder &recorder) const
+void FogVolumeGenerationPass::upload(tga::CommandRecorder &recorder, uint32_t slot) const
 {
-    recorder.bufferUpload(generationInputsStaging, generationInputsBuffer, sizeof(VolumeGenerationInputs));
+    recorder.bufferUpload(generationInputsStaging.buffer(slot), generationInputsBuffer, sizeof(VolumeGenerationInputs));
+    // the tiles and the volumes in use, then the references; the rest of the buffer is never read
+    auto [volumes, references] = localFogUpload();
+    recorder.bufferUpload(localFogStaging.buffer(slot), localFogBuffer, LocalFogBins::VOLUMES_OFFSET + volumes * sizeof(GpuLocalFogVolume));
+    recorder.bufferUpload(localFogStaging.buffer(slot), localFogBuffer, references * sizeof(uint32_t), LocalFogBins::REFERENCES_OFFSET, LocalFogBins::REFERENCES_OFFSET);
 }
 
-void FogVolumeGenerationPass::execute(tga::CommandRecorder &recorder, uint32_t nf) const
+void FogVolumeGenerationPass::generate(tga::CommandRecorder &recorder, uint32_t nf) const
 {
     recorder.setComputePass(cp);
     recorder.bindInputSet(generationInputs[nf % 2]);
-    recorder.dispatch(ceilDiv(resolution[0], 4u) , ceilDiv(resolution[1], 4u), ceilDiv(resolution[2], 4u));
+    recorder.dispatch(ceilDiv(m_grid.resolution[0], 4u) , ceilDiv(m_grid.resolution[1], 4u), ceilDiv(m_grid.resolution[2], 4u));
+}
 
-    recorder.barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::ComputeShader);
+void FogVolumeGenerationPass::raymarch(tga::CommandRecorder &recorder, uint32_t nf) const
+{
     recorder.setComputePass(accCp);
     recorder.bindInputSet(accumulationInputs[nf % 2]);
-    recorder.dispatch(ceilDiv(resolution[0], 4u) , ceilDiv(resolution[1], 4u), 1);
+    recorder.dispatch(ceilDiv(m_grid.resolution[0], 4u) , ceilDiv(m_grid.resolution[1], 4u), 1);
 }
 
 tga::Buffer FogVolumeGenerationPass::inputBuffer() const
@@ -118,3 +240,43 @@ tga::Texture FogVolumeGenerationPass::scatteringVolume() const
 {
     return m_scatteringVolume;
 }
+
+tga::Texture FogVolumeGenerationPass::scatteringAlphaVolume() const
+{
+    return m_precision == FogPrecision::packed ? m_scatteringAlphaVolume : m_scatteringVolume;
+}
+
+tga::Texture FogVolumeGenerationPass::lightingVolume(uint32_t nf) const
+{
+    return lightingVolumes[nf % 2];
+}
+
+tga::Texture FogVolumeGenerationPass::lightingAlphaVolume(uint32_t nf) const
+{
+    return m_precision == FogPrecision::packed ? lightingAlphaVolumes[nf % 2] : lightingVolumes[nf % 2];
+}
+
+FogPrecision FogVolumeGenerationPass::precision() const
+{
+    return m_precision;
+}
+
+std::array<uint32_t, 3> FogVolumeGenerationPass::volumeResolution() const
+{
+    return m_grid.resolution;
+}
+
+const FogGrid &FogVolumeGenerationPass::grid() const
+{
+    return m_grid;
+}
+
+const FogVolumeGenerationPass::VolumeGenerationInputs &FogVolumeGenerationPass::inputs() const
+{
+    return generationInputsData;
+}
+
+const NoiseVolume &FogVolumeGenerationPass::noiseVolume() const
+{
+    return *noise;
+}
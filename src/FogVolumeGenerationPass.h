@@ -1,56 +1,95 @@
 #pragma once
+#include <array>
 #include <chrono>
 #include <optional>
 
 #include "tga/tga.hpp"
+#include "FogInputs.h"
+#include "LocalFogVolumes.h"
+#include "NoiseVolume.h"
 #include "Scene.h"
 #include "ShadowPass.h"
+#include "SlotStaging.h"
 
 class FogVolumeGenerationPass {
 public:
-    FogVolumeGenerationPass(tga::Interface &tgai, std::array<uint32_t, 3> resolution, const ShadowPass &sp);
+    typedef FogInputs VolumeGenerationInputs;
+
+    /* the scattering volume is only written and read within a frame, the caller creates it from these and keeps it.
+       With FogPrecision::packed, its alpha channel needs another volume from alphaVolumeInfo() */
+    static tga::TextureInfo volumeInfo(std::array<uint32_t, 3> resolution, FogPrecision precision);
+    static tga::TextureInfo alphaVolumeInfo(std::array<uint32_t, 3> resolution);
+
+    /* slots: frames in flight, see SlotStaging. The noise volume is uploaded and must outlive the pass, the CPU reference
+       samples it for the parity check. lightBuffer holds the clustered point lights, see Scene::lightBuffer() */
+    FogVolumeGenerationPass(tga::Interface &tgai, const FogGrid &grid, FogPrecision precision, const ShadowPass &sp, const NoiseVolume &noise, uint32_t slots,
+                            tga::Buffer lightBuffer, tga::Texture scatteringVolume, tga::Texture scatteringAlphaVolume = {});
     ~FogVolumeGenerationPass();
     FogVolumeGenerationPass(const FogVolumeGenerationPass &) = delete;
     FogVolumeGenerationPass &operator=(const FogVolumeGenerationPass &) = delete;
 
-    void update(const Scene &scene, uint32_t nf, float historyFactor, float density, float constantDensity, float anisotropy, float absorption, float height, bool noise, float skyBlendRatio);
-    void upload(tga::CommandRecorder &recorder) const;
-    void execute(tga::CommandRecorder &recorder, uint32_t nf) const;
+    /* A new resolution recreates the lighting volumes and their input sets, the scattering volumes passed must have
+       it too. No command buffer recorded before may be pending or executed again then. Range and exponent only
+       change the inputs; either way the next frame starts without history */
+    void setGrid(const FogGrid &grid, tga::Texture scatteringVolume, tga::Texture scatteringAlphaVolume = {});
+    const FogGrid &grid() const;
+    /* seconds since start driving the noise animation instead of the wall clock, for reproducible runs; std::nullopt
+       goes back to the wall clock */
+    void setTime(std::optional<double> seconds);
+    /* takes effect with the next update(); froxels without history are lit whatever their turn */
+    void setInterleave(const FogInterleave &interleave);
+    const FogInterleave &interleave() const;
+    /* the local fog volumes, binned against the camera with every update() */
+    void setLocalVolumes(const std::vector<LocalFogVolume> &volumes);
+    const LocalFogBins &localFog() const;
+    /* volumes and references of the local fog buffer that upload() copies; a command buffer recorded for other
+       ones must be recorded again */
+    std::array<size_t, 2> localFogUpload() const;
+    /* writes the inputs of frame frameNumber into the staging slot of the frame being built */
+    void update(const Scene &scene, uint32_t frameNumber, uint32_t slot, float historyFactor, float density, float constantDensity, float anisotropy, float absorption, float height, bool noise, float skyBlendRatio);
+    void upload(tga::CommandRecorder &recorder, uint32_t slot) const;
+    /* in-scattering and extinction per froxel, into lightingVolume(nf) */
+    void generate(tga::CommandRecorder &recorder, uint32_t nf) const;
+    /* integrates lightingVolume(nf) along the view rays into the scattering volume */
+    void raymarch(tga::CommandRecorder &recorder, uint32_t nf) const;
     tga::Buffer inputBuffer() const;
     tga::Texture scatteringVolume() const;
+    /* the transmittance with FogPrecision::packed, otherwise scatteringVolume() which keeps it in alpha */
+    tga::Texture scatteringAlphaVolume() const;
+    /* volume written by the generation pass when recording with backbuffer nf; the other one is its history */
+    tga::Texture lightingVolume(uint32_t nf) const;
+    /* the extinction of lightingVolume(nf) with FogPrecision::packed, otherwise lightingVolume(nf) */
+    tga::Texture lightingAlphaVolume(uint32_t nf) const;
+    FogPrecision precision() const;
+    std::array<uint32_t, 3> volumeResolution() const;
+    const VolumeGenerationInputs &inputs() const;
+    const NoiseVolume &noiseVolume() const;
 private:
-    struct VolumeGenerationInputs {
-        alignas(16) std::array<uint32_t, 3> resolution;
-        alignas(16) glm::vec3 cameraPos;
-        alignas(16) glm::vec3 cameraXAxis;
-        alignas(16) glm::vec3 cameraYAxis;
-        alignas(16) glm::vec3 cameraZAxis;
-        alignas(4)  float zNear;
-        alignas(4)  float zFar;
-        alignas(16) glm::mat4 prevFrameVP;
-        alignas(16) DirLight dirLight;
-        alignas(4) float time;
-        alignas(4) int frameNumber;
-        alignas(4) float historyFactor;
-        alignas(4) float density;
-        alignas(4) float constantDensity;
-        alignas(4) float anisotropy;
-        alignas(4) float absorptionFactor;
-        alignas(4) float height;
-        alignas(4) bool noise;
-        alignas(4) float skyBlendRatio;
-    };
+    void createVolumes();
+    void freeVolumes();
 
     tga::Interface *tgai;
+    const ShadowPass *sp;
+    const NoiseVolume *noise;
     std::chrono::system_clock::time_point startTime;
+    std::optional<double> fixedTime;
+    FogInterleave m_interleave;
     tga::ComputePass cp;
     tga::ComputePass accCp;
-    std::array<uint32_t, 3> resolution;
+    FogGrid m_grid;
+    FogPrecision m_precision;
     std::array<tga::Texture, 2> lightingVolumes;
+    /* only with FogPrecision::packed */
+    std::array<tga::Texture, 2> lightingAlphaVolumes;
     tga::Texture m_scatteringVolume;
-    tga::Texture perlinNoise;
-    tga::StagingBuffer generationInputsStaging;
-    VolumeGenerationInputs *generationInputsData;
+    tga::Texture m_scatteringAlphaVolume;
+    tga::Texture noiseTexture;
+    tga::Buffer lightBuffer;
+    LocalFogBins m_localFog;
+    SlotStaging localFogStaging;
+    tga::Buffer localFogBuffer;
+    SlotStaging generationInputsStaging;
+    VolumeGenerationInputs generationInputsData{};
     tga::Buffer generationInputsBuffer;
     std::array<tga::InputSet, 2> generationInputs;
     std::array<tga::InputSet, 2> accumulationInputs;
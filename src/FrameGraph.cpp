@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <unordered_set>
+
+#include "FrameGraph.h"
+
+namespace {
+
+const char *stageName(tga::PipelineStage stage)
+{
+    switch(stage) {
+        case tga::PipelineStage::TopOfPipe: return "TopOfPipe";
+        case tga::PipelineStage::DrawIndirect: return "DrawIndirect";
+        case tga::PipelineStage::VertexInput: return "VertexInput";
+        case tga::PipelineStage::VertexShader: return "VertexShader";
+        case tga::PipelineStage::FragmentShader: return "FragmentShader";
+        case tga::PipelineStage::EarlyFragmentTests: return "EarlyFragmentTests";
+        case tga::PipelineStage::LateFragmentTests: return "LateFragmentTests";
+        case tga::PipelineStage::ColorAttachmentOutput: return "ColorAttachmentOutput";
+        case tga::PipelineStage::ComputeShader: return "ComputeShader";
+        case tga::PipelineStage::Transfer: return "Transfer";
+        case tga::PipelineStage::BottomOfPipe: return "BottomOfPipe";
+    }
+    return "?";
+}
+
+/* render passes order the accesses to their attachments themselves */
+bool isAttachmentStage(tga::PipelineStage stage)
+{
+    return stage == tga::PipelineStage::ColorAttachmentOutput || stage == tga::PipelineStage::EarlyFragmentTests
+        || stage == tga::PipelineStage::LateFragmentTests;
+}
+
+bool sameDescription(const tga::TextureInfo &a, const tga::TextureInfo &b)
+{
+    return a.width == b.width && a.height == b.height && a.format == b.format && a.samplerMode == b.samplerMode
+        && a.addressMode == b.addressMode && a.textureType == b.textureType && a.depthLayers == b.depthLayers
+        && a.borderColor == b.borderColor;
+}
+
+double mib(size_t bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+}
+
+FrameGraph::PassBuilder &FrameGraph::PassBuilder::read(Resource resource, tga::PipelineStage stage)
+{
+    graph->passes[pass].accesses.push_back({ resource, stage, false });
+    return *this;
+}
+
+FrameGraph::PassBuilder &FrameGraph::PassBuilder::write(Resource resource, tga::PipelineStage stage)
+{
+    graph->passes[pass].accesses.push_back({ resource, stage, true });
+    return *this;
+}
+
+FrameGraph::FrameGraph(tga::Interface &tgai) : tgai{&tgai} {}
+
+FrameGraph::~FrameGraph()
+{
+    for(PhysicalTexture &physical : physicalTextures) {
+        tgai->free(physical.texture);
+    }
+}
+
+FrameGraph::Resource FrameGraph::importResource(std::string name)
+{
+    resources.push_back({ .name = std::move(name), .transient = false });
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+FrameGraph::Resource FrameGraph::createTexture(std::string name, const tga::TextureInfo &info, size_t bytes)
+{
+    resources.push_back({ .name = std::move(name), .transient = true, .info = info, .bytes = bytes });
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+FrameGraph::PassBuilder FrameGraph::addPass(std::string name)
+{
+    PassNode pass;
+    pass.name = std::move(name);
+    passes.push_back(std::move(pass));
+    return PassBuilder{*this, static_cast<Pass>(passes.size() - 1)};
+}
+
+void FrameGraph::setTextureInfo(Resource resource, const tga::TextureInfo &info, size_t bytes)
+{
+    resources[resource].info = info;
+    resources[resource].bytes = bytes;
+}
+
+void FrameGraph::setExecute(Pass pass, Execute execute)
+{
+    passes[pass].execute = std::move(execute);
+}
+
+void FrameGraph::markOutput(Resource resource)
+{
+    resources[resource].output = true;
+}
+
+void FrameGraph::compile()
+{
+    cull();
+    placeBarriers();
+    allocate();
+}
+
+void FrameGraph::cull()
+{
+    // backwards from the outputs: a pass is needed if it writes what a needed pass reads
+    std::vector<bool> needed(resources.size());
+    for(size_t r = 0; r < resources.size(); ++r) {
+        needed[r] = resources[r].output;
+    }
+    for(size_t p = passes.size(); p-- > 0;) {
+        PassNode &pass = passes[p];
+        pass.kept = std::any_of(pass.accesses.begin(), pass.accesses.end(), [&](const Access &a) { return a.write && needed[a.resource]; });
+        if(pass.kept) {
+            for(const Access &access : pass.accesses) {
+                needed[access.resource] = needed[access.resource] || !access.write;
+            }
+        }
+    }
+}
+
+void FrameGraph::placeBarriers()
+{
+    struct Use {
+        size_t pass;
+        tga::PipelineStage stage;
+    };
+    struct State {
+        std::vector<Use> writes;
+        std::vector<Use> reads;
+    };
+    struct Placed {
+        Barrier barrier;
+        size_t position;
+    };
+    std::vector<State> states(resources.size());
+    std::vector<Placed> placed;
+    // positions count on through the second frame
+    auto require = [&](const Use &producer, tga::PipelineStage dst, size_t consumer) {
+        if(producer.pass == consumer || (isAttachmentStage(producer.stage) && isAttachmentStage(dst))) {
+            return;
+        }
+        // an equal barrier between the producer and this pass already orders them
+        bool covered = std::any_of(placed.begin(), placed.end(), [&](const Placed &p) {
+            return p.barrier.src == producer.stage && p.barrier.dst == dst && p.position > producer.pass && p.position <= consumer;
+        });
+        if(!covered) {
+            placed.push_back({ { producer.stage, dst }, consumer });
+            passes[consumer % passes.size()].barriers.push_back({ producer.stage, dst });
+        }
+    };
+
+    // Frames are not waited for before the next one is submitted, so a frame's first accesses also have to wait for
+    // the previous frame's last ones. The passes are walked twice with the states carried over; a barrier orders
+    // against everything submitted before it, so those of the second frame are the ones recorded
+    for(size_t i = 0; i < 2 * passes.size(); ++i) {
+        size_t p = i % passes.size();
+        PassNode &pass = passes[p];
+        if(p == 0) {
+            for(PassNode &node : passes) {
+                node.barriers.clear();
+            }
+        }
+        if(!pass.kept) {
+            continue;
+        }
+        for(const Access &access : pass.accesses) {
+            State &state = states[access.resource];
+            if(!access.write) {
+                // read after write
+                for(const Use &write : state.writes) {
+                    require(write, access.stage, i);
+                }
+            } else if(!state.reads.empty()) {
+                // write after read, the readers only have to finish
+                for(const Use &read : state.reads) {
+                    require(read, access.stage, i);
+                }
+            } else {
+                for(const Use &write : state.writes) {
+                    require(write, access.stage, i);
+                }
+            }
+        }
+        for(const Access &access : pass.accesses) {
+            if(!access.write) {
+                states[access.resource].reads.push_back({ i, access.stage });
+            }
+        }
+        // a pass may write one resource at several stages, later accesses wait for all of them
+        std::unordered_set<Resource> written;
+        for(const Access &access : pass.accesses) {
+            if(access.write) {
+                State &state = states[access.resource];
+                if(written.insert(access.resource).second) {
+                    state.writes.clear();
+                    state.reads.clear();
+                }
+                state.writes.push_back({ i, access.stage });
+            }
+        }
+    }
+}
+
+void FrameGraph::allocate()
+{
+    // recompiling hands out the textures of unchanged descriptions again, so whoever holds them may keep them
+    std::vector<PhysicalTexture> previous = std::move(physicalTextures);
+    physicalTextures.clear();
+    for(ResourceNode &resource : resources) {
+        resource.firstUse = SIZE_MAX;
+        resource.lastUse = 0;
+        resource.physical = SIZE_MAX;
+    }
+    for(size_t p = 0; p < passes.size(); ++p) {
+        if(!passes[p].kept) {
+            continue;
+        }
+        for(const Access &access : passes[p].accesses) {
+            ResourceNode &resource = resources[access.resource];
+            resource.firstUse = std::min(resource.firstUse, p);
+            resource.lastUse = std::max(resource.lastUse, p);
+        }
+    }
+
+    // only transients of culled passes go without a texture
+    for(ResourceNode &resource : resources) {
+        if(!resource.transient || resource.firstUse == SIZE_MAX) {
+            continue;
+        }
+        resource.physical = physicalTextures.size();
+        auto reused = std::find_if(previous.begin(), previous.end(), [&](const PhysicalTexture &p) { return sameDescription(p.info, resource.info); });
+        tga::Texture texture;
+        if(reused != previous.end()) {
+            texture = reused->texture;
+            previous.erase(reused);
+        } else {
+            texture = tgai->createTexture(resource.info);
+        }
+        physicalTextures.push_back({ texture, resource.info, resource.bytes });
+    }
+    for(PhysicalTexture &physical : previous) {
+        tgai->free(physical.texture);
+    }
+}
+
+tga::Texture FrameGraph::texture(Resource resource) const
+{
+    size_t physical = resources[resource].physical;
+    return physical < physicalTextures.size() ? physicalTextures[physical].texture : tga::Texture{};
+}
+
+void FrameGraph::execute(tga::CommandRecorder &recorder, uint32_t nf) const
+{
+    for(const PassNode &pass : passes) {
+        if(!pass.kept) {
+            continue;
+        }
+        if(!pass.barriers.empty()) {
+            // barriers go between render passes, not into one
+            recorder.setRenderPass(tga::RenderPass{nullptr}, nf);
+            for(const Barrier &barrier : pass.barriers) {
+                recorder.barrier(barrier.src, barrier.dst);
+            }
+        }
+        if(pass.execute) {
+            pass.execute(recorder, nf);
+        }
+    }
+}
+
+void FrameGraph::executeAlone(tga::CommandRecorder &recorder, Pass pass, uint32_t nf, uint32_t repeats) const
+{
+    const PassNode &node = passes[pass];
+    std::vector<Barrier> barriers;
+    for(const Access &write : node.accesses) {
+        for(const Access &access : node.accesses) {
+            Barrier barrier{ write.stage, access.stage };
+            bool known = std::any_of(barriers.begin(), barriers.end(), [&](const Barrier &b) { return b.src == barrier.src && b.dst == barrier.dst; });
+            if(write.write && !known) {
+                barriers.push_back(barrier);
+            }
+        }
+    }
+    for(uint32_t r = 0; r < repeats; ++r) {
+        recorder.setRenderPass(tga::RenderPass{nullptr}, nf);
+        for(const Barrier &barrier : barriers) {
+            recorder.barrier(barrier.src, barrier.dst);
+        }
+        if(node.execute) {
+            node.execute(recorder, nf);
+        }
+    }
+}
+
+size_t FrameGraph::passCount() const
+{
+    return passes.size();
+}
+
+const std::string &FrameGraph::passName(Pass pass) const
+{
+    return passes[pass].name;
+}
+
+bool FrameGraph::isKept(Pass pass) const
+{
+    return passes[pass].kept;
+}
+
+std::string FrameGraph::dump() const
+{
+    std::ostringstream out;
+    size_t kept = 0, barriers = 0;
+    for(const PassNode &pass : passes) {
+        kept += pass.kept;
+        barriers += pass.barriers.size();
+    }
+    out << "[FrameGraph] " << passes.size() << " passes, " << passes.size() - kept << " culled, " << barriers << " barriers\n";
+    for(size_t p = 0; p < passes.size(); ++p) {
+        const PassNode &pass = passes[p];
+        for(const Barrier &barrier : pass.barriers) {
+            out << "[FrameGraph]      barrier " << stageName(barrier.src) << " -> " << stageName(barrier.dst) << "\n";
+        }
+        out << "[FrameGraph]   " << p << " " << pass.name << (pass.kept ? "" : " (culled)");
+        const char *separator = ": ";
+        for(const Access &access : pass.accesses) {
+            out << separator << (access.write ? "writes " : "reads ") << resources[access.resource].name << "@" << stageName(access.stage);
+            separator = ", ";
+        }
+        out << "\n";
+    }
+    size_t virtualBytes = 0, physicalBytes = 0, transients = 0;
+    char line[256];
+    for(const ResourceNode &resource : resources) {
+        if(!resource.transient) {
+            continue;
+        }
+        transients++;
+        virtualBytes += resource.bytes;
+        if(resource.physical == SIZE_MAX) {
+            std::snprintf(line, sizeof(line), "[FrameGraph] transient %s: unused, %.2f MiB not allocated\n", resource.name.c_str(), mib(resource.bytes));
+        } else {
+            std::snprintf(line, sizeof(line), "[FrameGraph] transient %s: passes %zu-%zu, %.2f MiB, texture %zu\n",
+                resource.name.c_str(), resource.firstUse, resource.lastUse, mib(resource.bytes), resource.physical);
+        }
+        out << line;
+    }
+    for(const PhysicalTexture &physical : physicalTextures) {
+        physicalBytes += physical.bytes;
+    }
+    std::snprintf(line, sizeof(line), "[FrameGraph] transient textures: %zu of %zu allocated, %.2f MiB of %.2f MiB\n",
+        physicalTextures.size(), transients, mib(physicalBytes), mib(virtualBytes));
+    out << line;
+    return out.str();
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tga/tga.hpp"
+
+/*
+ * The passes of a frame with the resources they read and write, at the pipeline stage they access them. Passes run
+ * in the order they are added. compile() drops passes that contribute nothing to a marked output, places the
+ * barriers between the remaining accesses, including those of the previous frame which may still be in flight, and
+ * creates the transient textures that a kept pass uses. TGA allocates each texture its own memory, so transients are
+ * not aliased.
+ *
+ * Resources are declared before the passes that use them exist, so the passes can be handed the graph's textures
+ * on construction; what each pass records is attached with setExecute() afterwards.
+ */
+class FrameGraph {
+public:
+    typedef uint32_t Resource;
+    typedef uint32_t Pass;
+    typedef std::function<void(tga::CommandRecorder &recorder, uint32_t nf)> Execute;
+
+    class PassBuilder {
+    public:
+        PassBuilder &read(Resource resource, tga::PipelineStage stage);
+        PassBuilder &write(Resource resource, tga::PipelineStage stage);
+        operator Pass() const { return pass; }
+
+    private:
+        friend class FrameGraph;
+        PassBuilder(FrameGraph &graph, Pass pass) : graph{&graph}, pass{pass} {}
+        FrameGraph *graph;
+        Pass pass;
+    };
+
+    explicit FrameGraph(tga::Interface &tgai);
+    ~FrameGraph();
+    FrameGraph(const FrameGraph &) = delete;
+    FrameGraph &operator=(const FrameGraph &) = delete;
+
+    /* owned elsewhere and kept across frames, like histories, buffers and the backbuffer */
+    Resource importResource(std::string name);
+    /* created by compile(), its contents only live from the first write to the last read of a frame */
+    Resource createTexture(std::string name, const tga::TextureInfo &info, size_t bytes);
+    /* takes effect with the next compile(), which recreates only the textures whose description changed */
+    void setTextureInfo(Resource resource, const tga::TextureInfo &info, size_t bytes);
+    PassBuilder addPass(std::string name);
+    void setExecute(Pass pass, Execute execute);
+    /* passes whose writes do not reach an output, directly or through other passes, are dropped */
+    void markOutput(Resource resource);
+
+    void compile();
+    /* the texture of a transient, valid after compile() */
+    tga::Texture texture(Resource resource) const;
+    /* records the kept passes with their barriers */
+    void execute(tga::CommandRecorder &recorder, uint32_t nf) const;
+    /* records one pass repeatedly without the others, ordering each repetition after the previous one's writes. For
+       timing it in isolation, its inputs are whatever the last frame left */
+    void executeAlone(tga::CommandRecorder &recorder, Pass pass, uint32_t nf, uint32_t repeats) const;
+    size_t passCount() const;
+    const std::string &passName(Pass pass) const;
+    bool isKept(Pass pass) const;
+    /* passes in order with their barriers, the lifetimes of transients and the memory they take */
+    std::string dump() const;
+
+private:
+    struct Access {
+        Resource resource;
+        tga::PipelineStage stage;
+        bool write;
+    };
+    struct Barrier {
+        tga::PipelineStage src;
+        tga::PipelineStage dst;
+    };
+    struct PassNode {
+        std::string name;
+        std::vector<Access> accesses;
+        Execute execute;
+        bool kept = false;
+        /* recorded before the pass */
+        std::vector<Barrier> barriers;
+    };
+    struct ResourceNode {
+        std::string name;
+        bool transient;
+        bool output = false;
+        tga::TextureInfo info{ 0, 0, tga::Format::undefined };
+        size_t bytes = 0;
+        /* first and last kept pass using a transient, and its texture */
+        size_t firstUse = SIZE_MAX;
+        size_t lastUse = 0;
+        size_t physical = SIZE_MAX;
+    };
+    struct PhysicalTexture {
+        tga::Texture texture;
+        tga::TextureInfo info;
+        size_t bytes;
+    };
+
+    void cull();
+    void placeBarriers();
+    void allocate();
+
+    tga::Interface *tgai;
+    std::vector<PassNode> passes;
+    std::vector<ResourceNode> resources;
+    std::vector<PhysicalTexture> physicalTextures;
+};
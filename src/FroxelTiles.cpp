@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "FroxelTiles.h"
+#include "parallel.h"
+
+namespace {
+
+typedef std::chrono::high_resolution_clock clock;
+typedef std::chrono::duration<double, std::milli> duration;
+
+/* the tiles a sphere touches in one slab of tiles along z */
+struct Span {
+    uint32_t sphere;
+    uint32_t x0, x1;
+    uint32_t y0, y1;
+};
+
+constexpr size_t SPHERE_GRAIN = 64;
+
+uint32_t froxelTile(uint32_t froxel, uint32_t resolution)
+{
+    return std::min(froxel * FROXEL_TILES / resolution, FROXEL_TILES - 1);
+}
+
+template<typename F>
+void forEachTile(uint32_t slab, const Span &span, F &&fn)
+{
+    for(uint32_t y = span.y0; y <= span.y1; ++y) {
+        for(uint32_t x = span.x0; x <= span.x1; ++x) {
+            fn((slab * FROXEL_TILES + y) * FROXEL_TILES + x);
+        }
+    }
+}
+
+}
+
+void FroxelTileLists::bin(const FroxelFrustum &frustum, const std::vector<glm::vec4> &spheres, uint32_t maxReferences, bool openFar)
+{
+    clock::time_point start = clock::now();
+    resolution = frustum.resolution;
+    this->maxReferences = maxReferences;
+    // a froxel's jittered samples stay inside it, so the froxels a sphere's extent maps into are all that can see it
+    const float lengthX = glm::length(frustum.xAxis), lengthY = glm::length(frustum.yAxis);
+    const glm::vec3 dirX = frustum.xAxis / lengthX, dirY = frustum.yAxis / lengthY;
+    const float resZ = static_cast<float>(resolution[2]);
+    // froxel coordinate along z, slice boundaries at integers, to the distance along the view axis and back
+    auto distance = [&](float u) { return frustum.zNear + std::pow(u / resZ, frustum.depthExponent) * frustum.range; };
+    auto slice = [&](float s) { return resZ * std::pow(std::max(s - frustum.zNear, 0.0f) / frustum.range, 1.0f / frustum.depthExponent); };
+    // range of froxels covering [lo, hi] of ndc along an axis, false if none does
+    auto froxels = [](float lo, float hi, uint32_t res, uint32_t &first, uint32_t &last) {
+        float u0 = (lo + 1.0f) * 0.5f * res, u1 = (hi + 1.0f) * 0.5f * res;
+        if(u1 < 0.0f || u0 > static_cast<float>(res)) {
+            return false;
+        }
+        first = static_cast<uint32_t>(std::max(u0, 0.0f));
+        last = std::min(static_cast<uint32_t>(std::min(std::max(u1, 0.0f), static_cast<float>(res))), res - 1);
+        return true;
+    };
+
+    // each chunk of spheres sorts its spans by slab, so the slabs can be counted and filled independently and
+    // still list their spheres in order
+    std::vector<std::array<std::vector<Span>, FROXEL_TILES>> chunkSpans((spheres.size() + SPHERE_GRAIN - 1) / SPHERE_GRAIN);
+    parallelFor(spheres.size(), SPHERE_GRAIN, [&](size_t begin, size_t end) {
+        std::array<std::vector<Span>, FROXEL_TILES> &slabs = chunkSpans[begin / SPHERE_GRAIN];
+        for(size_t i = begin; i < end; ++i) {
+            glm::vec3 offset = glm::vec3(spheres[i]) - frustum.position;
+            float radius = spheres[i].w;
+            float center = glm::dot(offset, frustum.zAxis);
+            float nearest = center - radius, farthest = center + radius;
+            if(farthest <= frustum.zNear || (!openFar && slice(nearest) >= resZ)) {
+                continue;
+            }
+            uint32_t sliceFirst = static_cast<uint32_t>(std::min(slice(nearest), resZ - 1.0f));
+            uint32_t sliceLast = static_cast<uint32_t>(std::min(slice(farthest), resZ - 1.0f));
+            float centerX = glm::dot(offset, dirX), centerY = glm::dot(offset, dirY);
+            for(uint32_t slab = froxelTile(sliceFirst, resolution[2]); slab <= froxelTile(sliceLast, resolution[2]); ++slab) {
+                // the slab's slices, clipped to the sphere's; ndc of a point is its offset along an axis over the distance
+                float slabNear = distance(static_cast<float>((slab * resolution[2] + FROXEL_TILES - 1) / FROXEL_TILES));
+                float slabFar = openFar && slab == FROXEL_TILES - 1
+                    ? farthest : distance(static_cast<float>(((slab + 1) * resolution[2] + FROXEL_TILES - 1) / FROXEL_TILES));
+                float s0 = std::max(nearest, slabNear), s1 = std::min(farthest, slabFar);
+                if(s0 > s1) {
+                    continue;
+                }
+                float x[4] = { (centerX - radius) / (lengthX * s0), (centerX - radius) / (lengthX * s1), (centerX + radius) / (lengthX * s0), (centerX + radius) / (lengthX * s1) };
+                float y[4] = { (centerY - radius) / (lengthY * s0), (centerY - radius) / (lengthY * s1), (centerY + radius) / (lengthY * s0), (centerY + radius) / (lengthY * s1) };
+                Span span{ static_cast<uint32_t>(i), 0, 0, 0, 0 };
+                uint32_t first, last;
+                if(!froxels(*std::min_element(x, x + 4), *std::max_element(x, x + 4), resolution[0], first, last)) {
+                    continue;
+                }
+                span.x0 = froxelTile(first, resolution[0]);
+                span.x1 = froxelTile(last, resolution[0]);
+                if(!froxels(*std::min_element(y, y + 4), *std::max_element(y, y + 4), resolution[1], first, last)) {
+                    continue;
+                }
+                span.y0 = froxelTile(first, resolution[1]);
+                span.y1 = froxelTile(last, resolution[1]);
+                slabs[slab].push_back(span);
+            }
+        }
+    });
+
+    // count per slab, then hand out ranges of the reference list in tile order, then fill them in sphere order
+    std::array<size_t, FROXEL_TILES> wanted{};
+    parallelFor(FROXEL_TILES, 1, [&](size_t begin, size_t end) {
+        for(size_t slab = begin; slab < end; ++slab) {
+            std::fill(m_tiles.begin() + slab * FROXEL_TILES * FROXEL_TILES, m_tiles.begin() + (slab + 1) * FROXEL_TILES * FROXEL_TILES, std::array<uint32_t, 2>{ 0, 0 });
+            for(const auto &slabs : chunkSpans) {
+                for(const Span &span : slabs[slab]) {
+                    forEachTile(static_cast<uint32_t>(slab), span, [&](uint32_t tile) { m_tiles[tile][1]++; wanted[slab]++; });
+                }
+            }
+        }
+    });
+    uint32_t offset = 0;
+    for(auto &tile : m_tiles) {
+        tile[0] = offset;
+        tile[1] = std::min(tile[1], maxReferences - offset);
+        offset += tile[1];
+    }
+    dropped = 0;
+    for(size_t count : wanted) {
+        dropped += count;
+    }
+    dropped -= offset;
+    m_references.resize(offset);
+    parallelFor(FROXEL_TILES, 1, [&](size_t begin, size_t end) {
+        for(size_t slab = begin; slab < end; ++slab) {
+            std::vector<uint32_t> filled(FROXEL_TILES * FROXEL_TILES, 0);
+            const uint32_t firstTile = static_cast<uint32_t>(slab * FROXEL_TILES * FROXEL_TILES);
+            for(const auto &slabs : chunkSpans) {
+                for(const Span &span : slabs[slab]) {
+                    forEachTile(static_cast<uint32_t>(slab), span, [&](uint32_t tile) {
+                        uint32_t &count = filled[tile - firstTile];
+                        if(count < m_tiles[tile][1]) {
+                            m_references[m_tiles[tile][0] + count++] = span.sphere;
+                        }
+                    });
+                }
+            }
+        }
+    });
+    m_binMillis = duration(clock::now() - start).count();
+}
+
+uint32_t FroxelTileLists::tileOf(uint32_t x, uint32_t y, uint32_t z) const
+{
+    return (froxelTile(z, resolution[2]) * FROXEL_TILES + froxelTile(y, resolution[1])) * FROXEL_TILES + froxelTile(x, resolution[0]);
+}
+
+const std::vector<std::array<uint32_t, 2>> &FroxelTileLists::tiles() const
+{
+    return m_tiles;
+}
+
+const std::vector<uint32_t> &FroxelTileLists::references() const
+{
+    return m_references;
+}
+
+size_t FroxelTileLists::droppedReferences() const
+{
+    return dropped;
+}
+
+uint32_t FroxelTileLists::uploadReferences() const
+{
+    uint32_t count = 1024;
+    while(count < m_references.size()) {
+        count *= 2;
+    }
+    return std::min(count, maxReferences);
+}
+
+double FroxelTileLists::binMillis() const
+{
+    return m_binMillis;
+}
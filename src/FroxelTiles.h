@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/*
+ * Lists of spheres per tile of the froxel grid, built on the CPU every frame. A tile is a block of froxels, 16 along
+ * each axis of the grid, so it follows the grid's exponential depth slicing. Shaders look up the list of their
+ * froxel's tile, see froxel_tiles.h, and only visit the spheres that overlap it.
+ */
+constexpr uint32_t FROXEL_TILES = 16;
+constexpr uint32_t FROXEL_TILE_COUNT = FROXEL_TILES * FROXEL_TILES * FROXEL_TILES;
+
+/* the froxel grid in world space, as FogInputs describes it */
+struct FroxelFrustum {
+    glm::vec3 position;
+    glm::vec3 xAxis;
+    glm::vec3 yAxis;
+    glm::vec3 zAxis;
+    float zNear;
+    std::array<uint32_t, 3> resolution;
+    float range;
+    float depthExponent;
+};
+
+class FroxelTileLists {
+public:
+    /* Bins spheres, xyz centre and w radius, on all cores; references past maxReferences are dropped. With openFar,
+       the last slab of tiles reaches on past the fog range, for surfaces behind it */
+    void bin(const FroxelFrustum &frustum, const std::vector<glm::vec4> &spheres, uint32_t maxReferences, bool openFar);
+
+    /* the tile of a froxel of the grid last binned for */
+    uint32_t tileOf(uint32_t x, uint32_t y, uint32_t z) const;
+    /* first reference and count per tile, x-major */
+    const std::vector<std::array<uint32_t, 2>> &tiles() const;
+    /* sphere indices, in sphere order within a tile */
+    const std::vector<uint32_t> &references() const;
+    size_t droppedReferences() const;
+    /* the references an upload covers: their count rounded up to a power of two, so a recorded copy stays valid
+       while the count changes a little from frame to frame */
+    uint32_t uploadReferences() const;
+    double binMillis() const;
+
+    static constexpr size_t TILES_BYTES = FROXEL_TILE_COUNT * sizeof(std::array<uint32_t, 2>);
+
+private:
+    std::array<uint32_t, 3> resolution = { 1, 1, 1 };
+    uint32_t maxReferences = 0;
+    std::vector<std::array<uint32_t, 2>> m_tiles = std::vector<std::array<uint32_t, 2>>(FROXEL_TILE_COUNT);
+    std::vector<uint32_t> m_references;
+    size_t dropped = 0;
+    double m_binMillis = 0.0;
+};
@@ -0,0 +1,99 @@
+#include <cstring>
+
+#include "tga/tga_utils.hpp"
+
+#include "InstanceTransforms.h"
+#include "util.h"
+
+namespace {
+
+constexpr uint32_t SCATTER_GROUP_SIZE = 64;
+
+}
+
+tga::ComputePass InstanceTransforms::createScatterPass(tga::Interface &tgai)
+{
+    auto shader = tga::loadShader("../shaders/scatter_transforms_comp.spv", tga::ShaderType::compute, tgai);
+    tga::ComputePass pass = tgai.createComputePass({ shader, tga::InputLayout{ { tga::BindingType::storageBuffer, tga::BindingType::storageBuffer } } });
+    tgai.free(shader);
+    return pass;
+}
+
+InstanceTransforms::InstanceTransforms(tga::Interface &tgai, tga::ComputePass scatterPass, std::vector<glm::mat4> initial, uint32_t slots)
+    : tgai{&tgai}, scatterPass{scatterPass}, transforms{std::move(initial)}, isDirty(transforms.size(), false) {
+    size_t size = transforms.size() * sizeof(glm::mat4);
+    tga::StagingBuffer initialStaging = tgai.createStagingBuffer({ size, reinterpret_cast<const uint8_t*>(transforms.data()) });
+    transformBuffer = tgai.createBuffer({ tga::BufferUsage::storage, size, initialStaging });
+    tgai.free(initialStaging);
+    // room for every instance changing at once
+    size_t updateSize = HEADER_SIZE + transforms.size() * sizeof(Update);
+    updateStaging = SlotStaging(tgai, updateSize, slots);
+    updateBuffer = tgai.createBuffer({ tga::BufferUsage::storage, updateSize });
+    scatterInput = tgai.createInputSet({ scatterPass, { tga::Binding(updateBuffer, 0), tga::Binding(transformBuffer, 1) }, 0 });
+}
+
+InstanceTransforms::~InstanceTransforms()
+{
+    tgai->free(scatterInput);
+    tgai->free(updateBuffer);
+    tgai->free(transformBuffer);
+}
+
+size_t InstanceTransforms::size() const
+{
+    return transforms.size();
+}
+
+const glm::mat4 &InstanceTransforms::get(size_t idx) const
+{
+    return transforms[idx];
+}
+
+void InstanceTransforms::set(size_t idx, const glm::mat4 &transform)
+{
+    if(std::memcmp(&transforms[idx], &transform, sizeof(glm::mat4)) == 0) {
+        return;
+    }
+    transforms[idx] = transform;
+    if(!isDirty[idx]) {
+        isDirty[idx] = true;
+        dirty.push_back(static_cast<uint32_t>(idx));
+    }
+}
+
+tga::Buffer InstanceTransforms::buffer() const
+{
+    return transformBuffer;
+}
+
+size_t InstanceTransforms::flush(uint32_t slot)
+{
+    uint8_t *updates = updateStaging.as<uint8_t>(slot);
+    uint32_t count = static_cast<uint32_t>(dirty.size());
+    std::memcpy(updates, &count, sizeof(count));
+    Update *packed = reinterpret_cast<Update*>(updates + HEADER_SIZE);
+    for(uint32_t i = 0; i < count; i++) {
+        Update update{ transforms[dirty[i]], dirty[i], {} };
+        std::memcpy(&packed[i], &update, sizeof(update));
+        isDirty[dirty[i]] = false;
+    }
+    dirty.clear();
+    return count;
+}
+
+void InstanceTransforms::record(tga::CommandRecorder &recorder, size_t count, uint32_t slot) const
+{
+    if(count == 0) {
+        return;
+    }
+    recorder.bufferUpload(updateStaging.buffer(slot), updateBuffer, uploadBytes(count));
+    recorder.barrier(tga::PipelineStage::Transfer, tga::PipelineStage::ComputeShader);
+    recorder.setComputePass(scatterPass);
+    recorder.bindInputSet(scatterInput);
+    recorder.dispatch(ceilDiv(static_cast<uint32_t>(count), SCATTER_GROUP_SIZE), 1, 1);
+}
+
+size_t InstanceTransforms::uploadBytes(size_t count)
+{
+    return count == 0 ? 0 : HEADER_SIZE + count * sizeof(Update);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tga/tga.hpp"
+
+#include "SlotStaging.h"
+
+/*
+ * The transforms of all instances of a demo in one storage buffer. Changes are tracked per instance; each frame the
+ * changed transforms are packed with their indices into one staging range, sent with one copy and scattered into
+ * place by scatter_transforms.comp. Frames without changes record nothing.
+ */
+class InstanceTransforms {
+public:
+    /* the compute pass all InstanceTransforms record with, to be freed by the caller */
+    static tga::ComputePass createScatterPass(tga::Interface &tgai);
+
+    /* slots: frames in flight, see SlotStaging */
+    InstanceTransforms(tga::Interface &tgai, tga::ComputePass scatterPass, std::vector<glm::mat4> initial, uint32_t slots);
+    ~InstanceTransforms();
+    InstanceTransforms(const InstanceTransforms &) = delete;
+    InstanceTransforms &operator=(const InstanceTransforms &) = delete;
+
+    size_t size() const;
+    const glm::mat4 &get(size_t idx) const;
+    /* marks the instance for the next flush(), unless the transform is unchanged */
+    void set(size_t idx, const glm::mat4 &transform);
+    tga::Buffer buffer() const;
+
+    /* packs the transforms changed since the last flush into the staging slot, returns their count */
+    size_t flush(uint32_t slot);
+    /* records the upload and scatter of a flush() into slot that returned count, nothing for 0 */
+    void record(tga::CommandRecorder &recorder, size_t count, uint32_t slot) const;
+    /* bytes copied per frame for count changed transforms */
+    static size_t uploadBytes(size_t count);
+
+private:
+    /* std430 layout of scatter_transforms.comp's updates */
+    struct Update {
+        glm::mat4 transform;
+        uint32_t index;
+        uint32_t padding[3];
+    };
+    static constexpr size_t HEADER_SIZE = 16;
+
+    tga::Interface *tgai;
+    tga::ComputePass scatterPass;
+    std::vector<glm::mat4> transforms;
+    std::vector<uint32_t> dirty;
+    std::vector<bool> isDirty;
+    tga::Buffer transformBuffer;
+    SlotStaging updateStaging;
+    tga::Buffer updateBuffer;
+    tga::InputSet scatterInput;
+};
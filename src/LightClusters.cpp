@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "LightClusters.h"
+
+static_assert(sizeof(GpuPointLight) == 48, "std430 layout of PointLight in light_clusters.h");
+
+namespace {
+
+// what lights without falloff reach, as good as unbounded for binning
+constexpr float UNBOUNDED_RANGE = 1e6f;
+
+/* distance at which 1 / (c + l d + q d^2) falls to threshold */
+float attenuationRange(glm::vec3 factors, float threshold)
+{
+    float c = factors[0], l = factors[1], q = factors[2];
+    float k = 1.0f / threshold - c;
+    if(k <= 0.0f) {
+        return 0.0f;
+    }
+    if(q > 0.0f) {
+        return (-l + std::sqrt(l * l + 4.0f * q * k)) / (2.0f * q);
+    }
+    return l > 0.0f ? std::min(k / l, UNBOUNDED_RANGE) : UNBOUNDED_RANGE;
+}
+
+}
+
+void LightClusters::setLights(const std::vector<PointLight> &lights)
+{
+    m_lights.clear();
+    bounds.clear();
+    for(size_t i = 0; i < std::min<size_t>(lights.size(), MAX_POINT_LIGHTS); ++i) {
+        const PointLight &light = lights[i];
+        float brightest = std::max(light.color.x, std::max(light.color.y, light.color.z));
+        float cutoff = brightest > 0.0f ? POINT_LIGHT_CUTOFF / brightest : 1.0f;
+        float range = attenuationRange(light.attenuationFactors, cutoff);
+        m_lights.push_back({ light.position, range, light.color, cutoff, light.attenuationFactors });
+        bounds.emplace_back(light.position, range);
+    }
+}
+
+void LightClusters::bin(const FroxelFrustum &frustum)
+{
+    m_lists.bin(frustum, bounds, MAX_LIGHT_REFERENCES, true);
+}
+
+glm::vec3 LightClusters::fogRadiance(uint32_t tile, glm::vec3 worldPos, glm::vec3 viewDir, float anisotropy) const
+{
+    glm::vec3 radiance{0.0f};
+    const std::array<uint32_t, 2> &list = m_lists.tiles()[tile];
+    for(uint32_t i = 0; i < list[1]; ++i) {
+        const GpuPointLight &light = m_lights[m_lists.references()[list[0] + i]];
+        glm::vec3 toPoint = worldPos - light.position;
+        float dist = std::max(glm::length(toPoint), 1e-4f);
+        const glm::vec3 &f = light.attenuationFactors;
+        float attenuation = std::max(1.0f / (f[0] + f[1] * dist + f[2] * dist * dist) - light.cutoff, 0.0f);
+        // Henyey-Greenstein, as getPhaseFunction in volumetric_fog_util.h
+        float g = anisotropy;
+        float denom = std::abs(1.0f + g * g - 2.0f * g * glm::dot(toPoint / dist, viewDir));
+        float phase = (1.0f - g * g) / (denom * std::sqrt(denom)) * (1.0f / 4.0f * static_cast<float>(M_PI));
+        radiance += light.color * (attenuation * phase);
+    }
+    return radiance;
+}
+
+bool LightClusters::tileEmpty(uint32_t tile) const
+{
+    return m_lists.tiles()[tile][1] == 0;
+}
+
+const std::vector<GpuPointLight> &LightClusters::lights() const
+{
+    return m_lights;
+}
+
+const FroxelTileLists &LightClusters::lists() const
+{
+    return m_lists;
+}
+
+void LightClusters::write(uint8_t *target) const
+{
+    std::memcpy(target, m_lists.tiles().data(), LIGHTS_OFFSET);
+    std::memcpy(target + LIGHTS_OFFSET, m_lights.data(), m_lights.size() * sizeof(GpuPointLight));
+    std::memcpy(target + REFERENCES_OFFSET, m_lists.references().data(), m_lists.references().size() * sizeof(uint32_t));
+}
+
+std::array<size_t, 2> LightClusters::uploadExtent() const
+{
+    return { m_lights.size(), m_lists.uploadReferences() };
+}
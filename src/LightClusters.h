@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FroxelTiles.h"
+#include "Lights.h"
+
+/*
+ * Point lights clustered by the froxel grid's tiles: every frame the CPU bins each light's sphere of influence into
+ * the tiles, and mesh.frag and the fog generation pass only add up the lights of the tile they are in, so thousands
+ * of lights cost what the few near each point cost. Surfaces behind the fog range use the last slab of tiles.
+ * Limits and layouts must match light_clusters.h.
+ */
+constexpr uint32_t MAX_POINT_LIGHTS = 4096;
+constexpr uint32_t MAX_LIGHT_REFERENCES = 1 << 18;
+/* a light's influence ends where its radiance falls to this; the shaders subtract it, so it fades out there */
+constexpr float POINT_LIGHT_CUTOFF = 1.0f / 256.0f;
+
+/* a light as the shaders read it */
+struct GpuPointLight {
+    alignas(16) glm::vec3 position;
+    alignas(4) float range;
+    alignas(16) glm::vec3 color;
+    /* POINT_LIGHT_CUTOFF over the brightest channel, subtracted from the attenuation */
+    alignas(4) float cutoff;
+    alignas(16) glm::vec3 attenuationFactors;
+};
+
+class LightClusters {
+public:
+    /* lights past MAX_POINT_LIGHTS are ignored */
+    void setLights(const std::vector<PointLight> &lights);
+    /* bins the lights for the frustum on all cores; references past MAX_LIGHT_REFERENCES are dropped */
+    void bin(const FroxelFrustum &frustum);
+
+    /* light scattered towards the camera at a point in the given tile, viewDir pointing away from the camera, as
+       getPointLightsRadiance in volumetric_fog_generate.h computes it */
+    glm::vec3 fogRadiance(uint32_t tile, glm::vec3 worldPos, glm::vec3 viewDir, float anisotropy) const;
+    bool tileEmpty(uint32_t tile) const;
+
+    const std::vector<GpuPointLight> &lights() const;
+    const FroxelTileLists &lists() const;
+
+    /* the shaders' buffer: tiles, then MAX_POINT_LIGHTS lights, then the references */
+    static constexpr size_t LIGHTS_OFFSET = FroxelTileLists::TILES_BYTES;
+    static constexpr size_t REFERENCES_OFFSET = LIGHTS_OFFSET + MAX_POINT_LIGHTS * sizeof(GpuPointLight);
+    static constexpr size_t BUFFER_SIZE = REFERENCES_OFFSET + MAX_LIGHT_REFERENCES * sizeof(uint32_t);
+    /* writes the buffer's used parts to target, laid out as the buffer */
+    void write(uint8_t *target) const;
+    /* lights and references an upload of the buffer covers; a command buffer recorded for other ones must be
+       recorded again */
+    std::array<size_t, 2> uploadExtent() const;
+
+private:
+    std::vector<GpuPointLight> m_lights;
+    /* spheres of influence, xyz centre and w range */
+    std::vector<glm::vec4> bounds;
+    FroxelTileLists m_lists;
+};
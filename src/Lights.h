@@ -0,0 +1,17 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/* the sun, as the scene and fog shaders read it */
+struct DirLight
+{
+    alignas(16) glm::vec3 direction;
+    alignas(16) glm::vec3 color;
+};
+
+/* a point light as the scene describes it, see LightClusters for what the shaders read */
+struct PointLight
+{
+    glm::vec3 position;
+    glm::vec3 color;
+    glm::vec3 attenuationFactors; // constant, linear and quadratic in order
+};
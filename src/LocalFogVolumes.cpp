@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "LocalFogVolumes.h"
+#include "util.h"
+
+static_assert(sizeof(GpuLocalFogVolume) == 80, "std430 layout of LocalFogVolume in volumetric_fog_generate.h");
+
+void LocalFogBins::setVolumes(const std::vector<LocalFogVolume> &volumes)
+{
+    m_volumes.clear();
+    bounds.clear();
+    for(size_t i = 0; i < std::min<size_t>(volumes.size(), LOCAL_FOG_MAX_VOLUMES); ++i) {
+        const LocalFogVolume &volume = volumes[i];
+        glm::mat4 localToWorld = glm::translate(glm::mat4(1.0f), volume.position) * rotationFromEuler(volume.rotation) * glm::scale(glm::mat4(1.0f), volume.halfExtents);
+        m_volumes.push_back({ glm::inverse(localToWorld), static_cast<uint32_t>(volume.shape), volume.density, std::max(volume.falloff, 1e-4f), volume.noise });
+        bounds.emplace_back(volume.position, glm::length(volume.halfExtents));
+    }
+}
+
+void LocalFogBins::bin(const FroxelFrustum &frustum)
+{
+    // nothing samples the fog behind its range
+    m_lists.bin(frustum, bounds, LOCAL_FOG_MAX_REFERENCES, false);
+}
+
+float LocalFogBins::density(uint32_t tile, glm::vec3 worldPos, float noise) const
+{
+    // must match localFogDensity in volumetric_fog_generate.h
+    float sum = 0.0f;
+    const std::array<uint32_t, 2> &list = m_lists.tiles()[tile];
+    for(uint32_t i = 0; i < list[1]; ++i) {
+        const GpuLocalFogVolume &volume = m_volumes[m_lists.references()[list[0] + i]];
+        glm::vec3 local = glm::vec3(volume.worldToLocal * glm::vec4(worldPos, 1.0f));
+        float extent = volume.shape == static_cast<uint32_t>(LocalFogShape::box)
+            ? std::max(std::abs(local.x), std::max(std::abs(local.y), std::abs(local.z)))
+            : glm::length(local);
+        float fade = std::clamp((1.0f - extent) / volume.falloff, 0.0f, 1.0f);
+        sum += volume.density * fade * (1.0f + (noise - 1.0f) * volume.noise);
+    }
+    return sum;
+}
+
+bool LocalFogBins::tileEmpty(uint32_t tile) const
+{
+    return m_lists.tiles()[tile][1] == 0;
+}
+
+const std::vector<GpuLocalFogVolume> &LocalFogBins::volumes() const
+{
+    return m_volumes;
+}
+
+const FroxelTileLists &LocalFogBins::lists() const
+{
+    return m_lists;
+}
+
+void LocalFogBins::write(uint8_t *target) const
+{
+    std::memcpy(target, m_lists.tiles().data(), VOLUMES_OFFSET);
+    std::memcpy(target + VOLUMES_OFFSET, m_volumes.data(), m_volumes.size() * sizeof(GpuLocalFogVolume));
+    std::memcpy(target + REFERENCES_OFFSET, m_lists.references().data(), m_lists.references().size() * sizeof(uint32_t));
+}
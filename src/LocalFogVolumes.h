@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FroxelTiles.h"
+
+/*
+ * Local fog: boxes and ellipsoids adding their own density to the global height fog. Every frame they are binned on
+ * the CPU into the froxel grid's tiles, so a froxel only evaluates the volumes that overlap its tile. Limits and
+ * layouts must match volumetric_fog_generate.h.
+ */
+constexpr uint32_t LOCAL_FOG_MAX_VOLUMES = 1024;
+constexpr uint32_t LOCAL_FOG_MAX_REFERENCES = 65536;
+
+enum class LocalFogShape : uint32_t { box, ellipsoid };
+
+struct LocalFogVolume {
+    LocalFogShape shape = LocalFogShape::box;
+    glm::vec3 position{0.0f};
+    glm::vec3 halfExtents{1.0f};
+    /* euler angles in radians */
+    glm::vec3 rotation{0.0f};
+    float density = 1.0f;
+    /* the density fades to zero over this outer fraction of the extent */
+    float falloff = 0.2f;
+    /* how much the fog noise modulates the density, 0 for none */
+    float noise = 0.0f;
+};
+
+/* a volume as the generation shader reads it */
+struct GpuLocalFogVolume {
+    /* maps the volume onto [-1, 1]^3 */
+    alignas(16) glm::mat4 worldToLocal;
+    alignas(4) uint32_t shape;
+    alignas(4) float density;
+    alignas(4) float falloff;
+    alignas(4) float noise;
+};
+
+class LocalFogBins {
+public:
+    /* volumes past LOCAL_FOG_MAX_VOLUMES are ignored */
+    void setVolumes(const std::vector<LocalFogVolume> &volumes);
+    /* bins the volumes' bounding spheres for the frustum; references past LOCAL_FOG_MAX_REFERENCES are dropped */
+    void bin(const FroxelFrustum &frustum);
+
+    /* local density at a point in the given tile, noise being the fog noise there */
+    float density(uint32_t tile, glm::vec3 worldPos, float noise) const;
+    bool tileEmpty(uint32_t tile) const;
+
+    const std::vector<GpuLocalFogVolume> &volumes() const;
+    const FroxelTileLists &lists() const;
+
+    /* the shader's buffer: tiles, then LOCAL_FOG_MAX_VOLUMES volumes, then the references */
+    static constexpr size_t VOLUMES_OFFSET = FroxelTileLists::TILES_BYTES;
+    static constexpr size_t REFERENCES_OFFSET = VOLUMES_OFFSET + LOCAL_FOG_MAX_VOLUMES * sizeof(GpuLocalFogVolume);
+    static constexpr size_t BUFFER_SIZE = REFERENCES_OFFSET + LOCAL_FOG_MAX_REFERENCES * sizeof(uint32_t);
+    /* writes the buffer's used parts to target, laid out as the buffer */
+    void write(uint8_t *target) const;
+
+private:
+    std::vector<GpuLocalFogVolume> m_volumes;
+    /* bounding spheres, xyz centre and w radius */
+    std::vector<glm::vec4> bounds;
+    FroxelTileLists m_lists;
+};
@@ -0,0 +1,84 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path)
+{
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        return;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!mapping) {
+        return;
+    }
+    m_data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = m_data ? static_cast<size_t>(fileSize.QuadPart) : 0;
+}
+
+MappedFile::~MappedFile()
+{
+    if(m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if(mapping) {
+        CloseHandle(mapping);
+    }
+    if(file) {
+        CloseHandle(file);
+    }
+}
+#else
+MappedFile::MappedFile(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED) {
+            m_data = static_cast<const uint8_t *>(p);
+            m_size = static_cast<size_t>(st.st_size);
+        }
+    }
+    // the mapping stays valid after closing the descriptor
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if(m_data) {
+        munmap(const_cast<uint8_t *>(m_data), m_size);
+    }
+}
+#endif
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t hashFile(const std::string &path)
+{
+    MappedFile file{path};
+    return hashBytes(file.data(), file.size());
+}
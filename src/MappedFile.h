@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/* Read-only memory mapping of a whole file. Evaluates to false if the file could not be opened or mapped. */
+class MappedFile {
+public:
+    MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    explicit operator bool() const { return m_data != nullptr; }
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#endif
+};
+
+/* FNV-1a, pass a previous result as hash to continue it over more data */
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+/* hashBytes of a whole file's content, 0-length or unreadable files hash to the offset basis */
+uint64_t hashFile(const std::string &path);
@@ -1,52 +1,19 @@
 #include "Mesh.h"
 #include <filesystem>
 
-
-tga::Texture loadTex(tga::Interface& tgai, const std::string& file, bool normalMap = false)
+std::string Mesh::texturePath(const std::string &basePath, size_t slot)
 {
-    int w, h, channels;
-    uint8_t* p = stbi_load(file.c_str(), &w, &h, &channels, STBI_rgb_alpha);
-    if(!p)
-    {
-        printf("Error while loading the texture on path: %s\n", file.c_str());
-        return {};
-    }
-
-    tga::StagingBuffer textureStagingBuffer = tgai.createStagingBuffer({ 4 * (uint32_t)w * (uint32_t)h, p });
-    tga::Format textureFormat;
-    if(!normalMap)
-    {
-        textureFormat = tga::Format::r8g8b8a8_srgb;
-    }
-    else
-    {
-        textureFormat = tga::Format::r8g8b8a8_unorm;
+    for(const char *suffix : { TEXTURE_SUFFIXES[slot], TEXTURE_FALLBACK_SUFFIXES[slot] }) {
+        if(suffix && std::filesystem::exists(basePath + suffix)) {
+            return basePath + suffix;
+        }
     }
-    tga::Texture texture = tgai.createTexture(tga::TextureInfo{ (uint32_t)w, (uint32_t)h, textureFormat, tga::SamplerMode::linear, tga::AddressMode::repeat }.setSrcData(textureStagingBuffer));
-    free(p);
-    tgai.free(textureStagingBuffer);
-    return texture;
+    return {};
 }
 
-Mesh::Mesh(tga::Interface& tgai, const char* obj, const tga::VertexLayout& vertexLayout)
+std::array<tga::Texture*, 5> Mesh::textureSlots()
 {
-    static_cast<void>(vertexLayout);
-    std::filesystem::path objPath = obj;
-    std::string texturesPath = objPath.replace_extension().string();
-    std::string albedoTexturePath = texturesPath + std::string("_albedo.png");
-    std::string normalTexturePath = texturesPath + std::string("_normal.png");
-    std::string metallicTexturePath = texturesPath + std::string("_metal.png");
-    std::string roughnessTexturePath = texturesPath + std::string("_roughness.png");
-    std::string aoTextureMap = texturesPath + std::string("_ao.png");
-    tga::Obj loadedObj = tga::loadObj(obj);
-    verticesArray = loadedObj.vertexBuffer;
-    indicesArray = loadedObj.indexBuffer;
-    // Load the textures
-    albedoMap = loadTex(tgai, albedoTexturePath);
-    normalMap = loadTex(tgai, normalTexturePath, true);
-    metallicMap = loadTex(tgai, metallicTexturePath);
-    roughnessMap = loadTex(tgai, roughnessTexturePath);
-    aoMap = loadTex(tgai, aoTextureMap);
+    return { &albedoMap, &normalMap, &metallicMap, &roughnessMap, &aoMap };
 }
 
 tga::InputSet Mesh::getTextureInputSet(tga::Interface& tgai, const tga::RenderPass rp) const
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <array>
 #include <string>
 #include <iostream>
 
 #include "tga/tga.hpp"
 #include "tga/tga_utils.hpp"
 
+#include "MeshCache.h"
+
 struct ObjectUniformBuffer
 {
     alignas(16) glm::mat4 model;
@@ -18,18 +21,35 @@ struct InstanceData
     alignas(16) float scale;
 };
 
+/* A mesh's geometry and textures as AssetLoader fills them in */
 class Mesh
 {
 public:
-	Mesh(tga::Interface& tgai, const char* objPath, const tga::VertexLayout& vertexLayout);
+    /* texture files next to the .obj, in the order of textureSlots() */
+    static constexpr std::array<const char*, 5> TEXTURE_SUFFIXES = { "_albedo.png", "_normal.png", "_metal.png", "_roughness.png", "_ao.png" };
+    /* cooked to BC5 instead of BC1 sRGB like the other slots */
+    static constexpr size_t NORMAL_MAP_SLOT = 1;
+    /* tried when a slot's file is missing, the ship assets call their albedo _diffuse and have no PBR maps */
+    static constexpr std::array<const char*, 5> TEXTURE_FALLBACK_SUFFIXES = { "_diffuse.png", nullptr, nullptr, nullptr, nullptr };
+    /* RGBA8 of the 1x1 texture used when neither file exists: grey, flat normal, dielectric, rough, unoccluded */
+    static constexpr std::array<std::array<uint8_t, 4>, 5> FLAT_TEXTURES = {{ { 200, 200, 200, 255 }, { 128, 128, 255, 255 }, { 0, 0, 0, 255 }, { 255, 255, 255, 255 }, { 255, 255, 255, 255 } }};
+
+    /* the first existing file for slot next to basePath (the .obj path without extension), empty if there is none */
+    static std::string texturePath(const std::string &basePath, size_t slot);
+
+    std::array<tga::Texture*, 5> textureSlots();
 
     tga::InputSet getTextureInputSet(tga::Interface& tgai, const tga::RenderPass rp) const;
 public:
     std::vector<tga::Vertex> verticesArray;
+    /* all LODs back to back, see lods */
     std::vector<uint32_t> indicesArray;
+    std::vector<MeshLod> lods;
     tga::Texture albedoMap;
     tga::Texture normalMap;
     tga::Texture metallicMap;
     tga::Texture roughnessMap;
     tga::Texture aoMap;
+    /* TextureRegistry key per slot, 0 for textures not owned by a registry */
+    std::array<uint64_t, 5> textureKeys{};
 };
\ No newline at end of file
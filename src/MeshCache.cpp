@@ -0,0 +1,151 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "tga/tga_utils.hpp"
+
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+namespace {
+
+constexpr char COOKED_MAGIC[8] = { 'F', 'O', 'G', 'M', 'E', 'S', 'H', '\0' };
+constexpr uint32_t COOKED_VERSION = 4;
+constexpr size_t MAX_LODS = 5;
+
+struct CookedMeshHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t lodCount;
+    /* how long the text parse took when this file was cooked, for reporting the saving */
+    double parseMillis;
+};
+
+typedef std::chrono::high_resolution_clock clock;
+typedef std::chrono::duration<double, std::milli> duration;
+
+bool writeCookedMesh(const std::string &cookedPath, const CookedMeshHeader &header, const CookedMesh &mesh)
+{
+    std::string tmpPath = cookedPath + ".tmp";
+    {
+        std::ofstream out{tmpPath, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(mesh.vertices.data()), mesh.vertices.size() * sizeof(tga::Vertex));
+        out.write(reinterpret_cast<const char *>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+        out.write(reinterpret_cast<const char *>(mesh.lods.data()), mesh.lods.size() * sizeof(MeshLod));
+        if(!out) {
+            return false;
+        }
+    }
+    // replace atomically, so an interrupted cook never leaves a truncated cache behind
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, cookedPath, ec);
+    return !ec;
+}
+
+}
+
+CookedMesh loadCookedMesh(const std::string &objPath, bool recook)
+{
+    std::string cookedPath = std::filesystem::path(objPath).replace_extension(".cooked").string();
+    std::string name = std::filesystem::path(objPath).filename().string();
+    std::error_code ec;
+    uint64_t sourceSize = std::filesystem::file_size(objPath, ec);
+    int64_t sourceMtime = ec ? 0 : std::filesystem::last_write_time(objPath, ec).time_since_epoch().count();
+    if(ec) {
+        // nothing to key a cache on, leave the error reporting to the loader
+        tga::Obj loadedObj = tga::loadObj(objPath);
+        uint32_t indexCount = static_cast<uint32_t>(loadedObj.indexBuffer.size());
+        return { std::move(loadedObj.vertexBuffer), std::move(loadedObj.indexBuffer), { { 0, indexCount, 0.0f } } };
+    }
+
+    clock::time_point start = clock::now();
+    CookedMesh mesh;
+    if(!recook) {
+        MappedFile cooked{cookedPath};
+        CookedMeshHeader header;
+        if(cooked && cooked.size() >= sizeof(header)) {
+            std::memcpy(&header, cooked.data(), sizeof(header));
+            bool valid = std::memcmp(header.magic, COOKED_MAGIC, sizeof(COOKED_MAGIC)) == 0
+                && header.version == COOKED_VERSION
+                && header.vertexSize == sizeof(tga::Vertex)
+                && cooked.size() == sizeof(header) + header.vertexCount * sizeof(tga::Vertex) + header.indexCount * sizeof(uint32_t)
+                    + header.lodCount * sizeof(MeshLod);
+            bool fresh = valid && header.sourceSize == sourceSize && header.sourceMtime == sourceMtime;
+            // a checkout or copy touches the timestamp without changing the content
+            bool touched = valid && !fresh && header.sourceSize == sourceSize && header.sourceHash == hashFile(objPath);
+            if(fresh || touched) {
+                const uint8_t *vertices = cooked.data() + sizeof(header);
+                const uint8_t *indices = vertices + header.vertexCount * sizeof(tga::Vertex);
+                mesh.vertices.resize(header.vertexCount);
+                const uint8_t *lods = indices + header.indexCount * sizeof(uint32_t);
+                mesh.indices.resize(header.indexCount);
+                mesh.lods.resize(header.lodCount);
+                std::memcpy(mesh.vertices.data(), vertices, header.vertexCount * sizeof(tga::Vertex));
+                std::memcpy(mesh.indices.data(), indices, header.indexCount * sizeof(uint32_t));
+                std::memcpy(mesh.lods.data(), lods, header.lodCount * sizeof(MeshLod));
+                double loadMillis = duration(clock::now() - start).count();
+                std::ostringstream report;
+                report << "[Mesh cache] " << name << ": loaded cooked in " << loadMillis << " ms (text parse: "
+                       << header.parseMillis << " ms, saved " << header.parseMillis - loadMillis << " ms)\n";
+                // meshes may be loaded from several threads, print each line in one go
+                std::cout << report.str();
+                if(touched) {
+                    header.sourceMtime = sourceMtime;
+                    std::fstream patch{cookedPath, std::ios::binary | std::ios::in | std::ios::out};
+                    patch.write(reinterpret_cast<const char *>(&header), sizeof(header));
+                }
+                return mesh;
+            }
+        }
+    }
+
+    tga::Obj loadedObj = tga::loadObj(objPath);
+    mesh.vertices = std::move(loadedObj.vertexBuffer);
+    mesh.indices = std::move(loadedObj.indexBuffer);
+    double parseMillis = duration(clock::now() - start).count();
+
+    clock::time_point optimizeStart = clock::now();
+    size_t sourceVertexCount = mesh.vertices.size();
+    VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeMesh(mesh);
+    VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+    double optimizeMillis = duration(clock::now() - optimizeStart).count();
+    clock::time_point simplifyStart = clock::now();
+    generateLods(mesh, MAX_LODS);
+    double simplifyMillis = duration(clock::now() - simplifyStart).count();
+
+    CookedMeshHeader header{};
+    std::memcpy(header.magic, COOKED_MAGIC, sizeof(COOKED_MAGIC));
+    header.version = COOKED_VERSION;
+    header.vertexSize = sizeof(tga::Vertex);
+    header.sourceSize = sourceSize;
+    header.sourceMtime = sourceMtime;
+    header.sourceHash = hashFile(objPath);
+    header.vertexCount = mesh.vertices.size();
+    header.indexCount = mesh.indices.size();
+    header.lodCount = mesh.lods.size();
+    header.parseMillis = parseMillis;
+    std::ostringstream report;
+    report << "[Mesh cache] " << name << ": parsed in " << parseMillis << " ms, optimized in " << optimizeMillis << " ms ("
+           << sourceVertexCount << " -> " << mesh.vertices.size() << " vertices, ACMR " << before.acmr << " -> " << after.acmr
+           << ", ATVR " << before.atvr << " -> " << after.atvr << "), " << mesh.lods.size() << " LODs in " << simplifyMillis << " ms (";
+    for(size_t lod = 0; lod < mesh.lods.size(); lod++) {
+        report << (lod ? "/" : "") << mesh.lods[lod].indexCount / 3;
+    }
+    report << " triangles), "
+           << (writeCookedMesh(cookedPath, header, mesh) ? "cooked to " : "could not write ") << cookedPath << "\n";
+    std::cout << report.str();
+    return mesh;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "tga/tga.hpp"
+
+/*
+ * Binary cache in front of tga::loadObj. The cooked file lives next to the .obj (<name>.cooked) and stores the
+ * vertex and index arrays exactly as Drawable uploads them, behind a header identifying the source file by size,
+ * modification time and content hash. Stale or missing caches are rebuilt transparently. Cooking runs the mesh through
+ * optimizeMesh(), so the cached order is already welded and sorted for the vertex cache, overdraw and fetch, and
+ * through generateLods(), so the simplified LODs are stored alongside the base mesh.
+ */
+
+/* a range of CookedMesh::indices; all LODs share the vertices */
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    /* bound on the geometric deviation from LOD 0 in object space units */
+    float error;
+};
+
+struct CookedMesh {
+    std::vector<tga::Vertex> vertices;
+    /* all LODs back to back, LOD 0 first */
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod> lods;
+};
+
+CookedMesh loadCookedMesh(const std::string &objPath, bool recook = false);
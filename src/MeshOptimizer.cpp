@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+#include "MappedFile.h"
+
+namespace {
+
+constexpr size_t FORSYTH_CACHE_SIZE = 32;
+constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+float vertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if(remainingTriangles == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if(cachePosition >= 0) {
+        // the last triangle's vertices get a fixed score, so it is not simply continued as a strip
+        score = cachePosition < 3 ? 0.75f : std::pow(1.0f - float(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+    // prefer vertices with few triangles left, to finish them off and not leave lone triangles behind
+    return score + 2.0f / std::sqrt(float(remainingTriangles));
+}
+
+struct FifoCache {
+    std::vector<uint32_t> timestamps;
+    uint32_t time;
+    size_t size;
+
+    FifoCache(size_t vertexCount, size_t size) : timestamps(vertexCount, 0), time(size + 1), size(size) {}
+
+    /* true on a miss */
+    bool access(uint32_t vertex)
+    {
+        if(time - timestamps[vertex] > size) {
+            timestamps[vertex] = time++;
+            return true;
+        }
+        return false;
+    }
+};
+
+}
+
+TriangleAdjacency::TriangleAdjacency(const std::vector<uint32_t> &indices, size_t vertexCount) : counts(vertexCount, 0), offsets(vertexCount + 1, 0), triangles(indices.size())
+{
+    for(uint32_t index : indices) {
+        counts[index]++;
+    }
+    std::partial_sum(counts.begin(), counts.end(), offsets.begin() + 1);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for(size_t i = 0; i < indices.size(); i++) {
+        triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, size_t cacheSize)
+{
+    FifoCache cache{vertexCount, cacheSize};
+    size_t misses = 0;
+    for(uint32_t index : indices) {
+        misses += cache.access(index);
+    }
+    return {
+        indices.empty() ? 0.0f : float(misses) / float(indices.size() / 3),
+        vertexCount == 0 ? 0.0f : float(misses) / float(vertexCount),
+    };
+}
+
+size_t weldVertices(CookedMesh &mesh)
+{
+    const std::vector<tga::Vertex> &vertices = mesh.vertices;
+    auto hash = [&](uint32_t i) { return static_cast<size_t>(hashBytes(&vertices[i], sizeof(tga::Vertex))); };
+    auto equal = [&](uint32_t a, uint32_t b) { return std::memcmp(&vertices[a], &vertices[b], sizeof(tga::Vertex)) == 0; };
+    std::unordered_map<uint32_t, uint32_t, decltype(hash), decltype(equal)> unique{vertices.size(), hash, equal};
+
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<tga::Vertex> welded;
+    welded.reserve(vertices.size());
+    for(uint32_t i = 0; i < vertices.size(); i++) {
+        auto [it, inserted] = unique.emplace(i, static_cast<uint32_t>(welded.size()));
+        if(inserted) {
+            welded.push_back(vertices[i]);
+        }
+        remap[i] = it->second;
+    }
+    for(uint32_t &index : mesh.indices) {
+        index = remap[index];
+    }
+    mesh.vertices = std::move(welded);
+    return mesh.vertices.size();
+}
+
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    TriangleAdjacency adjacency{indices, vertexCount};
+    // counts now track the triangles not yet emitted, their ids are kept at the front of each adjacency range
+    std::vector<uint32_t> &remaining = adjacency.counts;
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for(size_t v = 0; v < vertexCount; v++) {
+        score[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    size_t cursor = 0;
+    int64_t best = -1;
+    for(size_t count = 0; count < triangleCount; count++) {
+        if(best < 0) {
+            // nothing in the cache has triangles left, continue in input order
+            while(emitted[cursor]) {
+                cursor++;
+            }
+            best = static_cast<int64_t>(cursor);
+        }
+        emitted[best] = true;
+        const uint32_t *triangle = &indices[3 * best];
+        nextCache.assign(triangle, triangle + 3);
+        for(int k = 0; k < 3; k++) {
+            uint32_t v = triangle[k];
+            result.push_back(v);
+            uint32_t *begin = &adjacency.triangles[adjacency.offsets[v]];
+            uint32_t *end = begin + remaining[v];
+            std::iter_swap(std::find(begin, end, static_cast<uint32_t>(best)), end - 1);
+            remaining[v]--;
+        }
+        for(uint32_t v : cache) {
+            if(v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                nextCache.push_back(v);
+            }
+        }
+        for(size_t i = 0; i < nextCache.size(); i++) {
+            uint32_t v = nextCache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            score[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+        nextCache.resize(std::min(nextCache.size(), FORSYTH_CACHE_SIZE));
+        std::swap(cache, nextCache);
+
+        best = -1;
+        float bestScore = -1.0f;
+        for(uint32_t v : cache) {
+            for(uint32_t i = 0; i < remaining[v]; i++) {
+                uint32_t t = adjacency.triangles[adjacency.offsets[v] + i];
+                float s = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+                if(s > bestScore) {
+                    bestScore = s;
+                    best = t;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t> &indices, const std::vector<tga::Vertex> &vertices, float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    if(triangleCount == 0) {
+        return indices;
+    }
+
+    // Split into clusters where the cache order restarts anyway (a triangle missing all three vertices), or where
+    // the cluster so far, counted from a cold cache, is close enough to the overall cache efficiency.
+    float acmr = analyzeVertexCache(indices, vertices.size()).acmr;
+    FifoCache cache{vertices.size(), 16};
+    FifoCache clusterCache{vertices.size(), 16};
+    std::vector<size_t> clusterStarts;
+    size_t clusterMisses = 0;
+    for(size_t t = 0; t < triangleCount; t++) {
+        const uint32_t *triangle = &indices[3 * t];
+        bool hard = cache.access(triangle[0]) + cache.access(triangle[1]) + cache.access(triangle[2]) == 3;
+        size_t clusterTriangles = clusterStarts.empty() ? 0 : t - clusterStarts.back();
+        bool soft = clusterTriangles > 0 && float(clusterMisses) / float(clusterTriangles) <= threshold * acmr;
+        if(clusterStarts.empty() || hard || soft) {
+            clusterStarts.push_back(t);
+            clusterMisses = 0;
+            // forget everything, every cluster may end up anywhere in the final order
+            clusterCache.time += static_cast<uint32_t>(clusterCache.size + 1);
+        }
+        clusterMisses += clusterCache.access(triangle[0]) + clusterCache.access(triangle[1]) + clusterCache.access(triangle[2]);
+    }
+    clusterStarts.push_back(triangleCount);
+
+    // area-weighted centroid and normal per cluster
+    glm::vec3 meshCentroid{0.0f};
+    float meshArea = 0.0f;
+    size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<glm::vec3> centroids(clusterCount), normals(clusterCount);
+    for(size_t c = 0; c < clusterCount; c++) {
+        glm::vec3 centroid{0.0f}, normal{0.0f};
+        float area = 0.0f;
+        for(size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            glm::vec3 a = vertices[indices[3 * t]].position;
+            glm::vec3 b = vertices[indices[3 * t + 1]].position;
+            glm::vec3 d = vertices[indices[3 * t + 2]].position;
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(n);
+            centroid += (a + b + d) * (triangleArea / 3.0f);
+            normal += n;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[c] = area > 0.0f ? centroid / area : glm::vec3(0.0f);
+        float length = glm::length(normal);
+        normals[c] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // clusters that face away from the centre are likely to occlude the others, draw them first
+    std::vector<float> keys(clusterCount);
+    for(size_t c = 0; c < clusterCount; c++) {
+        keys[c] = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    }
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for(size_t c : order) {
+        result.insert(result.end(), indices.begin() + 3 * clusterStarts[c], indices.begin() + 3 * clusterStarts[c + 1]);
+    }
+    return result;
+}
+
+void optimizeVertexFetch(CookedMesh &mesh)
+{
+    constexpr uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(mesh.vertices.size(), unused);
+    std::vector<tga::Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for(uint32_t &index : mesh.indices) {
+        if(remap[index] == unused) {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    // unreferenced vertices are dropped
+    mesh.vertices = std::move(vertices);
+}
+
+void optimizeMesh(CookedMesh &mesh)
+{
+    weldVertices(mesh);
+    mesh.indices = optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    mesh.indices = optimizeOverdraw(mesh.indices, mesh.vertices, OVERDRAW_THRESHOLD);
+    optimizeVertexFetch(mesh);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshCache.h"
+
+/*
+ * Cook-time reordering of indexed triangle meshes for the GPU: welding of identical vertices, triangle order for the
+ * post-transform cache (Forsyth, "Linear-Speed Vertex Cache Optimisation"), cluster order against overdraw
+ * (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw") and vertex order for fetch.
+ */
+
+struct VertexCacheStats {
+    /* transformed vertices per triangle, 0.5 is the ideal for regular grids, 3 the worst case */
+    float acmr;
+    /* transformed vertices per unique vertex, 1 is ideal */
+    float atvr;
+};
+
+/* triangle ids per vertex, in CSR layout: the triangles of v are triangles[offsets[v]..offsets[v + 1]) */
+struct TriangleAdjacency {
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    TriangleAdjacency(const std::vector<uint32_t> &indices, size_t vertexCount);
+};
+
+/* simulates a FIFO post-transform cache of cacheSize entries */
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, size_t cacheSize = 16);
+
+/* merges bitwise identical vertices, returns the new vertex count */
+size_t weldVertices(CookedMesh &mesh);
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount);
+/* keeps the cache-friendly order within clusters, clusters facing outwards are drawn first. threshold is the
+   allowed ACMR increase (e.g. 1.05) in exchange for smaller clusters */
+std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t> &indices, const std::vector<tga::Vertex> &vertices, float threshold);
+/* reorders vertices by first use and rewrites the indices accordingly */
+void optimizeVertexFetch(CookedMesh &mesh);
+
+/* all of the above in order */
+void optimizeMesh(CookedMesh &mesh);
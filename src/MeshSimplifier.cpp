@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+namespace {
+
+/* symmetric 4x4 matrix of the plane equations' outer products, upper triangle */
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+    /* total area of the planes, error() / weight is a mean squared distance */
+    double weight = 0;
+
+    void addPlane(glm::dvec3 n, double d, double weight)
+    {
+        this->weight += weight;
+        a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a03 += weight * n.x * d;
+        a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a13 += weight * n.y * d;
+        a22 += weight * n.z * n.z; a23 += weight * n.z * d;
+        a33 += weight * d * d;
+    }
+
+    Quadric &operator+=(const Quadric &o)
+    {
+        a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+        a11 += o.a11; a12 += o.a12; a13 += o.a13;
+        a22 += o.a22; a23 += o.a23;
+        a33 += o.a33;
+        weight += o.weight;
+        return *this;
+    }
+
+    /* sum of squared, area weighted distances of p to the accumulated planes */
+    double error(glm::dvec3 p) const
+    {
+        double e = a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x
+                 + a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y
+                 + a22 * p.z * p.z + 2.0 * a23 * p.z
+                 + a33;
+        return std::max(e, 0.0);
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+    /* root mean squared distance to the merged planes */
+    double distance;
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+    return (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<tga::Vertex> &vertices, const std::vector<uint32_t> &indices, size_t targetIndexCount, float &error)
+{
+    size_t vertexCount = vertices.size();
+    error = 0.0f;
+
+    // Vertices split along attribute seams or hard edges share a position. Collapses move whole positions, each
+    // copy onto the copy of the target position it shares an edge with, so seams stay closed.
+    std::vector<uint32_t> positionId(vertexCount);
+    size_t positionCount = 0;
+    {
+        auto hash = [&](uint32_t i) { return std::hash<float>{}(vertices[i].position.x) ^ (std::hash<float>{}(vertices[i].position.y) << 1) ^ (std::hash<float>{}(vertices[i].position.z) << 2); };
+        auto equal = [&](uint32_t a, uint32_t b) { return vertices[a].position == vertices[b].position; };
+        std::unordered_map<uint32_t, uint32_t, decltype(hash), decltype(equal)> unique{vertexCount, hash, equal};
+        for(uint32_t v = 0; v < vertexCount; v++) {
+            positionId[v] = unique.emplace(v, static_cast<uint32_t>(positionCount)).first->second;
+            positionCount += positionId[v] == positionCount;
+        }
+    }
+    std::vector<uint32_t> copyOffsets(positionCount + 1, 0), copies(vertexCount);
+    for(uint32_t v = 0; v < vertexCount; v++) {
+        copyOffsets[positionId[v] + 1]++;
+    }
+    std::partial_sum(copyOffsets.begin(), copyOffsets.end(), copyOffsets.begin());
+    {
+        std::vector<uint32_t> fill(copyOffsets.begin(), copyOffsets.end() - 1);
+        for(uint32_t v = 0; v < vertexCount; v++) {
+            copies[fill[positionId[v]]++] = v;
+        }
+    }
+
+    // an edge with a single triangle is on an open border, moving its ends would open or shrink the hole
+    std::vector<bool> locked(positionCount, false);
+    std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+    for(size_t i = 0; i < indices.size(); i += 3) {
+        for(int k = 0; k < 3; k++) {
+            edgeTriangles[edgeKey(positionId[indices[i + k]], positionId[indices[i + (k + 1) % 3]])]++;
+        }
+    }
+    for(auto [key, count] : edgeTriangles) {
+        if(count == 1) {
+            locked[key >> 32] = locked[key & 0xffffffffu] = true;
+        }
+    }
+
+    std::vector<Quadric> quadrics(positionCount);
+    for(size_t i = 0; i < indices.size(); i += 3) {
+        glm::dvec3 a{vertices[indices[i]].position}, b{vertices[indices[i + 1]].position}, c{vertices[indices[i + 2]].position};
+        glm::dvec3 n = glm::cross(b - a, c - a);
+        double area = glm::length(n);
+        if(area <= 0.0) {
+            continue;
+        }
+        n /= area;
+        Quadric q;
+        q.addPlane(n, -glm::dot(n, a), area);
+        for(int k = 0; k < 3; k++) {
+            quadrics[positionId[indices[i + k]]] += q;
+        }
+    }
+
+    std::vector<uint32_t> result = indices;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint32_t> pendingRemap;
+    std::vector<bool> touched(positionCount);
+    std::vector<Collapse> candidates;
+    double maxError = 0.0;
+    while(result.size() > targetIndexCount) {
+        candidates.clear();
+        for(size_t i = 0; i < result.size(); i += 3) {
+            for(int k = 0; k < 3; k++) {
+                uint32_t a = positionId[result[i + k]], b = positionId[result[i + (k + 1) % 3]];
+                for(auto [from, to] : { std::pair{a, b}, std::pair{b, a} }) {
+                    if(!locked[from]) {
+                        Quadric q = quadrics[from];
+                        q += quadrics[to];
+                        double cost = q.error(glm::dvec3{vertices[copies[copyOffsets[to]]].position});
+                        candidates.push_back({ from, to, cost, q.weight > 0.0 ? std::sqrt(cost / q.weight) : 0.0 });
+                    }
+                }
+            }
+        }
+        if(candidates.empty()) {
+            break;
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        TriangleAdjacency adjacency{result, vertexCount};
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        for(const Collapse &c : candidates) {
+            if(touched[c.from] || touched[c.to]) {
+                continue;
+            }
+            glm::vec3 target = vertices[copies[copyOffsets[c.to]]].position;
+            bool valid = true;
+            size_t degenerate = 0;
+            pendingRemap.clear();
+            for(uint32_t ci = copyOffsets[c.from]; ci < copyOffsets[c.from + 1] && valid; ci++) {
+                uint32_t u = copies[ci];
+                uint32_t partner = ~0u;
+                for(uint32_t i = adjacency.offsets[u]; i < adjacency.offsets[u + 1] && valid; i++) {
+                    const uint32_t *triangle = &result[3 * adjacency.triangles[i]];
+                    uint32_t t[3] = { remap[triangle[0]], remap[triangle[1]], remap[triangle[2]] };
+                    bool collapses = false;
+                    for(int k = 0; k < 3; k++) {
+                        if(positionId[t[k]] == c.to) {
+                            partner = t[k];
+                            collapses = true;
+                        }
+                    }
+                    if(collapses) {
+                        degenerate++;
+                        continue;
+                    }
+                    // reject collapses that flip a remaining triangle
+                    glm::vec3 p[3], q[3];
+                    for(int k = 0; k < 3; k++) {
+                        p[k] = vertices[t[k]].position;
+                        q[k] = positionId[t[k]] == c.from ? target : p[k];
+                    }
+                    valid = glm::dot(glm::cross(p[1] - p[0], p[2] - p[0]), glm::cross(q[1] - q[0], q[2] - q[0])) > 0.0f;
+                }
+                // a copy without an edge to the target would have to take on attributes from elsewhere
+                if(adjacency.offsets[u + 1] > adjacency.offsets[u]) {
+                    valid = valid && partner != ~0u;
+                    pendingRemap.push_back(u);
+                    pendingRemap.push_back(partner);
+                }
+            }
+            if(!valid) {
+                continue;
+            }
+            for(size_t i = 0; i < pendingRemap.size(); i += 2) {
+                remap[pendingRemap[i]] = pendingRemap[i + 1];
+            }
+            touched[c.from] = touched[c.to] = true;
+            quadrics[c.to] += quadrics[c.from];
+            maxError = std::max(maxError, c.distance);
+            // triangles along the collapsed edge are counted once per copy of it
+            removed += degenerate;
+            if(removed >= trianglesToRemove) {
+                break;
+            }
+        }
+        if(removed == 0) {
+            break;
+        }
+
+        size_t out = 0;
+        for(size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if(a != b && b != c && c != a) {
+                result[out++] = a;
+                result[out++] = b;
+                result[out++] = c;
+            }
+        }
+        result.resize(out);
+    }
+    error = static_cast<float>(maxError);
+    return result;
+}
+
+void generateLods(CookedMesh &mesh, size_t maxLods)
+{
+    mesh.lods.clear();
+    mesh.lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+    std::vector<uint32_t> previous = mesh.indices;
+    while(mesh.lods.size() < maxLods) {
+        float error;
+        std::vector<uint32_t> lod = simplifyMesh(mesh.vertices, previous, previous.size() / 6 * 3, error);
+        // stop once locked borders keep the mesh from shrinking noticeably
+        if(lod.size() > previous.size() * 9 / 10) {
+            break;
+        }
+        lod = optimizeVertexCache(lod, mesh.vertices.size());
+        // error is measured against the previous LOD, the deviations of successive steps add up
+        mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(lod.size()), mesh.lods.back().error + error });
+        mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+        previous = std::move(lod);
+    }
+}
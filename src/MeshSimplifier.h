@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshCache.h"
+
+/*
+ * Quadric error metric simplification (Garland and Heckbert) by edge collapses onto existing vertices, so every LOD
+ * indexes the same vertex buffer. Vertices split along attribute seams move together, vertices on open borders are
+ * kept in place.
+ */
+
+/* Collapses edges until at most targetIndexCount indices remain or nothing can be collapsed. error receives the
+   largest geometric deviation introduced, in object space units. */
+std::vector<uint32_t> simplifyMesh(const std::vector<tga::Vertex> &vertices, const std::vector<uint32_t> &indices, size_t targetIndexCount, float &error);
+
+/* Appends LODs with halving triangle counts to mesh.indices and fills mesh.lods, LOD 0 being the input mesh. Each
+   LOD is simplified from the one before, its error is the sum of the steps' errors, a bound on the deviation from
+   LOD 0. */
+void generateLods(CookedMesh &mesh, size_t maxLods);
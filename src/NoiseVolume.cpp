@@ -0,0 +1,299 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "NoiseVolume.h"
+#include "MappedFile.h"
+#include "parallel.h"
+#include "simd.h"
+
+using simd::float4;
+
+namespace {
+
+constexpr char NOISE_MAGIC[8] = { 'F', 'O', 'G', 'N', 'O', 'I', 'S', 'E' };
+constexpr uint32_t NOISE_VERSION = 1;
+
+struct NoiseHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t size;
+    uint32_t octaves;
+    uint32_t period;
+    float worley;
+    uint32_t seed;
+    uint64_t dataSize;
+};
+
+typedef std::chrono::high_resolution_clock clock;
+typedef std::chrono::duration<double, std::milli> duration;
+
+// the generation shader's hash
+uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t hashCell(uint32_t seed, uint32_t x, uint32_t y, uint32_t z)
+{
+    return hash(hash(hash(x ^ seed) ^ y) ^ z);
+}
+
+uint32_t wrap(int32_t i, uint32_t period)
+{
+    int32_t p = static_cast<int32_t>(period);
+    i %= p;
+    return static_cast<uint32_t>(i < 0 ? i + p : i);
+}
+
+// the edge midpoints of a cube, Perlin's improved gradients
+constexpr float GRADIENTS[12][3] = {
+    { 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+    { 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+    { 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 },
+};
+
+float4 fade(float4 t)
+{
+    return t * t * t * (t * (t * float4(6.0f) - 15.0f) + 10.0f);
+}
+
+float fade(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+/*
+ * The lattice of one octave along a row of texels: y and z are shared by the row, so the hashes only depend on the
+ * x cell and are looked up once per cell into tables instead of once per texel. Coordinates are in lattice cells,
+ * the lattice repeats every period cells. Tables hold the cells -1 to period, so neighbours need no wrapping.
+ */
+class RowLattice {
+public:
+    struct Point {
+        float x, y, z;
+    };
+
+    RowLattice(uint32_t seed, uint32_t period, float py, float pz) : period{period}, py{py}, pz{pz}
+    {
+        iy = static_cast<int32_t>(std::floor(py));
+        iz = static_cast<int32_t>(std::floor(pz));
+        fy = py - iy;
+        fz = pz - iz;
+        size_t cells = period + 2;
+        gradients.resize(4 * cells);
+        for(int corner = 0; corner < 4; corner++) {
+            uint32_t cy = wrap(iy + (corner & 1), period), cz = wrap(iz + (corner >> 1), period);
+            for(size_t c = 0; c < cells; c++) {
+                gradients[corner * cells + c] = GRADIENTS[hashCell(seed, wrap(static_cast<int32_t>(c) - 1, period), cy, cz) % 12];
+            }
+        }
+        points.resize(9 * cells);
+        for(int n = 0; n < 9; n++) {
+            int dy = n % 3 - 1, dz = n / 3 - 1;
+            uint32_t cy = wrap(iy + dy, period), cz = wrap(iz + dz, period);
+            for(size_t c = 0; c < cells; c++) {
+                // a second hash, so the points do not line up with the Perlin gradients
+                uint32_t h = hash(hashCell(seed, wrap(static_cast<int32_t>(c) - 1, period), cy, cz));
+                points[n * cells + c] = { static_cast<float>(c) - 1.0f + (h & 1023u) / 1023.0f,
+                                          static_cast<float>(iy + dy) + ((h >> 10) & 1023u) / 1023.0f,
+                                          static_cast<float>(iz + dz) + ((h >> 20) & 1023u) / 1023.0f };
+            }
+        }
+    }
+
+    /* gradient noise at four points of the row, roughly in [-1, 1] */
+    float4 perlin(float4 px) const
+    {
+        int32_t ix[4];
+        float4 fx = cells(px, ix);
+        size_t stride = period + 2;
+        float4 corners[8];
+        for(int c = 0; c < 8; c++) {
+            int dx = c & 1, corner = c >> 1;
+            float gx[4], gy[4], gz[4];
+            for(int l = 0; l < 4; l++) {
+                const float *g = gradients[corner * stride + ix[l] + dx + 1];
+                gx[l] = g[0];
+                gy[l] = g[1];
+                gz[l] = g[2];
+            }
+            corners[c] = float4::load(gx) * (fx - float4(static_cast<float>(dx)))
+                + float4::load(gy) * float4(fy - (corner & 1)) + float4::load(gz) * float4(fz - (corner >> 1));
+        }
+        float4 u = fade(fx);
+        float v = fade(fy), w = fade(fz);
+        float4 z0 = simd::mix(simd::mix(corners[0], corners[1], u), simd::mix(corners[2], corners[3], u), v);
+        float4 z1 = simd::mix(simd::mix(corners[4], corners[5], u), simd::mix(corners[6], corners[7], u), v);
+        return simd::mix(z0, z1, w);
+    }
+
+    /* one minus the distance to the nearest of one random point per cell, in [0, 1] */
+    float4 worley(float4 px) const
+    {
+        int32_t ix[4];
+        cells(px, ix);
+        size_t stride = period + 2;
+        float4 nearest = 3.0f;
+        for(int n = 0; n < 9; n++) {
+            for(int dx = -1; dx <= 1; dx++) {
+                float ox[4], oy[4], oz[4];
+                for(int l = 0; l < 4; l++) {
+                    const Point &point = points[n * stride + ix[l] + dx + 1];
+                    ox[l] = point.x;
+                    oy[l] = point.y;
+                    oz[l] = point.z;
+                }
+                float4 ddx = px - float4::load(ox);
+                float4 ddy = float4(py) - float4::load(oy);
+                float4 ddz = float4(pz) - float4::load(oz);
+                nearest = simd::min(nearest, ddx * ddx + ddy * ddy + ddz * ddz);
+            }
+        }
+        return float4(1.0f) - simd::clamp(simd::sqrt(nearest), 0.0f, 1.0f);
+    }
+
+private:
+    /* cell of each lane in [0, period), and the fraction into it */
+    float4 cells(float4 px, int32_t ix[4]) const
+    {
+        float4 cellX = simd::floor(px);
+        for(int l = 0; l < 4; l++) {
+            ix[l] = std::min(static_cast<int32_t>(cellX[l]), static_cast<int32_t>(period) - 1);
+        }
+        return px - cellX;
+    }
+
+    uint32_t period;
+    float py, pz;
+    int32_t iy, iz;
+    float fy, fz;
+    std::vector<const float *> gradients;
+    std::vector<Point> points;
+};
+
+void bakeRow(const NoiseParams &params, uint32_t y, uint32_t z, uint8_t *out)
+{
+    const float invSize = 1.0f / params.size;
+    const float v = (y + 0.5f) * invSize, w = (z + 0.5f) * invSize;
+    std::vector<RowLattice> octaves;
+    octaves.reserve(params.octaves);
+    uint32_t period = params.period;
+    for(uint32_t octave = 0; octave < params.octaves; octave++) {
+        octaves.emplace_back(hash(params.seed + octave), period, v * period, w * period);
+        period *= 2;
+    }
+    for(uint32_t x = 0; x < params.size; x += 4) {
+        // texel centres in [0, 1), as the sampler sees them
+        float4 u = (float4(static_cast<float>(x), x + 1.0f, x + 2.0f, x + 3.0f) + 0.5f) * invSize;
+        float4 sum = 0.0f;
+        float weight = 1.0f, weights = 0.0f;
+        period = params.period;
+        for(const RowLattice &lattice : octaves) {
+            float4 px = u * float4(static_cast<float>(period));
+            float4 value = float4(0.5f) + lattice.perlin(px);
+            if(params.worley > 0.0f) {
+                value = simd::mix(value, lattice.worley(px), params.worley);
+            }
+            sum = sum + float4(weight) * value;
+            weights += weight;
+            weight *= 0.5f;
+            period *= 2;
+        }
+        float4 texel = simd::clamp(sum * float4(1.0f / weights), 0.0f, 1.0f) * float4(255.0f) + 0.5f;
+        for(uint32_t l = 0; l < 4 && x + l < params.size; l++) {
+            out[x + l] = static_cast<uint8_t>(texel[l]);
+        }
+    }
+}
+
+bool writeNoiseVolume(const std::string &path, const NoiseVolume &volume)
+{
+    NoiseHeader header{};
+    std::memcpy(header.magic, NOISE_MAGIC, sizeof(NOISE_MAGIC));
+    header.version = NOISE_VERSION;
+    header.size = volume.params.size;
+    header.octaves = volume.params.octaves;
+    header.period = volume.params.period;
+    header.worley = volume.params.worley;
+    header.seed = volume.params.seed;
+    header.dataSize = volume.texels.size();
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out{tmpPath, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(volume.texels.data()), volume.texels.size());
+        if(!out) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    return !ec;
+}
+
+}
+
+float NoiseVolume::texel(int32_t x, int32_t y, int32_t z) const
+{
+    uint32_t size = params.size;
+    return texels[(size_t(wrap(z, size)) * size + wrap(y, size)) * size + wrap(x, size)] / 255.0f;
+}
+
+NoiseVolume bakeNoiseVolume(const NoiseParams &params)
+{
+    clock::time_point start = clock::now();
+    NoiseVolume volume;
+    volume.params = params;
+    uint32_t size = params.size;
+    volume.texels.resize(size_t(size) * size * size);
+    parallelFor(size_t(size) * size, 16, [&](size_t begin, size_t end) {
+        for(size_t row = begin; row < end; row++) {
+            bakeRow(params, static_cast<uint32_t>(row % size), static_cast<uint32_t>(row / size), volume.texels.data() + row * size);
+        }
+    });
+    volume.bakeMillis = duration(clock::now() - start).count();
+    return volume;
+}
+
+std::string noiseVolumePath(const std::string &dir, const NoiseParams &params)
+{
+    std::string name = "fog_noise_" + std::to_string(params.size) + "_o" + std::to_string(params.octaves) + "_p" + std::to_string(params.period)
+        + "_w" + std::to_string(static_cast<int>(std::lround(params.worley * 1000.0f))) + "_s" + std::to_string(params.seed) + ".noise";
+    return (std::filesystem::path(dir) / name).string();
+}
+
+NoiseVolume loadNoiseVolume(const std::string &dir, const NoiseParams &params, bool rebake)
+{
+    std::string path = noiseVolumePath(dir, params);
+    if(!rebake) {
+        MappedFile file{path};
+        NoiseHeader header;
+        if(file && file.size() >= sizeof(header)) {
+            std::memcpy(&header, file.data(), sizeof(header));
+            // the name rounds the Worley weight, the header has it exactly
+            bool valid = std::memcmp(header.magic, NOISE_MAGIC, sizeof(NOISE_MAGIC)) == 0
+                && header.version == NOISE_VERSION
+                && header.size == params.size && header.octaves == params.octaves && header.period == params.period
+                && header.worley == params.worley && header.seed == params.seed
+                && header.dataSize == size_t(params.size) * params.size * params.size
+                && file.size() == sizeof(header) + header.dataSize;
+            if(valid) {
+                NoiseVolume volume;
+                volume.params = params;
+                volume.texels.assign(file.data() + sizeof(header), file.data() + file.size());
+                return volume;
+            }
+        }
+    }
+    NoiseVolume volume = bakeNoiseVolume(params);
+    writeNoiseVolume(path, volume);
+    return volume;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Tileable fBm baked into a 3D r8 volume, so the fog's density function takes one 3D fetch per froxel instead of
+ * four octaves of two dependent lookups into a 2D noise texture. Each octave sums Perlin gradient noise and inverted
+ * Worley cell noise on lattices whose periods divide the volume, so it wraps without seams under repeat addressing.
+ * Volumes are cached on disk per parameters, see loadNoiseVolume().
+ */
+struct NoiseParams {
+    /* texels per edge */
+    uint32_t size = 128;
+    uint32_t octaves = 4;
+    /* lattice cells per edge in the first octave, doubling with each further one */
+    uint32_t period = 4;
+    /* weight of the Worley noise against the Perlin noise, 0 for Perlin alone */
+    float worley = 0.3f;
+    uint32_t seed = 1;
+
+    bool operator==(const NoiseParams &other) const = default;
+};
+
+struct NoiseVolume {
+    NoiseParams params;
+    /* x-major, i.e. index = (z * size + y) * size + x, like a 3D texture */
+    std::vector<uint8_t> texels;
+    /* how long baking took, when it was baked rather than read from the cache */
+    double bakeMillis = 0.0;
+
+    explicit operator bool() const { return !texels.empty(); }
+    /* the texel at integer coordinates, wrapped into the volume like repeat addressing, in [0, 1] */
+    float texel(int32_t x, int32_t y, int32_t z) const;
+};
+
+/* computes the volume on all cores, four texels of a row at a time */
+NoiseVolume bakeNoiseVolume(const NoiseParams &params);
+/* the cache file of params in directory dir, named by the parameters */
+std::string noiseVolumePath(const std::string &dir, const NoiseParams &params);
+/* Reads the volume of params from dir, baking and caching it first if there is none or rebake is set. The volume is
+   still returned if it cannot be written. */
+NoiseVolume loadNoiseVolume(const std::string &dir, const NoiseParams &params, bool rebake = false);
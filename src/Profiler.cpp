@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <fstream>
+
+#include "Profiler.h"
+
+namespace {
+
+/* small ids in order of first use, Chrome trace sorts tracks by them */
+uint32_t currentThread()
+{
+    static std::atomic<uint32_t> next{1};
+    thread_local uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void writeEscaped(std::ostream &out, const char *s)
+{
+    for(; *s; ++s) {
+        if(*s == '"' || *s == '\\') {
+            out << '\\';
+        }
+        out << *s;
+    }
+}
+
+}
+
+Profiler::Profiler(size_t capacity)
+    : startTime{clock::now()}, slots{std::make_unique<Slot[]>(std::bit_ceil(std::max<size_t>(capacity, 2)))},
+      mask{std::bit_ceil(std::max<size_t>(capacity, 2)) - 1}
+{
+}
+
+int64_t Profiler::sinceStart(clock::time_point t) const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t - startTime).count();
+}
+
+void Profiler::push(const Event &event)
+{
+    uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = slots[index & mask];
+    // seqlock: odd while writing, readers retry or skip
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.sequence.store(2 * (index + 1), std::memory_order_release);
+}
+
+void Profiler::span(const char *name, Track track, clock::time_point start, clock::time_point end)
+{
+    push({ name, sinceStart(start), sinceStart(end) - sinceStart(start), 0.0, track == Track::cpu ? currentThread() : 0, track, false });
+}
+
+void Profiler::counter(const char *name, double value)
+{
+    push({ name, sinceStart(clock::now()), 0, value, 0, Track::cpu, true });
+}
+
+std::vector<Profiler::Event> Profiler::events() const
+{
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > mask + 1 ? end - (mask + 1) : 0;
+    std::vector<Event> result;
+    result.reserve(end - begin);
+    for(uint64_t index = begin; index < end; ++index) {
+        const Slot &slot = slots[index & mask];
+        uint64_t expected = 2 * (index + 1);
+        if(slot.sequence.load(std::memory_order_acquire) != expected) {
+            continue;
+        }
+        Event event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.sequence.load(std::memory_order_relaxed) == expected) {
+            result.push_back(event);
+        }
+    }
+    return result;
+}
+
+uint64_t Profiler::recorded() const
+{
+    return head.load(std::memory_order_relaxed);
+}
+
+std::vector<std::pair<std::string, double>> Profiler::cpuTotals(clock::time_point since) const
+{
+    std::vector<std::pair<std::string, double>> totals;
+    int64_t from = sinceStart(since);
+    for(const Event &event : events()) {
+        if(event.counter || event.track != Track::cpu || event.start < from) {
+            continue;
+        }
+        auto it = std::find_if(totals.begin(), totals.end(), [&](const auto &total) { return total.first == event.name; });
+        if(it == totals.end()) {
+            totals.emplace_back(event.name, 0.0);
+            it = totals.end() - 1;
+        }
+        it->second += event.duration * 1e-6;
+    }
+    return totals;
+}
+
+bool Profiler::writeChromeTrace(const std::string &path) const
+{
+    std::ofstream out{path, std::ios::trunc};
+    if(!out) {
+        return false;
+    }
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+    char number[64];
+    for(const Event &event : events()) {
+        out << ",\n{\"name\":\"";
+        writeEscaped(out, event.name);
+        // microseconds
+        std::snprintf(number, sizeof(number), "%.3f", event.start / 1000.0);
+        if(event.counter) {
+            out << "\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << number;
+            std::snprintf(number, sizeof(number), "%.6g", event.value);
+            out << ",\"args\":{\"value\":" << number << "}}";
+        } else {
+            out << "\",\"cat\":\"" << (event.track == Track::gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << number;
+            std::snprintf(number, sizeof(number), "%.3f", event.duration / 1000.0);
+            out << ",\"dur\":" << number << "}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+ProfileScope::ProfileScope(Profiler &profiler, const char *name) : profiler{&profiler}, name{name}, start{Profiler::clock::now()} {}
+
+ProfileScope::~ProfileScope()
+{
+    profiler->span(name, Profiler::Track::cpu, start, Profiler::clock::now());
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Named timing spans and counters in a fixed-size ring buffer, exportable as Chrome trace JSON (chrome://tracing or
+ * ui.perfetto.dev). Recording is lock-free, any thread may record; once the ring is full the oldest events are
+ * overwritten. Names are not copied, they must outlive the profiler, e.g. string literals.
+ *
+ * Spans nest by time, ProfileScope records one for its lifetime on the calling thread's track. GPU work goes on its
+ * own track with the times it was observed at by the CPU.
+ */
+class Profiler {
+public:
+    typedef std::chrono::steady_clock clock;
+
+    enum class Track : uint8_t { cpu, gpu };
+
+    struct Event {
+        const char *name;
+        /* nanoseconds since the profiler's creation */
+        int64_t start;
+        int64_t duration;
+        /* counters only */
+        double value;
+        uint32_t thread;
+        Track track;
+        bool counter;
+    };
+
+    /* capacity is rounded up to a power of two */
+    explicit Profiler(size_t capacity = 1 << 16);
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    void span(const char *name, Track track, clock::time_point start, clock::time_point end);
+    /* shown as a graph over time */
+    void counter(const char *name, double value);
+
+    /* the events still in the ring, oldest first; slots overwritten while copying are skipped */
+    std::vector<Event> events() const;
+    /* false if the file could not be written */
+    bool writeChromeTrace(const std::string &path) const;
+    uint64_t recorded() const;
+    /* summed duration in milliseconds per CPU span name, of the spans starting at or after since, in order of first
+       occurrence */
+    std::vector<std::pair<std::string, double>> cpuTotals(clock::time_point since) const;
+
+private:
+    struct Slot {
+        /* even when complete: 2 * (index + 1) of the event in it */
+        std::atomic<uint64_t> sequence{0};
+        Event event;
+    };
+
+    void push(const Event &event);
+    int64_t sinceStart(clock::time_point t) const;
+
+    clock::time_point startTime;
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    std::atomic<uint64_t> head{0};
+};
+
+/* records a CPU span from construction to destruction */
+class ProfileScope {
+public:
+    ProfileScope(Profiler &profiler, const char *name);
+    ~ProfileScope();
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    Profiler *profiler;
+    const char *name;
+    Profiler::clock::time_point start;
+};
@@ -0,0 +1,59 @@
+#include <algorithm>
+
+#include "RenderQueue.h"
+
+uint64_t drawSortKey(uint32_t pass, uint32_t material, uint32_t mesh, uint32_t lod)
+{
+    return (uint64_t(pass & 0xfu) << 60) | (uint64_t(material & 0xfffffu) << 40) | (uint64_t(mesh & 0xfffffu) << 20) | (lod & 0xfffffu);
+}
+
+void RenderQueue::compile(uint32_t pass, const std::vector<DrawBatch> &batches)
+{
+    packets.clear();
+    for(uint32_t b = 0; b < batches.size(); ++b) {
+        const DrawBatch &batch = batches[b];
+        size_t lodCount = std::min(batch.drawable->lodCount(), MAX_DRAW_LODS);
+        // the draws of one mesh cover all its visible instances, coarser LODs are the farther ones
+        for(uint32_t lod = 0; lod < lodCount; ++lod) {
+            packets.push_back({ drawSortKey(pass, batch.material, batch.mesh, lod), batch.drawable, batch.materialSet, batch.material, b, lod, batch.firstInstance });
+        }
+    }
+    std::sort(packets.begin(), packets.end(), [](const Packet &a, const Packet &b) { return a.key < b.key; });
+}
+
+RecordStats RenderQueue::record(tga::CommandRecorder &recorder, const LodSelection &lods, bool positionsOnly) const
+{
+    RecordStats stats;
+    uint32_t boundMaterial = NO_MATERIAL;
+    uint32_t batch = ~0u;
+    uint32_t firstInstance = 0;
+    for(const Packet &packet : packets) {
+        // a batch's LODs are adjacent and ascending, matching the grouping of its visible ids
+        if(packet.batch != batch) {
+            batch = packet.batch;
+            firstInstance = packet.firstInstance;
+        }
+        uint32_t count = lods[packet.batch * MAX_DRAW_LODS + packet.lod];
+        if(count == 0) {
+            continue;
+        }
+        if(packet.material != boundMaterial) {
+            recorder.bindInputSet(packet.materialSet);
+            boundMaterial = packet.material;
+            stats.binds++;
+        }
+        if(positionsOnly) {
+            packet.drawable->drawPositions(recorder, packet.lod, count, firstInstance);
+        } else {
+            packet.drawable->draw(recorder, packet.lod, count, firstInstance);
+        }
+        firstInstance += count;
+        stats.draws++;
+    }
+    return stats;
+}
+
+size_t RenderQueue::packetCount() const
+{
+    return packets.size();
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tga/tga.hpp"
+#include "Drawable.h"
+
+/*
+ * The draws of one demo in one pass, compiled into a flat array of packets ordered by 64 bit sort keys. Compiling
+ * happens when the demo's meshes or the pass change; recording walks the array with the frame's LOD counts, without
+ * any lookups, and binds a material only when it differs from the previous draw's.
+ */
+
+/* most significant first: pass (4 bits), material (20 bits), mesh (20 bits), LOD (20 bits). A packet draws all of a
+   mesh's instances at one LOD wherever they are, so there is no single depth to order packets front to back by */
+uint64_t drawSortKey(uint32_t pass, uint32_t material, uint32_t mesh, uint32_t lod);
+
+/* handle of "no material", draws of passes without per-mesh inputs */
+constexpr uint32_t NO_MATERIAL = 0;
+/* LOD counts of the frame are stored with this stride per batch */
+constexpr size_t MAX_DRAW_LODS = 8;
+
+/* per batch of a queue, how many visible instances use each LOD, MAX_DRAW_LODS entries per batch. The ids of a
+   batch's visible instances are grouped by LOD in the same order, starting at its firstInstance */
+typedef std::vector<uint32_t> LodSelection;
+
+/* all instances of one mesh, a range of the pass' visible instance ids */
+struct DrawBatch {
+    /* interned handles, meshes and materials with equal handles draw and bind the same */
+    uint32_t mesh;
+    uint32_t material;
+    const Drawable *drawable;
+    /* bound before the batch's draws, unless the previous draw used the same material */
+    tga::InputSet materialSet;
+    uint32_t firstInstance;
+};
+
+struct RecordStats {
+    size_t draws = 0;
+    size_t binds = 0;
+};
+
+class RenderQueue {
+public:
+    /* one packet per batch and LOD, batches are indexed as in the frame's LodSelection */
+    void compile(uint32_t pass, const std::vector<DrawBatch> &batches);
+    /* draws every packet with visible instances, from the position-only stream if positionsOnly is set */
+    RecordStats record(tga::CommandRecorder &recorder, const LodSelection &lods, bool positionsOnly) const;
+    size_t packetCount() const;
+
+private:
+    struct Packet {
+        uint64_t key;
+        const Drawable *drawable;
+        tga::InputSet materialSet;
+        uint32_t material;
+        uint32_t batch;
+        uint32_t lod;
+        uint32_t firstInstance;
+    };
+
+    std::vector<Packet> packets;
+};
@@ -1,8 +1,8 @@
 #include "Scene.h"
 
-Scene::Scene(tga::Interface& tgai)
+Scene::Scene(tga::Interface& tgai, uint32_t slots)
 {
-	prepareSceneUniformBuffer(tgai);
+	prepareSceneUniformBuffer(tgai, slots);
 }
 
 void Scene::initCamera(const glm::vec3& pos, float pitch, float yaw, float roll)
@@ -12,62 +12,87 @@ void Scene::initCamera(const glm::vec3& pos, float pitch, float yaw, float roll)
 
 void Scene::setDirLight(const glm::vec3& direction, const glm::vec3& color)
 {
-	pSceneStagingBuffer->dirLight.direction = direction;
-	pSceneStagingBuffer->dirLight.color = color;
+	sceneData.dirLight.direction = direction;
+	sceneData.dirLight.color = color;
 }
 
 void Scene::addPointLight(const glm::vec3& position, const glm::vec3& color, const glm::vec3& attenuationFactors)
 {
-	if(pSceneStagingBuffer->nrPointLights == MAX_NR_OF_POINT_LIGHTS)
+	if(pointLights.size() == MAX_POINT_LIGHTS)
 	{
-		std::cout << "Maximum number of point lights is reached. If you want more lights please change MAX_NR_OF_POINT_LIGHTS\n";
+		std::cout << "Maximum number of point lights is reached. If you want more lights please change MAX_POINT_LIGHTS\n";
 		return;
 	}
 
-	pSceneStagingBuffer->pointLights[pSceneStagingBuffer->nrPointLights] = PointLight{position, color, attenuationFactors};
-	++pSceneStagingBuffer->nrPointLights;
+	pointLights.push_back(PointLight{position, color, attenuationFactors});
+	pointLightsChanged = true;
+}
+
+void Scene::clearPointLights()
+{
+	pointLights.clear();
+	pointLightsChanged = true;
 }
 
 void Scene::setAmbientFactor(float ambientFactor)
 {
-	pSceneStagingBuffer->ambientFactor = ambientFactor;
+	sceneData.ambientFactor = ambientFactor;
 }
 
-void Scene::prepareSceneUniformBuffer(tga::Interface& tgai)
+void Scene::prepareSceneUniformBuffer(tga::Interface& tgai, uint32_t slots)
 {
-	sceneStagingBuffer = tgai.createStagingBuffer({ sizeof(SceneUniformBuffer) });
-	// Map it and store to update it in runtime
-	pSceneStagingBuffer = (SceneUniformBuffer*)(tgai.getMapping(sceneStagingBuffer));
-	new(pSceneStagingBuffer) SceneUniformBuffer {
+	// Kept on the CPU and staged per frame in flight, see stage()
+	sceneData = SceneUniformBuffer {
         .projectionView = glm::mat4(1.0f),
         .invProjectionView = glm::mat4(1.0f),
         .cameraPos = glm::vec3(0.0f),
         .dirLight = { .direction = glm::vec3(0.0f, -1.0f, 0.0f), .color = glm::vec3(0.7f, 0.7f, 0.7f) },
-        .pointLights = {},
         .zNear = 0.0f,
         .zFar = 0.0f,
-        .nrPointLights = 0,
         .ambientFactor = 0.0f,
         .viewport = glm::uvec2(0, 0),
     };
+	sceneStaging = SlotStaging(tgai, sizeof(SceneUniformBuffer), slots);
 	// The actual buffer in GPU
-	sceneBuffer = tgai.createBuffer({ tga::BufferUsage::uniform, sizeof(SceneUniformBuffer), sceneStagingBuffer });
+	sceneBuffer = tgai.createBuffer({ tga::BufferUsage::uniform, sizeof(SceneUniformBuffer) });
+	lightStaging = SlotStaging(tgai, LightClusters::BUFFER_SIZE, slots);
+	m_lightBuffer = tgai.createBuffer({ tga::BufferUsage::storage, LightClusters::BUFFER_SIZE });
 }
 
 void Scene::updateSceneBufferCameraData(glm::uvec2 viewport)
 {
 	m_camera.setViewport(viewport);
-	pSceneStagingBuffer->projectionView = m_camera.projection() * m_camera.view();
-	pSceneStagingBuffer->invProjectionView = glm::inverse(pSceneStagingBuffer->projectionView);
-	pSceneStagingBuffer->cameraPos = m_camera.getPosition();
-	pSceneStagingBuffer->zNear = m_camera.zNear();
-	pSceneStagingBuffer->zFar = m_camera.zFar();
-	pSceneStagingBuffer->viewport = glm::vec2(viewport.x, viewport.y);
+	sceneData.projectionView = m_camera.projection() * m_camera.view();
+	sceneData.invProjectionView = glm::inverse(sceneData.projectionView);
+	sceneData.cameraPos = m_camera.getPosition();
+	sceneData.zNear = m_camera.zNear();
+	sceneData.zFar = m_camera.zFar();
+	sceneData.viewport = glm::vec2(viewport.x, viewport.y);
+}
+
+void Scene::stage(uint32_t slot)
+{
+	sceneStaging.write(slot, &sceneData, sizeof(SceneUniformBuffer));
+}
+
+void Scene::clusterLights(const FroxelFrustum& frustum, uint32_t slot)
+{
+	if(pointLightsChanged)
+	{
+		m_lightClusters.setLights(pointLights);
+		pointLightsChanged = false;
+	}
+	m_lightClusters.bin(frustum);
+	m_lightClusters.write(lightStaging.as<uint8_t>(slot));
 }
 
-void Scene::bufferUpload(tga::CommandRecorder& recorder)
+void Scene::bufferUpload(tga::CommandRecorder& recorder, uint32_t slot)
 {
-	recorder.bufferUpload(sceneStagingBuffer, sceneBuffer, sizeof(SceneUniformBuffer));
+	recorder.bufferUpload(sceneStaging.buffer(slot), sceneBuffer, sizeof(SceneUniformBuffer));
+	// the tiles and the lights in use, then the references; the rest of the buffer is never read
+	auto [lights, references] = m_lightClusters.uploadExtent();
+	recorder.bufferUpload(lightStaging.buffer(slot), m_lightBuffer, LightClusters::LIGHTS_OFFSET + lights * sizeof(GpuPointLight));
+	recorder.bufferUpload(lightStaging.buffer(slot), m_lightBuffer, references * sizeof(uint32_t), LightClusters::REFERENCES_OFFSET, LightClusters::REFERENCES_OFFSET);
 }
 
 void Scene::moveCamera(const glm::vec3& direction, float deltaTime, float speed)
@@ -95,6 +120,11 @@ void Scene::rotateCameraWithMouseInput(double xPos, double yPos)
 	m_camera.rotateWithMouseInput(xPos, yPos);
 }
 
+void Scene::setCameraPose(const glm::vec3& pos, float pitch, float yaw, float roll)
+{
+	m_camera.setPose(pos, pitch, yaw, roll);
+}
+
 void Scene::updateCameraLastMousePos(double x, double y)
 {
 	m_camera.updateLastMousePos(x, y);
@@ -105,14 +135,24 @@ tga::Buffer Scene::buffer() const
     return sceneBuffer;
 }
 
+tga::Buffer Scene::lightBuffer() const
+{
+    return m_lightBuffer;
+}
+
+const LightClusters &Scene::lightClusters() const
+{
+    return m_lightClusters;
+}
+
 const glm::mat4 &Scene::viewProjection() const
 {
-    return pSceneStagingBuffer->projectionView;
+    return sceneData.projectionView;
 }
 
 const DirLight &Scene::dirLight() const
 {
-    return pSceneStagingBuffer->dirLight;
+    return sceneData.dirLight;
 }
 
 const Camera &Scene::camera() const
@@ -4,32 +4,19 @@
 #include "tga/tga_utils.hpp"
 
 #include "Camera.h"
+#include "LightClusters.h"
+#include "Lights.h"
+#include "SlotStaging.h"
 
-struct DirLight
-{
-    alignas(16) glm::vec3 direction;
-    alignas(16) glm::vec3 color;
-};
-
-struct PointLight
-{
-    alignas(16) glm::vec3 position;
-    alignas(16) glm::vec3 color;
-    alignas(16) glm::vec3 attenuationFactors; // constant, linear and quadratic in order
-};
-
-// As they will be passed alongside the uniform the array size must be pre-specified
-#define MAX_NR_OF_POINT_LIGHTS 16
+// point lights are not part of it, they are clustered into their own storage buffer, see LightClusters
 struct SceneUniformBuffer
 {
     alignas(16) glm::mat4 projectionView;
     alignas(16) glm::mat4 invProjectionView;
     alignas(16) glm::vec3 cameraPos;
     alignas(16) DirLight dirLight;
-    alignas(16) PointLight pointLights[MAX_NR_OF_POINT_LIGHTS];
     alignas(4)  float zNear;
     alignas(4)  float zFar;
-    alignas(4)  int nrPointLights;
     alignas(4)  float ambientFactor;
     alignas(8)  glm::vec2 viewport;
 };
@@ -37,30 +24,45 @@ struct SceneUniformBuffer
 class Scene
 {
 public:
-    Scene(tga::Interface& tgai);
+    /* slots: frames in flight, see SlotStaging */
+    Scene(tga::Interface& tgai, uint32_t slots);
     void initCamera(const glm::vec3& pos, float pitch, float yaw, float roll);
     void setDirLight(const glm::vec3& direction, const glm::vec3& color);
     void addPointLight(const glm::vec3& position, const glm::vec3& color, const glm::vec3& attenuationFactors);
+    void clearPointLights();
     void setAmbientFactor(float ambientFactor);
-    void prepareSceneUniformBuffer(tga::Interface& tgai);
+    void prepareSceneUniformBuffer(tga::Interface& tgai, uint32_t slots);
     void updateSceneBufferCameraData(glm::uvec2 viewport);
-    void bufferUpload(tga::CommandRecorder& recorder);
+    /* copies the scene as set up so far into the staging slot of the frame being built */
+    void stage(uint32_t slot);
+    /* bins the point lights into the tiles of the froxel grid and writes them into the staging slot */
+    void clusterLights(const FroxelFrustum& frustum, uint32_t slot);
+    void bufferUpload(tga::CommandRecorder& recorder, uint32_t slot);
     void moveCamera(const glm::vec3& direction, float deltaTime, float speed);
     void moveCameraXDir(float direction, float deltaTime, float speed);
     void moveCameraYDir(float direction, float deltaTime, float speed);
     void moveCameraZDir(float direction, float deltaTime, float speed);
     void rotateCameraWithMouseInput(double xPos, double yPos);
     void updateCameraLastMousePos(double x, double y);
+    void setCameraPose(const glm::vec3& pos, float pitch, float yaw, float roll);
     tga::Buffer buffer() const;
+    /* the clustered point lights, read by mesh.frag and the fog generation pass */
+    tga::Buffer lightBuffer() const;
+    const LightClusters &lightClusters() const;
     const glm::mat4 &viewProjection() const;
     const DirLight &dirLight() const;
     const Camera &camera() const;
 private:
     Camera m_camera;
-    tga::StagingBuffer sceneStagingBuffer;
-    SceneUniformBuffer* pSceneStagingBuffer;
+    SlotStaging sceneStaging;
+    SceneUniformBuffer sceneData;
     tga::Buffer sceneBuffer;
+    std::vector<PointLight> pointLights;
+    bool pointLightsChanged = false;
+    LightClusters m_lightClusters;
+    SlotStaging lightStaging;
+    tga::Buffer m_lightBuffer;
     // Information regarding the Uniform Buffer needed for data uploading (useful for partial updates) TODO: NOT USED YET
-    // const size_t cameraDataSize = sizeof(pSceneStagingBuffer->view) + sizeof(pSceneStagingBuffer->projection);
+    // const size_t cameraDataSize = sizeof(sceneData.view) + sizeof(sceneData.projection);
     // const size_t cameraDataOffset = offsetof(SceneUniformBuffer, view);
 };
\ No newline at end of file
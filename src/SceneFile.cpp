@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string_view>
+
+#include "SceneFile.h"
+#include "MappedFile.h"
+#include "util.h"
+
+namespace {
+
+typedef std::chrono::high_resolution_clock clock;
+typedef std::chrono::duration<double, std::milli> duration;
+
+/* splits a mapped file into statements without copying it */
+class Parser {
+public:
+    Parser(const MappedFile &file, std::string path) : cursor{reinterpret_cast<const char *>(file.data())}, end{cursor + file.size()}, path{std::move(path)} {}
+
+    /* advances to the next non-empty line, false at the end of the file */
+    bool nextLine()
+    {
+        while(cursor < end) {
+            const char *lineEnd = std::find(cursor, end, '\n');
+            line = std::string_view{cursor, size_t(lineEnd - cursor)};
+            cursor = lineEnd < end ? lineEnd + 1 : end;
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+            if(line.find_first_not_of(" \t\r") != std::string_view::npos) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* the next whitespace separated word of the line, empty at its end */
+    std::string_view word()
+    {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if(begin == std::string_view::npos) {
+            line = {};
+            return {};
+        }
+        line.remove_prefix(begin);
+        size_t length = std::min(line.find_first_of(" \t\r"), line.size());
+        std::string_view result = line.substr(0, length);
+        line.remove_prefix(length);
+        return result;
+    }
+
+    template<typename T>
+    bool number(T &value)
+    {
+        std::string_view w = word();
+        auto [ptr, ec] = std::from_chars(w.data(), w.data() + w.size(), value);
+        return !w.empty() && ec == std::errc{} && ptr == w.data() + w.size();
+    }
+
+    bool vec3(glm::vec3 &value)
+    {
+        return number(value.x) && number(value.y) && number(value.z);
+    }
+
+    bool atEnd()
+    {
+        return word().empty();
+    }
+
+    std::string fail(const std::string &message) const
+    {
+        return path + ":" + std::to_string(lineNumber) + ": " + message;
+    }
+
+private:
+    const char *cursor;
+    const char *end;
+    std::string path;
+    std::string_view line;
+    size_t lineNumber = 0;
+};
+
+/* statements describing a placement, shared by scene files and the per-mesh .conf files */
+bool parsePlacementStatement(Parser &parser, std::string_view keyword, Placement &placement, std::string &error)
+{
+    bool valid;
+    if(keyword == "position") {
+        valid = parser.vec3(placement.position);
+    } else if(keyword == "rotation") {
+        valid = parser.vec3(placement.rotation);
+    } else if(keyword == "defaultscale") {
+        valid = parser.number(placement.scale);
+    } else if(keyword == "scalejitter") {
+        valid = parser.number(placement.scaleJitter);
+    } else if(keyword == "instances") {
+        valid = parser.number(placement.instances);
+    } else if(keyword == "seed") {
+        valid = parser.number(placement.seed);
+    } else if(keyword == "pattern") {
+        std::string_view name = parser.word();
+        if(name == "single") {
+            placement.pattern = PlacementPattern::single;
+        } else if(name == "circle") {
+            placement.pattern = PlacementPattern::circle;
+        } else if(name == "disc") {
+            placement.pattern = PlacementPattern::disc;
+        } else if(name == "sphere") {
+            placement.pattern = PlacementPattern::sphere;
+        } else if(name == "grid") {
+            placement.pattern = PlacementPattern::grid;
+        } else {
+            error = parser.fail("unknown pattern '" + std::string{name} + "'");
+            return false;
+        }
+        valid = placement.pattern == PlacementPattern::single || parser.number(placement.size);
+    } else if(keyword == "instance") {
+        float values[7] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+        valid = parser.number(values[0]) && parser.number(values[1]) && parser.number(values[2]);
+        // scale and rotation are optional, in that order
+        for(size_t i = 3; valid && i < 7; i++) {
+            std::string_view w = parser.word();
+            if(w.empty()) {
+                valid = i == 3 || i == 4;
+                break;
+            }
+            auto [ptr, ec] = std::from_chars(w.data(), w.data() + w.size(), values[i]);
+            valid = ec == std::errc{} && ptr == w.data() + w.size() && (i < 6 || parser.atEnd());
+        }
+        placement.explicitInstances.insert(placement.explicitInstances.end(), std::begin(values), std::end(values));
+        return valid || (error = parser.fail("instance expects x y z [scale [rx ry rz]]"), false);
+    } else {
+        error = parser.fail("unknown statement '" + std::string{keyword} + "'");
+        return false;
+    }
+    if(!valid || !parser.atEnd()) {
+        error = parser.fail("malformed '" + std::string{keyword} + "' statement");
+        return false;
+    }
+    return true;
+}
+
+}
+
+size_t Placement::instanceCount() const
+{
+    size_t explicitCount = explicitInstances.size() / 7;
+    if(pattern == PlacementPattern::single) {
+        return explicitCount > 0 ? explicitCount : 1;
+    }
+    return explicitCount + instances;
+}
+
+bool parseSceneFile(const std::string &path, const std::string &assetsDir, SceneDescription &scene, std::string &error)
+{
+    clock::time_point start = clock::now();
+    MappedFile file{path};
+    if(!file) {
+        error = path + ": could not open";
+        return false;
+    }
+    Parser parser{file, path};
+    scene.name = std::filesystem::path(path).stem().string();
+    size_t statements = 0;
+    while(parser.nextLine()) {
+        statements++;
+        std::string_view keyword = parser.word();
+        if(keyword == "name") {
+            scene.name = std::string{parser.word()};
+        } else if(keyword == "set") {
+            auto &setting = scene.settings.emplace_back(std::string{parser.word()}, std::vector<float>{});
+            float value;
+            for(std::string_view w = parser.word(); !w.empty(); w = parser.word()) {
+                auto [ptr, ec] = std::from_chars(w.data(), w.data() + w.size(), value);
+                if(ec != std::errc{} || ptr != w.data() + w.size()) {
+                    error = parser.fail("malformed value for setting " + setting.first);
+                    return false;
+                }
+                setting.second.push_back(value);
+            }
+        } else if(keyword == "mesh") {
+            Placement &placement = scene.placements.emplace_back();
+            placement.mesh = std::string{parser.word()};
+            std::filesystem::path meshDir = std::filesystem::path(assetsDir) / placement.mesh;
+            std::string confPath = (meshDir / meshDir.filename()).string() + ".conf";
+            if(std::filesystem::exists(confPath)) {
+                MappedFile conf{confPath};
+                Parser confParser{conf, confPath};
+                while(confParser.nextLine()) {
+                    if(!parsePlacementStatement(confParser, confParser.word(), placement, error)) {
+                        return false;
+                    }
+                }
+            }
+        } else if(keyword == "fogvolume") {
+            LocalFogVolume &volume = scene.fogVolumes.emplace_back();
+            std::string_view shape = parser.word();
+            if(shape == "box") {
+                volume.shape = LocalFogShape::box;
+            } else if(shape == "ellipsoid") {
+                volume.shape = LocalFogShape::ellipsoid;
+            } else {
+                error = parser.fail("unknown fog volume shape '" + std::string{shape} + "'");
+                return false;
+            }
+            bool valid = parser.vec3(volume.position) && parser.vec3(volume.halfExtents);
+            // density, falloff, noise and rotation are optional, in that order
+            float *optional[] = { &volume.density, &volume.falloff, &volume.noise, &volume.rotation.x, &volume.rotation.y, &volume.rotation.z };
+            for(size_t i = 0; valid && i < std::size(optional); i++) {
+                std::string_view w = parser.word();
+                if(w.empty()) {
+                    valid = i < 4;
+                    break;
+                }
+                auto [ptr, ec] = std::from_chars(w.data(), w.data() + w.size(), *optional[i]);
+                valid = ec == std::errc{} && ptr == w.data() + w.size() && (i + 1 < std::size(optional) || parser.atEnd());
+            }
+            if(!valid) {
+                error = parser.fail("fogvolume expects box|ellipsoid x y z hx hy hz [density [falloff [noise [rx ry rz]]]]");
+                return false;
+            }
+        } else if(scene.placements.empty()) {
+            error = parser.fail("'" + std::string{keyword} + "' before the first mesh statement");
+            return false;
+        } else if(!parsePlacementStatement(parser, keyword, scene.placements.back(), error)) {
+            return false;
+        }
+    }
+    size_t instances = 0;
+    for(const Placement &placement : scene.placements) {
+        instances += placement.instanceCount();
+    }
+    std::ostringstream report;
+    report << "[Scene] " << std::filesystem::path(path).filename().string() << ": " << statements << " statements, "
+           << scene.placements.size() << " placements, " << instances << " instances, " << scene.fogVolumes.size() << " fog volumes, parsed in " << duration(clock::now() - start).count() << " ms\n";
+    std::cout << report.str();
+    return true;
+}
+
+void placeInstances(const Placement &placement, const std::function<void(const glm::mat4 &)> &emit)
+{
+    std::mt19937 rng{placement.seed};
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto scale = [&]() { return placement.scale * (1.0f + placement.scaleJitter * (2.0f * unit(rng) - 1.0f)); };
+    auto place = [&](glm::vec3 offset, float s, float yaw) {
+        emit(makeTransform(placement.position + offset, glm::vec3(s), placement.rotation + glm::vec3(0.0f, yaw, 0.0f)));
+    };
+
+    uint32_t n = placement.instances;
+    switch(placement.pattern) {
+        case PlacementPattern::single:
+            if(placement.explicitInstances.empty()) {
+                place(glm::vec3(0.0f), placement.scale, 0.0f);
+            }
+            break;
+        case PlacementPattern::circle:
+            // evenly spaced, all facing along the circle
+            for(uint32_t i = 0; i < n; i++) {
+                float phi = 2.0f * float(M_PI) * float(i) / float(n);
+                place(placement.size * glm::vec3(std::sin(phi), 0.0f, std::cos(phi)), scale(), phi);
+            }
+            break;
+        case PlacementPattern::disc:
+            for(uint32_t i = 0; i < n; i++) {
+                float r = placement.size * std::sqrt(unit(rng));
+                float phi = 2.0f * float(M_PI) * unit(rng);
+                place(glm::vec3(r * std::sin(phi), 0.0f, r * std::cos(phi)), scale(), 2.0f * float(M_PI) * unit(rng));
+            }
+            break;
+        case PlacementPattern::sphere:
+            for(uint32_t i = 0; i < n; i++) {
+                // uniform in the ball: cube root for the radius, uniform z for the direction
+                float r = placement.size * std::cbrt(unit(rng));
+                float z = 2.0f * unit(rng) - 1.0f;
+                float phi = 2.0f * float(M_PI) * unit(rng);
+                float ring = std::sqrt(1.0f - z * z);
+                place(r * glm::vec3(ring * std::sin(phi), z, ring * std::cos(phi)), scale(), 2.0f * float(M_PI) * unit(rng));
+            }
+            break;
+        case PlacementPattern::grid: {
+            // the smallest cube holding n cells, filled layer by layer around position
+            uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(double(n))));
+            float half = 0.5f * placement.size * float(side - 1);
+            for(uint32_t i = 0; i < n; i++) {
+                glm::vec3 cell{float(i % side), float(i / (side * side)), float(i / side % side)};
+                place(cell * placement.size - glm::vec3(half, 0.0f, half), scale(), 0.0f);
+            }
+            break;
+        }
+    }
+
+    const std::vector<float> &values = placement.explicitInstances;
+    for(size_t i = 0; i + 7 <= values.size(); i += 7) {
+        emit(makeTransform(placement.position + glm::vec3(values[i], values[i + 1], values[i + 2]),
+                           glm::vec3(placement.scale * values[i + 3]),
+                           placement.rotation + glm::vec3(values[i + 4], values[i + 5], values[i + 6])));
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tga/tga.hpp"
+#include "LocalFogVolumes.h"
+
+/*
+ * Text scene descriptions, one statement per line, '#' starts a comment:
+ *
+ *   name Fleet                   shown in the demo slider
+ *   set density 0.4              a demo setting, see SceneDescription::settings
+ *   mesh Space_Ships/amy         starts a placement of <assets>/Space_Ships/amy/amy.obj; amy.conf next to it, if
+ *                                present, is read first and provides the defaults for the statements that follow
+ *   position 0 -1 0              centre of the pattern
+ *   rotation 0 1.57 0            euler angles in radians
+ *   defaultscale 0.05            uniform scale of every instance
+ *   scalejitter 0.2              scales vary randomly by up to +-20%
+ *   pattern circle 1000          single | circle <radius> | disc <radius> | sphere <radius> | grid <spacing>
+ *   instances 100
+ *   seed 7                       random patterns are reproducible per seed
+ *   instance 10 0 5 [s [rx ry rz]]  an explicit instance relative to position, on top of the pattern's
+ *   fogvolume box 0 2 0 5 2 5 [density [falloff [noise [rx ry rz]]]]
+ *                                a local fog volume, box or ellipsoid, at a position with half extents; may come
+ *                                anywhere, see LocalFogVolume for the defaults
+ *
+ * A placement with explicit instances and the single pattern is only placed at the explicit ones.
+ */
+enum class PlacementPattern { single, circle, disc, sphere, grid };
+
+struct Placement {
+    std::string mesh;
+    glm::vec3 position{0.0f};
+    glm::vec3 rotation{0.0f};
+    float scale = 1.0f;
+    float scaleJitter = 0.0f;
+    PlacementPattern pattern = PlacementPattern::single;
+    /* radius of circle, disc and sphere, spacing of grid */
+    float size = 0.0f;
+    uint32_t instances = 1;
+    uint32_t seed = 1;
+    /* seven floats per explicit instance: position, scale, rotation */
+    std::vector<float> explicitInstances;
+
+    size_t instanceCount() const;
+};
+
+struct SceneDescription {
+    std::string name;
+    std::vector<Placement> placements;
+    /* set statements in file order, the demo decides which names it understands */
+    std::vector<std::pair<std::string, std::vector<float>>> settings;
+    std::vector<LocalFogVolume> fogVolumes;
+};
+
+/* assetsDir is where mesh paths are resolved. On failure error names the file and line */
+bool parseSceneFile(const std::string &path, const std::string &assetsDir, SceneDescription &scene, std::string &error);
+/* generates the placement's transforms one at a time and hands each to emit, which decides where they go; placing
+   itself keeps nothing per instance, but a demo's InstanceTransforms holds every transform for culling */
+void placeInstances(const Placement &placement, const std::function<void(const glm::mat4 &)> &emit);
@@ -0,0 +1,25 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include "FogVolumeGenerationPass.h"
+
+/* what the GUI edits; every demo starts from its own */
+struct Settings
+{
+    int demoIdx;
+    glm::vec3 lightDir;
+    glm::vec3 lightColor;
+    // Fog
+    float historyFactor;
+    float density;
+    float constantDensity;
+    float anisotropy;
+    float absorption;
+    float height;
+    bool noise;
+    float skyBlendRatio;
+    float fogRange = FogGrid{}.range;
+    float depthExponent = FogGrid{}.depthExponent;
+
+    bool operator==(const Settings &) const = default;
+};
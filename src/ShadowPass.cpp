@@ -5,17 +5,28 @@ static glm::vec3 dehomogenize(const glm::vec4 v) {
     return glm::vec3(v.x / v.w, v.y / v.w, v.z / v.w);
 }
 
-ShadowPass::ShadowPass(tga::Interface &tgai, std::array<uint32_t, 2> resolution, const tga::VertexLayout &vertexLayout) : tgai{&tgai} {
+tga::TextureInfo ShadowPass::shadowMapInfo(std::array<uint32_t, 2> resolution)
+{
     tga::TextureInfo texInfo = {resolution[0], resolution[1], tga::Format::r32_sfloat, tga::SamplerMode::nearest, tga::AddressMode::clampBorder};
     texInfo.borderColor = tga::BorderColor::FloatOpaqueWhite;
-    hShadowMap = tgai.createTexture(texInfo);
+    return texInfo;
+}
+
+size_t ShadowPass::shadowMapBytes(std::array<uint32_t, 2> resolution)
+{
+    return size_t(resolution[0]) * resolution[1] * sizeof(float);
+}
+
+ShadowPass::ShadowPass(tga::Interface &tgai, tga::Texture shadowMap, std::array<uint32_t, 2> resolution, const tga::VertexLayout &vertexLayout, uint32_t slots)
+    : scene{ glm::mat4(1.0f) }, tgai{&tgai}, m_resolution{resolution}, hShadowMap{shadowMap} {
 
     auto shadow_vs = tga::loadShader("../shaders/shadow_vert.spv", tga::ShaderType::vertex, tgai);
     auto shadow_fs = tga::loadShader("../shaders/shadow_frag.spv", tga::ShaderType::fragment, tgai);
 
     tga::SetLayout sceneSetLayout = tga::SetLayout{ {tga::BindingType::uniformBuffer} };
-    tga::SetLayout objectSetLayout = tga::SetLayout{ {tga::BindingType::uniformBuffer} };
-    tga::InputLayout descriptorLayout = tga::InputLayout{ sceneSetLayout, objectSetLayout };
+    tga::SetLayout objectSetLayout = tga::SetLayout{ {tga::BindingType::storageBuffer, tga::BindingType::storageBuffer} };
+    tga::SetLayout meshSetLayout = tga::SetLayout{ {tga::BindingType::uniformBuffer} };
+    tga::InputLayout descriptorLayout = tga::InputLayout{ sceneSetLayout, objectSetLayout, meshSetLayout };
 
     auto shadowrpInfo = tga::RenderPassInfo{shadow_vs, shadow_fs, hShadowMap} // Unfortunately, this "render target" is essentially a redundant depth buffer
         .setClearOperations(tga::ClearOperation::all)
@@ -24,9 +35,8 @@ ShadowPass::ShadowPass(tga::Interface &tgai, std::array<uint32_t, 2> resolution,
         .setInputLayout(descriptorLayout)
         .setVertexLayout(vertexLayout);
     rp = tgai.createRenderPass(shadowrpInfo);
-    sceneDataStaging = tgai.createStagingBuffer({sizeof(Scene)});
+    sceneDataStaging = SlotStaging(tgai, sizeof(Scene), slots);
     sceneData = tgai.createBuffer({ tga::BufferUsage::uniform, sizeof(Scene) });
-    scene = reinterpret_cast<Scene *>(tgai.getMapping(sceneDataStaging));
     sceneSet = tgai.createInputSet({ rp, { tga::Binding(sceneData, 0, 0) }, 0 });
     tgai.free(shadow_vs);
     tgai.free(shadow_fs);
@@ -34,15 +44,13 @@ ShadowPass::ShadowPass(tga::Interface &tgai, std::array<uint32_t, 2> resolution,
 
 ShadowPass::~ShadowPass()
 {
-    tgai->free(hShadowMap);
     tgai->free(sceneData);
-    tgai->free(sceneDataStaging);
     tgai->free(rp);
 }
 
-void ShadowPass::upload(tga::CommandRecorder &recorder) const
+void ShadowPass::upload(tga::CommandRecorder &recorder, uint32_t slot) const
 {
-    recorder.bufferUpload(sceneDataStaging, sceneData, sizeof(Scene));
+    recorder.bufferUpload(sceneDataStaging.buffer(slot), sceneData, sizeof(Scene));
 }
 
 void ShadowPass::bind(tga::CommandRecorder &recorder, uint32_t nf) const
@@ -66,7 +74,17 @@ tga::RenderPass ShadowPass::renderPass() const
     return rp;
 }
 
-void ShadowPass::update(const ::Scene &scene, float shadowDistance)
+const glm::mat4 &ShadowPass::lightViewProjection() const
+{
+    return scene.viewProjection;
+}
+
+std::array<uint32_t, 2> ShadowPass::resolution() const
+{
+    return m_resolution;
+}
+
+void ShadowPass::update(const ::Scene &scene, float shadowDistance, uint32_t slot)
 {
     const glm::mat4 &vp = scene.viewProjection();
     glm::mat4 invVp = glm::inverse(vp);
@@ -153,5 +171,6 @@ void ShadowPass::update(const ::Scene &scene, float shadowDistance)
             view[i][j] = axes[j][i];
         }
     }
-    this->scene->viewProjection = perspective * view;
+    this->scene.viewProjection = perspective * view;
+    sceneDataStaging.write(slot, &this->scene, sizeof(Scene));
 }
@@ -1,30 +1,44 @@
 #pragma once
 #include "tga/tga.hpp"
 #include "Scene.h"
+#include "SlotStaging.h"
 
+/*
+ * Directional shadow map. Meshes are drawn from their position-only stream (Drawable::drawPositions), vertexLayout
+ * is expected to be positionLayout(). TGA keeps the pass's depth buffer to itself, so shadow.frag writes the depth
+ * into the r32_sfloat target that the fog and mesh shaders sample; it is created from shadowMapInfo() by the caller,
+ * who keeps ownership.
+ */
 class ShadowPass {
 public:
-    ShadowPass(tga::Interface &tgai, std::array<uint32_t, 2> resolution, const tga::VertexLayout &vertexLayout);
+    static tga::TextureInfo shadowMapInfo(std::array<uint32_t, 2> resolution);
+    static size_t shadowMapBytes(std::array<uint32_t, 2> resolution);
+
+    /* slots: frames in flight, see SlotStaging */
+    ShadowPass(tga::Interface &tgai, tga::Texture shadowMap, std::array<uint32_t, 2> resolution, const tga::VertexLayout &vertexLayout, uint32_t slots);
     ~ShadowPass();
     ShadowPass(const ShadowPass&) = delete;
     ShadowPass &operator=(const ShadowPass&) = delete;
 
-    void upload(tga::CommandRecorder &recorder) const;
+    void upload(tga::CommandRecorder &recorder, uint32_t slot) const;
     void bind(tga::CommandRecorder &recorder, uint32_t nf) const;
     tga::Texture shadowMap() const;
     tga::Buffer inputBuffer() const;
     tga::RenderPass renderPass() const;
-    /* near and far distance ar given as fractions of the view distance */
-    void update(const ::Scene &scene, float shadowDistance);
+    const glm::mat4 &lightViewProjection() const;
+    std::array<uint32_t, 2> resolution() const;
+    /* near and far distance ar given as fractions of the view distance; writes the staging slot of the frame being built */
+    void update(const ::Scene &scene, float shadowDistance, uint32_t slot);
 private:
     struct Scene {
         glm::mat4 viewProjection;
-    } *scene;
+    } scene;
 
     tga::Interface *tgai;
+    std::array<uint32_t, 2> m_resolution;
     tga::RenderPass rp;
     tga::Texture hShadowMap;
     tga::Buffer sceneData;
-    tga::StagingBuffer sceneDataStaging;
+    SlotStaging sceneDataStaging;
     tga::InputSet sceneSet;
 };
@@ -0,0 +1,62 @@
+#include <cstring>
+#include <utility>
+
+#include "SlotStaging.h"
+
+SlotStaging::SlotStaging(tga::Interface &tgai, size_t size, uint32_t slots) : tgai{&tgai}
+{
+    for(uint32_t i = 0; i < slots; ++i) {
+        buffers.push_back(tgai.createStagingBuffer({ size }));
+        mappings.push_back(tgai.getMapping(buffers.back()));
+    }
+}
+
+SlotStaging::~SlotStaging()
+{
+    free();
+}
+
+SlotStaging::SlotStaging(SlotStaging &&other)
+    : tgai{other.tgai}, buffers{std::exchange(other.buffers, {})}, mappings{std::exchange(other.mappings, {})}
+{
+}
+
+SlotStaging &SlotStaging::operator=(SlotStaging &&other)
+{
+    if(this != &other) {
+        free();
+        tgai = other.tgai;
+        buffers = std::exchange(other.buffers, {});
+        mappings = std::exchange(other.mappings, {});
+    }
+    return *this;
+}
+
+tga::StagingBuffer SlotStaging::buffer(uint32_t slot) const
+{
+    return buffers[slot];
+}
+
+void *SlotStaging::mapping(uint32_t slot) const
+{
+    return mappings[slot];
+}
+
+void SlotStaging::write(uint32_t slot, const void *data, size_t size) const
+{
+    std::memcpy(mappings[slot], data, size);
+}
+
+uint32_t SlotStaging::slots() const
+{
+    return static_cast<uint32_t>(buffers.size());
+}
+
+void SlotStaging::free()
+{
+    for(tga::StagingBuffer buffer : buffers) {
+        tgai->free(buffer);
+    }
+    buffers.clear();
+    mappings.clear();
+}
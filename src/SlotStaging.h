@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tga/tga.hpp"
+
+/*
+ * One mapped staging buffer per frame in flight. The frame being built writes its slot while the GPU may still copy
+ * from the others, so a slot may only be written once the last command buffer recorded with it has completed. The
+ * slot of a frame is the backbuffer index its command buffer is recorded for.
+ */
+class SlotStaging {
+public:
+    SlotStaging() = default;
+    SlotStaging(tga::Interface &tgai, size_t size, uint32_t slots);
+    ~SlotStaging();
+    SlotStaging(const SlotStaging &) = delete;
+    SlotStaging &operator=(const SlotStaging &) = delete;
+    SlotStaging(SlotStaging &&other);
+    SlotStaging &operator=(SlotStaging &&other);
+
+    tga::StagingBuffer buffer(uint32_t slot) const;
+    void *mapping(uint32_t slot) const;
+    template<typename T>
+    T *as(uint32_t slot) const { return static_cast<T *>(mapping(slot)); }
+    /* copies size bytes from data to the start of the slot */
+    void write(uint32_t slot, const void *data, size_t size) const;
+    uint32_t slots() const;
+
+private:
+    void free();
+
+    tga::Interface *tgai = nullptr;
+    std::vector<tga::StagingBuffer> buffers;
+    std::vector<void *> mappings;
+};
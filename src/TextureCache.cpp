@@ -0,0 +1,185 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "tga/tga_utils.hpp"
+
+#include "TextureCache.h"
+#include "TextureCooker.h"
+#include "MappedFile.h"
+
+namespace {
+
+constexpr char COOKED_MAGIC[8] = { 'F', 'O', 'G', 'T', 'E', 'X', '\0', '\0' };
+constexpr uint32_t COOKED_VERSION = 2;
+
+enum class CookedFormat : uint32_t { bc1Srgb, bc5Unorm };
+
+struct CookedTextureHeader {
+    char magic[8];
+    uint32_t version;
+    CookedFormat format;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+    uint64_t contentHash;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+    uint32_t padding;
+    uint64_t dataSize;
+    double decodeMillis;
+};
+
+typedef std::chrono::high_resolution_clock clock;
+typedef std::chrono::duration<double, std::milli> duration;
+
+CookedTexture describe(const std::string &cookedPath, const CookedTextureHeader &header)
+{
+    CookedTexture texture;
+    texture.cookedPath = cookedPath;
+    texture.format = header.format == CookedFormat::bc5Unorm ? tga::Format::bc5_unorm_block : tga::Format::bc1_rgb_srgb_block;
+    texture.contentHash = header.contentHash;
+    texture.width = header.width;
+    texture.height = header.height;
+    texture.levels = header.levels;
+    texture.dataOffset = sizeof(header);
+    texture.dataSize = header.dataSize;
+    texture.rgbaSize = 4 * uint64_t(header.width) * header.height;
+    texture.decodeMillis = header.decodeMillis;
+    return texture;
+}
+
+bool writeCookedTexture(const std::string &cookedPath, const CookedTextureHeader &header, const std::vector<std::vector<uint8_t>> &levels)
+{
+    std::string tmpPath = cookedPath + ".tmp";
+    {
+        std::ofstream out{tmpPath, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for(const std::vector<uint8_t> &level : levels) {
+            out.write(reinterpret_cast<const char *>(level.data()), level.size());
+        }
+        if(!out) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, cookedPath, ec);
+    return !ec;
+}
+
+}
+
+CookedTexture cookTexture(const std::string &pngPath, bool normalMap, bool recook)
+{
+    std::string cookedPath = std::filesystem::path(pngPath).replace_extension(".ctex").string();
+    std::string name = std::filesystem::path(pngPath).filename().string();
+    CookedFormat format = normalMap ? CookedFormat::bc5Unorm : CookedFormat::bc1Srgb;
+    std::error_code ec;
+    uint64_t sourceSize = std::filesystem::file_size(pngPath, ec);
+    int64_t sourceMtime = ec ? 0 : std::filesystem::last_write_time(pngPath, ec).time_since_epoch().count();
+    if(ec) {
+        return {};
+    }
+
+    if(!recook) {
+        MappedFile cooked{cookedPath};
+        CookedTextureHeader header;
+        if(cooked && cooked.size() >= sizeof(header)) {
+            std::memcpy(&header, cooked.data(), sizeof(header));
+            bool valid = std::memcmp(header.magic, COOKED_MAGIC, sizeof(COOKED_MAGIC)) == 0
+                && header.version == COOKED_VERSION
+                && header.format == format
+                && cooked.size() == sizeof(header) + header.dataSize;
+            bool fresh = valid && header.sourceSize == sourceSize && header.sourceMtime == sourceMtime;
+            bool touched = valid && !fresh && header.sourceSize == sourceSize && header.sourceHash == hashFile(pngPath);
+            if(touched) {
+                header.sourceMtime = sourceMtime;
+                std::fstream patch{cookedPath, std::ios::binary | std::ios::in | std::ios::out};
+                patch.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            }
+            if(fresh || touched) {
+                return describe(cookedPath, header);
+            }
+        }
+    }
+
+    clock::time_point start = clock::now();
+    int w, h, channels;
+    uint8_t *p = stbi_load(pngPath.c_str(), &w, &h, &channels, STBI_rgb_alpha);
+    if(!p) {
+        return {};
+    }
+    double decodeMillis = duration(clock::now() - start).count();
+    // identifies the decoded image, so the same picture behind different files is only uploaded once
+    uint64_t contentHash = hashBytes(&format, sizeof(format));
+    contentHash = hashBytes(&w, sizeof(w), contentHash);
+    contentHash = hashBytes(&h, sizeof(h), contentHash);
+    contentHash = hashBytes(p, 4 * size_t(w) * size_t(h), contentHash);
+    std::vector<MipLevel> chain = buildMipChain(p, uint32_t(w), uint32_t(h), normalMap);
+    stbi_image_free(p);
+
+    std::vector<std::vector<uint8_t>> levels;
+    CookedTextureHeader header{};
+    for(const MipLevel &level : chain) {
+        levels.push_back(normalMap ? encodeBC5(level) : encodeBC1(level));
+        header.dataSize += levels.back().size();
+    }
+    std::memcpy(header.magic, COOKED_MAGIC, sizeof(COOKED_MAGIC));
+    header.version = COOKED_VERSION;
+    header.format = format;
+    header.sourceSize = sourceSize;
+    header.sourceMtime = sourceMtime;
+    header.sourceHash = hashFile(pngPath);
+    header.contentHash = contentHash;
+    header.width = uint32_t(w);
+    header.height = uint32_t(h);
+    header.levels = uint32_t(levels.size());
+    header.decodeMillis = decodeMillis;
+    bool written = writeCookedTexture(cookedPath, header, levels);
+    std::ostringstream report;
+    report << "[Texture cache] " << name << ": cooked " << header.levels << " levels in "
+           << duration(clock::now() - start).count() << " ms, " << (written ? "wrote " : "could not write ") << cookedPath << "\n";
+    std::cout << report.str();
+    CookedTexture texture = describe(cookedPath, header);
+    if(!written) {
+        // still usable, just not cached: keep the levels for readCookedTexture
+        texture.dataOffset = 0;
+        texture.data.reserve(header.dataSize);
+        for(const std::vector<uint8_t> &level : levels) {
+            texture.data.insert(texture.data.end(), level.begin(), level.end());
+        }
+    }
+    return texture;
+}
+
+bool readCookedTexture(const CookedTexture &texture, void *target)
+{
+    clock::time_point start = clock::now();
+    if(!texture.data.empty()) {
+        std::memcpy(target, texture.data.data(), texture.dataSize);
+    } else {
+        MappedFile cooked{texture.cookedPath};
+        if(!cooked || cooked.size() < texture.dataOffset + texture.dataSize) {
+            return false;
+        }
+        std::memcpy(target, cooked.data() + texture.dataOffset, texture.dataSize);
+    }
+    double loadMillis = duration(clock::now() - start).count();
+    std::ostringstream report;
+    report << "[Texture cache] " << std::filesystem::path(texture.cookedPath).filename().string() << ": "
+           << texture.rgbaSize / 1024 << " KiB as RGBA8 without mips, " << texture.dataSize / 1024 << " KiB cooked with "
+           << texture.levels << " levels; loaded in " << loadMillis << " ms (PNG decode: " << texture.decodeMillis << " ms)\n";
+    std::cout << report.str();
+    return true;
+}
+
+tga::TextureInfo cookedTextureInfo(const CookedTexture &texture, tga::StagingBuffer staging)
+{
+    return tga::TextureInfo{ texture.width, texture.height, texture.format, tga::SamplerMode::linear, tga::AddressMode::repeat }
+        .setSrcData(staging)
+        .setMipLevels(texture.levels);
+}
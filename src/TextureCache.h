@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "tga/tga.hpp"
+
+/*
+ * Cooked texture cache, the texture counterpart of MeshCache. <name>.ctex lives next to the .png and holds the full
+ * mip chain, block compressed (BC1 sRGB for colour data, BC5 for normal maps) and laid out level after level exactly
+ * as it is uploaded, so loading is a single read into staging memory instead of a PNG decode.
+ */
+struct CookedTexture {
+    std::string cookedPath;
+    tga::Format format = tga::Format::undefined;
+    /* hash of the decoded pixels and the cooked format, equal for identical images in different files */
+    uint64_t contentHash = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t levels = 0;
+    uint64_t dataOffset = 0;
+    uint64_t dataSize = 0;
+    /* size of level 0 as RGBA8, what the texture used to occupy on the GPU */
+    uint64_t rgbaSize = 0;
+    /* how long the PNG decode took when this file was cooked */
+    double decodeMillis = 0.0;
+    /* the mip chain itself if the cache could not be written (read-only assets, full disk), empty otherwise */
+    std::vector<uint8_t> data;
+
+    explicit operator bool() const { return format != tga::Format::undefined; }
+};
+
+/* Returns the cooked texture for pngPath, cooking it first if the cache is missing or stale. False on failure. */
+CookedTexture cookTexture(const std::string &pngPath, bool normalMap, bool recook = false);
+/* Copies the mip chain (dataSize bytes) to target, e.g. a mapped staging buffer, from the cache or from data */
+bool readCookedTexture(const CookedTexture &texture, void *target);
+/* Texture description for uploading the whole mip chain from a staging buffer filled by readCookedTexture */
+tga::TextureInfo cookedTextureInfo(const CookedTexture &texture, tga::StagingBuffer staging);
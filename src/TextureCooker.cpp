@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "TextureCooker.h"
+#include "parallel.h"
+#include "simd.h"
+
+using simd::float4;
+
+namespace {
+
+constexpr size_t LINEAR_TO_SRGB_STEPS = 16384;
+
+const std::array<float, 256> &srgbToLinearTable()
+{
+    static const std::array<float, 256> table = []() {
+        std::array<float, 256> t;
+        for(size_t i = 0; i < t.size(); i++) {
+            float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+    return table;
+}
+
+/* linear [0, 1] sampled finely enough that dark values still round to the right 8 bit code */
+const std::vector<uint8_t> &linearToSrgbTable()
+{
+    static const std::vector<uint8_t> table = []() {
+        std::vector<uint8_t> t(LINEAR_TO_SRGB_STEPS + 1);
+        for(size_t i = 0; i < t.size(); i++) {
+            float l = static_cast<float>(i) / LINEAR_TO_SRGB_STEPS;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            t[i] = static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+        return t;
+    }();
+    return table;
+}
+
+uint8_t linearToSrgb(float l)
+{
+    return linearToSrgbTable()[static_cast<size_t>(std::clamp(l, 0.0f, 1.0f) * LINEAR_TO_SRGB_STEPS + 0.5f)];
+}
+
+float4 renormalize(float4 n)
+{
+    float x = n[0], y = n[1], z = n[2];
+    float len = std::sqrt(x * x + y * y + z * z);
+    if(len < 1e-6f) {
+        return float4(0.0f, 0.0f, 1.0f, n[3]);
+    }
+    return float4(x / len, y / len, z / len, n[3]);
+}
+
+MipLevel downsample(const MipLevel &src, bool normalMap)
+{
+    MipLevel dst{ std::max(src.width / 2, 1u), std::max(src.height / 2, 1u), {} };
+    dst.texels.resize(size_t(dst.width) * dst.height * 4);
+    parallelFor(dst.height, 16, [&](size_t begin, size_t end) {
+        for(size_t y = begin; y < end; y++) {
+            size_t y0 = std::min<size_t>(2 * y, src.height - 1);
+            size_t y1 = std::min<size_t>(2 * y + 1, src.height - 1);
+            const float *row0 = &src.texels[y0 * src.width * 4];
+            const float *row1 = &src.texels[y1 * src.width * 4];
+            float *out = &dst.texels[y * dst.width * 4];
+            for(size_t x = 0; x < dst.width; x++) {
+                size_t x0 = std::min<size_t>(2 * x, src.width - 1) * 4;
+                size_t x1 = std::min<size_t>(2 * x + 1, src.width - 1) * 4;
+                // box filter, one RGBA texel per vector
+                float4 sum = float4::load(row0 + x0) + float4::load(row0 + x1) + float4::load(row1 + x0) + float4::load(row1 + x1);
+                float4 avg = sum * 0.25f;
+                if(normalMap) {
+                    avg = renormalize(avg);
+                }
+                avg.store(out + 4 * x);
+            }
+        }
+    });
+    return dst;
+}
+
+/* gathers a 4x4 block, clamping at the level's edge for levels smaller than a block */
+void loadBlock(const MipLevel &level, uint32_t bx, uint32_t by, float block[16][4])
+{
+    for(uint32_t j = 0; j < 4; j++) {
+        uint32_t y = std::min(by * 4 + j, level.height - 1);
+        for(uint32_t i = 0; i < 4; i++) {
+            uint32_t x = std::min(bx * 4 + i, level.width - 1);
+            const float *t = &level.texels[(size_t(y) * level.width + x) * 4];
+            std::copy(t, t + 4, block[j * 4 + i]);
+        }
+    }
+}
+
+uint16_t packRgb565(const float c[3])
+{
+    auto q = [](float v, float maxCode) { return static_cast<uint16_t>(std::clamp(v / 255.0f * maxCode + 0.5f, 0.0f, maxCode)); };
+    return static_cast<uint16_t>((q(c[0], 31.0f) << 11) | (q(c[1], 63.0f) << 5) | q(c[2], 31.0f));
+}
+
+void unpackRgb565(uint16_t c, float out[3])
+{
+    out[0] = ((c >> 11) & 31) * (255.0f / 31.0f);
+    out[1] = ((c >> 5) & 63) * (255.0f / 63.0f);
+    out[2] = (c & 31) * (255.0f / 31.0f);
+}
+
+/* range fit along the principal axis of the block's colours */
+void encodeBC1Block(const float texels[16][3], uint8_t *out)
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for(int i = 0; i < 16; i++) {
+        for(int c = 0; c < 3; c++) {
+            mean[c] += texels[i][c] / 16.0f;
+        }
+    }
+    float cov[6] = {};
+    for(int i = 0; i < 16; i++) {
+        float d[3] = { texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2] };
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for(int it = 0; it < 8; it++) {
+        float next[3] = {
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2],
+        };
+        float len = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if(len < 1e-6f) {
+            break;
+        }
+        for(int c = 0; c < 3; c++) {
+            axis[c] = next[c] / len;
+        }
+    }
+    float minT = 1e30f, maxT = -1e30f;
+    for(int i = 0; i < 16; i++) {
+        float t = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    float e0[3], e1[3];
+    for(int c = 0; c < 3; c++) {
+        e0[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+        e1[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+    }
+    uint16_t c0 = packRgb565(e0);
+    uint16_t c1 = packRgb565(e1);
+    // c0 > c1 selects the opaque four colour mode
+    if(c0 < c1) {
+        std::swap(c0, c1);
+    }
+    uint32_t indices = 0;
+    if(c0 != c1) {
+        float palette[4][3];
+        unpackRgb565(c0, palette[0]);
+        unpackRgb565(c1, palette[1]);
+        for(int c = 0; c < 3; c++) {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+        for(int i = 0; i < 16; i++) {
+            uint32_t best = 0;
+            float bestError = 1e30f;
+            for(uint32_t p = 0; p < 4; p++) {
+                float dr = texels[i][0] - palette[p][0], dg = texels[i][1] - palette[p][1], db = texels[i][2] - palette[p][2];
+                float error = dr * dr + dg * dg + db * db;
+                if(error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+    out[0] = c0 & 0xff; out[1] = c0 >> 8;
+    out[2] = c1 & 0xff; out[3] = c1 >> 8;
+    for(int b = 0; b < 4; b++) {
+        out[4 + b] = (indices >> (8 * b)) & 0xff;
+    }
+}
+
+/* single channel, eight interpolated values between min and max */
+void encodeBC4Block(const float values[16], uint8_t *out)
+{
+    float lo = 255.0f, hi = 0.0f;
+    for(int i = 0; i < 16; i++) {
+        lo = std::min(lo, values[i]);
+        hi = std::max(hi, values[i]);
+    }
+    uint8_t r0 = static_cast<uint8_t>(std::clamp(hi + 0.5f, 0.0f, 255.0f));
+    uint8_t r1 = static_cast<uint8_t>(std::clamp(lo + 0.5f, 0.0f, 255.0f));
+    uint64_t indices = 0;
+    if(r0 > r1) {
+        float palette[8] = { float(r0), float(r1) };
+        for(int p = 1; p < 7; p++) {
+            palette[p + 1] = ((7 - p) * float(r0) + p * float(r1)) / 7.0f;
+        }
+        for(int i = 0; i < 16; i++) {
+            uint64_t best = 0;
+            float bestError = 1e30f;
+            for(uint64_t p = 0; p < 8; p++) {
+                float error = std::abs(values[i] - palette[p]);
+                if(error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= best << (3 * i);
+        }
+    }
+    out[0] = r0;
+    out[1] = r1;
+    for(int b = 0; b < 6; b++) {
+        out[2 + b] = (indices >> (8 * b)) & 0xff;
+    }
+}
+
+template<size_t BlockSize, typename EncodeBlock>
+std::vector<uint8_t> encodeBlocks(const MipLevel &level, EncodeBlock &&encode)
+{
+    uint32_t blocksX = (level.width + 3) / 4;
+    uint32_t blocksY = (level.height + 3) / 4;
+    std::vector<uint8_t> out(size_t(blocksX) * blocksY * BlockSize);
+    parallelFor(blocksY, 8, [&](size_t begin, size_t end) {
+        float block[16][4];
+        for(size_t by = begin; by < end; by++) {
+            for(uint32_t bx = 0; bx < blocksX; bx++) {
+                loadBlock(level, bx, static_cast<uint32_t>(by), block);
+                encode(block, &out[(by * blocksX + bx) * BlockSize]);
+            }
+        }
+    });
+    return out;
+}
+
+}
+
+std::vector<MipLevel> buildMipChain(const uint8_t *rgba, uint32_t width, uint32_t height, bool normalMap)
+{
+    std::vector<MipLevel> levels;
+    MipLevel base{ width, height, {} };
+    base.texels.resize(size_t(width) * height * 4);
+    const std::array<float, 256> &toLinear = srgbToLinearTable();
+    parallelFor(height, 64, [&](size_t begin, size_t end) {
+        for(size_t i = begin * width; i < end * width; i++) {
+            const uint8_t *t = rgba + 4 * i;
+            float4 texel = normalMap
+                ? renormalize(float4(t[0], t[1], t[2], 0.0f) * (2.0f / 255.0f) - float4(1.0f, 1.0f, 1.0f, -t[3] / 255.0f))
+                : float4(toLinear[t[0]], toLinear[t[1]], toLinear[t[2]], t[3] / 255.0f);
+            texel.store(&base.texels[4 * i]);
+        }
+    });
+    levels.push_back(std::move(base));
+    while(levels.back().width > 1 || levels.back().height > 1) {
+        levels.push_back(downsample(levels.back(), normalMap));
+    }
+    return levels;
+}
+
+std::vector<uint8_t> encodeBC1(const MipLevel &level)
+{
+    return encodeBlocks<8>(level, [](const float block[16][4], uint8_t *out) {
+        float srgb[16][3];
+        for(int i = 0; i < 16; i++) {
+            for(int c = 0; c < 3; c++) {
+                srgb[i][c] = linearToSrgb(block[i][c]);
+            }
+        }
+        encodeBC1Block(srgb, out);
+    });
+}
+
+std::vector<uint8_t> encodeBC5(const MipLevel &level)
+{
+    return encodeBlocks<16>(level, [](const float block[16][4], uint8_t *out) {
+        float x[16], y[16];
+        for(int i = 0; i < 16; i++) {
+            x[i] = std::clamp(block[i][0] * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f;
+            y[i] = std::clamp(block[i][1] * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f;
+        }
+        encodeBC4Block(x, out);
+        encodeBC4Block(y, out + 8);
+    });
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/*
+ * CPU side of texture cooking: mip chain generation and block compression.
+ * Levels are kept as linear float RGBA while filtering, so that colour maps are averaged in linear space and
+ * normal maps as renormalized vectors, and are only quantized once when encoding.
+ */
+struct MipLevel {
+    uint32_t width;
+    uint32_t height;
+    /* RGBA per texel. Colour maps: linear colour, normal maps: xyz in [-1, 1] */
+    std::vector<float> texels;
+};
+
+/* full chain down to 1x1, level 0 included */
+std::vector<MipLevel> buildMipChain(const uint8_t *rgba, uint32_t width, uint32_t height, bool normalMap);
+
+/* 8 bytes per 4x4 block, rgb encoded to sRGB, alpha ignored */
+std::vector<uint8_t> encodeBC1(const MipLevel &level);
+/* 16 bytes per 4x4 block, x and y of the normal in two BC4 channels; z is reconstructed in the shader */
+std::vector<uint8_t> encodeBC5(const MipLevel &level);
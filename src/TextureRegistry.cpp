@@ -0,0 +1,59 @@
+#include "TextureRegistry.h"
+
+TextureRegistry::TextureRegistry(tga::Interface &tgai) : tgai{&tgai} {}
+
+TextureRegistry::~TextureRegistry()
+{
+    for(auto &[_, entry] : entries) {
+        tgai->free(entry.texture);
+    }
+}
+
+const tga::Texture *TextureRegistry::acquire(uint64_t key)
+{
+    auto it = entries.find(key);
+    if(it == entries.end()) {
+        return nullptr;
+    }
+    it->second.references++;
+    return &it->second.texture;
+}
+
+void TextureRegistry::insert(uint64_t key, tga::Texture texture, size_t bytes)
+{
+    entries.emplace(key, Entry{ texture, bytes, 0 });
+}
+
+void TextureRegistry::release(uint64_t key)
+{
+    auto it = entries.find(key);
+    if(it == entries.end()) {
+        return;
+    }
+    if(it->second.references > 1) {
+        it->second.references--;
+    } else {
+        tgai->free(it->second.texture);
+        entries.erase(it);
+    }
+}
+
+size_t TextureRegistry::bytes(uint64_t key) const
+{
+    auto it = entries.find(key);
+    return it == entries.end() ? 0 : it->second.bytes;
+}
+
+size_t TextureRegistry::textureCount() const
+{
+    return entries.size();
+}
+
+size_t TextureRegistry::totalBytes() const
+{
+    size_t total = 0;
+    for(const auto &[_, entry] : entries) {
+        total += entry.bytes;
+    }
+    return total;
+}
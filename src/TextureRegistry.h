@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+
+#include "tga/tga.hpp"
+
+/*
+ * Reference-counted textures keyed by content hash (CookedTexture::contentHash), so an image used by several meshes
+ * or material slots, like the flat 1x1 metal/roughness/ao maps, exists on the GPU once.
+ */
+class TextureRegistry {
+public:
+    TextureRegistry(tga::Interface &tgai);
+    ~TextureRegistry();
+    TextureRegistry(const TextureRegistry &) = delete;
+    TextureRegistry &operator=(const TextureRegistry &) = delete;
+
+    /* Takes a reference to the texture registered under key, nullptr if there is none */
+    const tga::Texture *acquire(uint64_t key);
+    /* Registers a texture without references, callers acquire() it like any shared one */
+    void insert(uint64_t key, tga::Texture texture, size_t bytes);
+    /* Drops a reference, the texture is freed with the last one */
+    void release(uint64_t key);
+
+    /* GPU memory of the texture under key, 0 if there is none */
+    size_t bytes(uint64_t key) const;
+    size_t textureCount() const;
+    size_t totalBytes() const;
+
+private:
+    struct Entry {
+        tga::Texture texture;
+        size_t bytes;
+        size_t references;
+    };
+
+    tga::Interface *tgai;
+    std::unordered_map<uint64_t, Entry> entries;
+};
@@ -0,0 +1,52 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    workers.reserve(threadCount);
+    for(size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for(auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+size_t ThreadPool::size() const
+{
+    return workers.size();
+}
+
+void ThreadPool::work()
+{
+    for(;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if(jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fixed set of worker threads processing jobs in submission order. The destructor drains the queue before joining. */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = std::max(std::thread::hardware_concurrency(), 1u));
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> job);
+    size_t size() const;
+
+private:
+    void work();
+
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cmath>
+
+#include "glm/gtc/packing.hpp"
+
+#include "VertexQuantization.h"
+
+namespace {
+
+int16_t snorm16(float v)
+{
+    return static_cast<int16_t>(std::round(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+float fromSnorm16(int16_t v)
+{
+    return std::max(v / 32767.0f, -1.0f);
+}
+
+float angleDegrees(glm::vec3 a, glm::vec3 b)
+{
+    float la = glm::length(a), lb = glm::length(b);
+    if(la < 1e-6f || lb < 1e-6f) {
+        return 0.0f;
+    }
+    return glm::degrees(std::acos(std::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f)));
+}
+
+}
+
+glm::vec2 octahedralEncode(glm::vec3 n)
+{
+    float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if(length < 1e-12f) {
+        return glm::vec2(0.0f);
+    }
+    n /= length;
+    glm::vec2 e{n.x, n.y};
+    if(n.z < 0.0f) {
+        // fold the lower hemisphere over the diagonals
+        e = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return e;
+}
+
+glm::vec3 octahedralDecode(glm::vec2 e)
+{
+    glm::vec3 n{e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y)};
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+QuantizedVertices quantizeVertices(const std::vector<tga::Vertex> &vertices)
+{
+    QuantizedVertices result{};
+    if(vertices.empty()) {
+        return result;
+    }
+    glm::vec3 lo = vertices[0].position, hi = vertices[0].position;
+    for(const tga::Vertex &v : vertices) {
+        lo = glm::min(lo, v.position);
+        hi = glm::max(hi, v.position);
+    }
+    glm::vec3 extent = hi - lo;
+    result.decode.positionOffset = lo;
+    result.decode.positionScale = extent;
+    result.decode.packed = 1;
+
+    result.vertices.resize(vertices.size());
+    QuantizationError &error = result.error;
+    for(size_t i = 0; i < vertices.size(); i++) {
+        const tga::Vertex &v = vertices[i];
+        PackedVertex &p = result.vertices[i];
+        glm::vec3 decoded;
+        for(int c = 0; c < 3; c++) {
+            float t = extent[c] > 0.0f ? (v.position[c] - lo[c]) / extent[c] : 0.0f;
+            p.position[c] = static_cast<uint16_t>(std::round(std::clamp(t, 0.0f, 1.0f) * 65535.0f));
+            decoded[c] = lo[c] + p.position[c] / 65535.0f * extent[c];
+        }
+        p.position[3] = 0;
+        error.position = std::max(error.position, glm::length(decoded - v.position));
+
+        for(int c = 0; c < 2; c++) {
+            p.uv[c] = glm::packHalf1x16(v.uv[c]);
+            error.uv = std::max(error.uv, std::abs(glm::unpackHalf1x16(p.uv[c]) - v.uv[c]));
+        }
+
+        glm::vec2 n = octahedralEncode(v.normal);
+        glm::vec2 t = octahedralEncode(v.tangent);
+        p.normal[0] = snorm16(n.x);
+        p.normal[1] = snorm16(n.y);
+        p.tangent[0] = snorm16(t.x);
+        p.tangent[1] = snorm16(t.y);
+        error.normalDegrees = std::max(error.normalDegrees, angleDegrees(v.normal, octahedralDecode({ fromSnorm16(p.normal[0]), fromSnorm16(p.normal[1]) })));
+        error.tangentDegrees = std::max(error.tangentDegrees, angleDegrees(v.tangent, octahedralDecode({ fromSnorm16(p.tangent[0]), fromSnorm16(p.tangent[1]) })));
+    }
+    float diagonal = glm::length(extent);
+    error.positionRelative = diagonal > 0.0f ? error.position / diagonal : 0.0f;
+    return result;
+}
+
+tga::VertexLayout vertexLayout(bool packed)
+{
+    if(packed) {
+        return tga::VertexLayout(
+            sizeof(PackedVertex),
+            {
+                {offsetof(PackedVertex, position), tga::Format::r16g16b16a16_unorm},
+                {offsetof(PackedVertex, uv), tga::Format::r16g16_sfloat},
+                {offsetof(PackedVertex, normal), tga::Format::r16g16_snorm},
+                {offsetof(PackedVertex, tangent), tga::Format::r16g16_snorm},
+            }
+        );
+    }
+    return tga::VertexLayout(
+        sizeof(tga::Vertex),
+        {
+            {offsetof(tga::Vertex, position), tga::Format::r32g32b32_sfloat},
+            {offsetof(tga::Vertex, uv), tga::Format::r32g32_sfloat},
+            {offsetof(tga::Vertex, normal), tga::Format::r32g32b32_sfloat},
+            {offsetof(tga::Vertex, tangent), tga::Format::r32g32b32_sfloat},
+        }
+    );
+}
+
+tga::VertexLayout positionLayout(bool packed)
+{
+    if(packed) {
+        return tga::VertexLayout(sizeof(PackedVertex::position), { {0, tga::Format::r16g16b16a16_unorm} });
+    }
+    return tga::VertexLayout(sizeof(glm::vec3), { {0, tga::Format::r32g32b32_sfloat} });
+}
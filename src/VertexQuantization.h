@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "tga/tga.hpp"
+
+/*
+ * Compact vertex format: positions as unorm16 relative to the mesh AABB, half float UVs and octahedral snorm16
+ * normals and tangents, 20 instead of 44 bytes per vertex. Decoding happens in mesh.vert/shadow.vert
+ * (vertex_decode.h) with the per-mesh VertexDecode uniform.
+ */
+struct PackedVertex {
+    uint16_t position[4];
+    uint16_t uv[2];
+    int16_t normal[2];
+    int16_t tangent[2];
+};
+
+/* std140 layout of the VertexDecode uniform. Unpacked meshes use the identity (offset 0, scale 1, packed 0). */
+struct VertexDecode {
+    alignas(16) glm::vec3 positionOffset = glm::vec3(0.0f);
+    alignas(16) glm::vec3 positionScale = glm::vec3(1.0f);
+    uint32_t packed = 0;
+};
+
+/* largest round trip error over all vertices */
+struct QuantizationError {
+    float position;
+    /* position error relative to the AABB diagonal */
+    float positionRelative;
+    float uv;
+    float normalDegrees;
+    float tangentDegrees;
+};
+
+struct QuantizedVertices {
+    std::vector<PackedVertex> vertices;
+    VertexDecode decode;
+    QuantizationError error;
+};
+
+QuantizedVertices quantizeVertices(const std::vector<tga::Vertex> &vertices);
+/* attribute layout for tga::Vertex or PackedVertex */
+tga::VertexLayout vertexLayout(bool packed);
+/* layout of the position-only stream used by the shadow pass, float3 or the packed unorm16x4 */
+tga::VertexLayout positionLayout(bool packed);
+
+glm::vec2 octahedralEncode(glm::vec3 n);
+glm::vec3 octahedralDecode(glm::vec2 e);
@@ -4,9 +4,15 @@
 #include <random>
 #include <filesystem>
 #include <unordered_map>
+#include <unordered_set>
+#include <memory>
 #include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <variant>
 //#include <format>
 #include <sstream>
+#include <stdexcept>
 #include <algorithm>
 #include <chrono>
 
@@ -18,17 +24,36 @@
 #include "tga/tga_utils.hpp"
 
 #include "Mesh.h"
+#include "AssetLoader.h"
+#include "TextureRegistry.h"
 #include "Scene.h"
+#include "Settings.h"
+#include "CameraPath.h"
 #include "Drawable.h"
+#include "VertexQuantization.h"
+#include "Culling.h"
+#include "SceneFile.h"
+#include "InstanceTransforms.h"
+#include "RenderQueue.h"
+#include "FrameGraph.h"
+#include "SlotStaging.h"
 #include "ShadowPass.h"
 #include "FogVolumeGenerationPass.h"
+#include "FogGridGovernor.h"
+#include "Profiler.h"
+#include "BenchmarkSummary.h"
+#include "FogParityCheck.h"
 #include "util.h"
 
 #define INSTANCE_COUNT 2048
 #define PLACING_RADIUS 3000.0f
+#define RECORD_BENCHMARK_INSTANCES 10000
+#define RECORD_BENCHMARK_ITERATIONS 100
 
 tga::Interface tgai;
 glm::uvec2 viewport;
+/* one per backbuffer, each with its own command buffer and staging slot */
+uint32_t framesInFlight = 2;
 int targetFPS = 144;
 
 class BindingSetInstance;
@@ -85,10 +110,30 @@ struct HashRenderpass {
 template<typename T>
 using PerRP = std::unordered_map<tga::RenderPass, T, HashRenderpass>;
 
+void printPackingReport(const std::string &meshTag, const Drawable &drawable, const Mesh &mesh) {
+    size_t unpackedBytes = mesh.verticesArray.size() * sizeof(tga::Vertex) + mesh.indicesArray.size() * sizeof(uint32_t);
+    const QuantizationError &error = drawable.quantizationError();
+    std::printf("[Vertex packing] %s: %zu vertices, %zu -> %zu B/vertex, 32 -> %zu bit indices, %.1f -> %.1f KiB; "
+        "max error: position %g (%.5f%% of bounds), uv %g, normal %.4f deg, tangent %.4f deg\n",
+        meshTag.c_str(), drawable.vertexCount(), sizeof(tga::Vertex), drawable.vertexStride(), 8 * drawable.indexStride(),
+        unpackedBytes / 1024.0, drawable.geometryBytes() / 1024.0,
+        error.position, 100.0f * error.positionRelative, error.uv, error.normalDegrees, error.tangentDegrees);
+}
+
+/* what verticesArray and indicesArray hold in CPU memory */
+size_t cpuGeometryBytes(const Mesh &mesh) {
+    return mesh.verticesArray.capacity() * sizeof(tga::Vertex) + mesh.indicesArray.capacity() * sizeof(uint32_t);
+}
+
 struct MeshTable {
 public:
     MeshTable() = default;
     ~MeshTable() {
+        for(auto &[_, mesh] : registeredMeshes) {
+            for(uint64_t key : mesh.textureKeys) {
+                textures.release(key);
+            }
+        }
         for (auto &[_, inputSets] : mtoTextures) {
             for(auto &[_, inputSet] : inputSets) {
                 tgai.free(inputSet);
@@ -106,125 +151,197 @@ public:
         } 
     }
 
+    /* only requests the mesh, it is available after finishLoading() */
     void load(std::string meshTag) {
-        if(mtoD.find(meshTag) != mtoD.end())
+        if(!requestedMeshes.insert(meshTag).second)
             return;
-        tga::VertexLayout vertexLayout(
-            sizeof(tga::Vertex),
-            {
-                {offsetof(tga::Vertex, position), tga::Format::r32g32b32_sfloat},
-                {offsetof(tga::Vertex, uv), tga::Format::r32g32_sfloat},
-                {offsetof(tga::Vertex, normal), tga::Format::r32g32b32_sfloat},
-                {offsetof(tga::Vertex, tangent), tga::Format::r32g32b32_sfloat},
+        meshHandles.emplace(meshTag, static_cast<uint32_t>(meshHandles.size()));
+        if(!loader)
+            loader = std::make_unique<AssetLoader>(tgai, textures);
+        // tags are directories below the assets, named like the .obj inside
+        std::string objName = std::filesystem::path(meshTag).filename().string();
+        loader->loadMesh("../assets/" + meshTag + "/" + objName + ".obj", recook, [this, meshTag](Mesh &&mesh) {
+            mtoD.emplace(std::piecewise_construct,
+                  std::forward_as_tuple(meshTag),
+                  std::forward_as_tuple(tgai, mesh, packedVertices));
+            for(auto &[rp, bDesc] : registeredPasses) {
+                createInputSet(meshTag, mesh, rp, bDesc);
+            }
+            if(packedVertices) {
+                printPackingReport(meshTag, mtoD.at(meshTag), mesh);
+            }
+            loadedCpuGeometryBytes[meshTag] = cpuGeometryBytes(mesh);
+            if(!keepCpuGeometry) {
+                // everything after this point draws from the GPU buffers
+                mesh.verticesArray = std::vector<tga::Vertex>{};
+                mesh.indicesArray = std::vector<uint32_t>{};
             }
-        );
-        Mesh mesh{tgai, ("../assets/" + meshTag + "/" + meshTag + ".obj").c_str(), vertexLayout};
-        mtoD.emplace(std::piecewise_construct,
-              std::forward_as_tuple(meshTag),
-              std::forward_as_tuple(tgai, mesh));
-        for(auto &[rp, bDesc] : registeredPasses) {
-            createInputSet(meshTag, mesh, rp, bDesc);
+
+            registeredMeshes.emplace_back(meshTag, std::move(mesh));
+        });
+    }
+
+    void finishLoading() {
+        if(loader) {
+            loader->finish();
+            loader.reset();
         }
+    }
 
-        registeredMeshes.emplace_back(std::move(meshTag), std::move(mesh));
+    /* throws std::out_of_range for tags never requested, like mtoD.at() */
+    const Mesh &mesh(const std::string &meshTag) const {
+        auto entry = std::find_if(registeredMeshes.begin(), registeredMeshes.end(), [&](const auto &entry) { return entry.first == meshTag; });
+        if(entry == registeredMeshes.end()) {
+            throw std::out_of_range("no mesh " + meshTag);
+        }
+        return entry->second;
     }
 
+    TextureRegistry textures{tgai};
     std::vector<std::pair<std::string, Mesh>> registeredMeshes;
     std::unordered_map<std::string, Drawable> mtoD;
     std::unordered_map<std::string, PerRP<tga::InputSet>> mtoTextures;
+    /* dense ids in request order, for sort keys */
+    std::unordered_map<std::string, uint32_t> meshHandles;
     std::vector<std::pair<tga::RenderPass, BindingSetDescription>> registeredPasses;
+    /* cpuGeometryBytes() of each mesh as it was loaded, before keepCpuGeometry could release it */
+    std::unordered_map<std::string, size_t> loadedCpuGeometryBytes;
+    // ignore the cooked mesh caches and rebuild them from the .obj files
+    bool recook = false;
+    // keep verticesArray/indicesArray around after upload
+    bool keepCpuGeometry = false;
+    // upload PackedVertex data and 16 bit indices where possible
+    bool packedVertices = false;
 private:
+    std::unordered_set<std::string> requestedMeshes;
+    std::unique_ptr<AssetLoader> loader;
+
     void createInputSet(const std::string &meshTag, const Mesh &mesh, tga::RenderPass rp, const BindingSetDescription &bDesc) {
         mtoTextures[meshTag][rp] = BindingSetInstance{bDesc}
             .assign("albedo", mesh.albedoMap)
             .assign("normal", mesh.normalMap)
             .assign("metallic", mesh.metallicMap)
             .assign("roughness", mesh.roughnessMap)
-            .assign("ao", mesh.aoMap).build(tgai, rp);
+            .assign("ao", mesh.aoMap)
+            .assign("vertexDecode", mtoD.at(meshTag).decodeBuffer()).build(tgai, rp);
     }
 } meshTable;
 
-struct Settings
-{
-    int demoIdx;
-    glm::vec3 lightDir;
-    glm::vec3 lightColor;
-    // Fog
-    float historyFactor;
-    float density;
-    float constantDensity;
-    float anisotropy;
-    float absorption;
-    float height;
-    bool noise;
-    float skyBlendRatio;
+Settings settings;
+
+/* the instances of one mesh in a demo, a range of the demo's InstanceTransforms */
+struct InstanceBatch {
+    /* filled by Demo::addInstance, moved into the transform buffer by createBuffers() */
+    std::vector<glm::mat4> initialTransforms;
+    size_t first = 0;
+    size_t count = 0;
+    /* position in the demo's LodSelection and render queues, set by createBuffers() */
+    uint32_t index = 0;
+    /* set once meshes are loaded, by registerPass() */
+    const Drawable *drawable = nullptr;
 };
 
-Settings settings;
+/* visible instance ids of one pass, each mesh's grouped by LOD within its range; indexed by gl_InstanceIndex */
+struct VisibleInstances {
+    std::vector<uint32_t> ids;
+    SlotStaging staging;
+    tga::Buffer buffer;
+    tga::InputSet inputSet;
+    /* ids have changed, but no executed command buffer has copied them yet */
+    bool uploadPending = false;
+};
 
 class Demo {
 public:
     Demo() = default; 
     virtual ~Demo() {
-        for(auto &[staging, _0, _1] : uploads) {
-            static_cast<void>(_0); static_cast<void>(_1);
-            tgai.free(staging);
-        }
-        for(auto &[_0, buffers] : mtoTransformBuffers) {
-            static_cast<void>(_0);
-            for(auto buffer : buffers) {
-                tgai.free(buffer);
-            }
-        }
-        for(auto &[_0, instanceInputSets] : mtoTransforms) {
-            static_cast<void>(_0);
-            for(auto inputSets : instanceInputSets) {
-                for(auto [_1, inputSet] : inputSets) {
-                    static_cast<void>(_1);
-                    tgai.free(inputSet);
-                }
-            }
+        for(auto &[_, visible] : visibleInstances) {
+            static_cast<void>(_);
+            tgai.free(visible.inputSet);
+            tgai.free(visible.buffer);
         }
     };
     Demo(const Demo &other) = delete;
     Demo &operator=(const Demo &other) = delete;
 
     virtual void update(float dt) = 0;
+    virtual const char *name() const = 0;
 
-    std::unordered_map<std::string, std::vector<PerRP<tga::InputSet>>> mtoTransforms;
-    std::unordered_map<std::string, std::vector<tga::Buffer>> mtoTransformBuffers;
-    std::vector<std::tuple<tga::StagingBuffer, tga::Buffer, size_t>> uploads;
+    std::unordered_map<std::string, InstanceBatch> instances;
+    std::unique_ptr<InstanceTransforms> transforms;
+    PerRP<VisibleInstances> visibleInstances;
+    PerRP<RenderQueue> queues;
     std::vector<std::pair<tga::RenderPass, BindingSetDescription>> registeredPasses;
     Settings settings;
+    /* binned into the froxel grid each frame while the demo is shown */
+    std::vector<LocalFogVolume> fogVolumes;
+
+    /* one storage buffer holds every instance's transform, updated through setTransform() */
+    void createBuffers(tga::ComputePass scatterPass) {
+        std::vector<glm::mat4> initial;
+        uint32_t index = 0;
+        for(auto &[meshTag, batch] : instances) {
+            static_cast<void>(meshTag);
+            batch.index = index++;
+            batch.first = initial.size();
+            initial.insert(initial.end(), batch.initialTransforms.begin(), batch.initialTransforms.end());
+            batch.initialTransforms = std::vector<glm::mat4>{};
+        }
+        transforms = std::make_unique<InstanceTransforms>(tgai, scatterPass, std::move(initial), framesInFlight);
+    }
 
     void registerPass(tga::RenderPass rp, BindingSetDescription bDesc) {
         registeredPasses.emplace_back(rp, std::move(bDesc));
-        for(auto &[meshTag, instanceInputSets] : mtoTransforms) {
-            const std::vector<tga::Buffer> &tbs = mtoTransformBuffers.at(meshTag);
-            for(size_t i = 0, end = instanceInputSets.size(); i < end; ++i) {
-                createInputSet(instanceInputSets[i], tbs[i], rp, registeredPasses.back().second);
-            }
+        VisibleInstances &visible = visibleInstances[rp];
+        size_t size = transforms->size() * sizeof(uint32_t);
+        visible.staging = SlotStaging{ tgai, size, framesInFlight };
+        visible.buffer = tgai.createBuffer({ tga::BufferUsage::storage, size });
+        visible.inputSet = BindingSetInstance{registeredPasses.back().second}.assign("transforms", transforms->buffer()).assign("instances", visible.buffer).build(tgai, rp);
+        compileQueue(rp, static_cast<uint32_t>(registeredPasses.size() - 1));
+    }
+
+    /* only needed when the demo's meshes change, registerPass() compiles each pass' queue once */
+    void compileQueues() {
+        for(uint32_t i = 0; i < registeredPasses.size(); ++i) {
+            compileQueue(registeredPasses[i].first, i);
         }
     }
 
+    const glm::mat4 &transform(const std::string &meshTag, size_t idx) const {
+        return transforms->get(instances.at(meshTag).first + idx);
+    }
+
+    void setTransform(const std::string &meshTag, size_t idx, const glm::mat4 &transform) {
+        transforms->set(instances.at(meshTag).first + idx, transform);
+    }
+
 protected:
+    /* every mesh has its own set of textures and vertex decode constants in each pass that has one, so its
+       material handle follows from the mesh handle */
+    void compileQueue(tga::RenderPass rp, uint32_t passIdx) {
+        std::vector<DrawBatch> batches(instances.size());
+        for(auto &[meshTag, batch] : instances) {
+            batch.drawable = &meshTable.mtoD.at(meshTag);
+            const PerRP<tga::InputSet> &textureSets = meshTable.mtoTextures.at(meshTag);
+            auto textureSetIt = textureSets.find(rp);
+            uint32_t mesh = meshTable.meshHandles.at(meshTag);
+            batches[batch.index] = {
+                .mesh = mesh,
+                .material = textureSetIt != textureSets.end() ? mesh + 1 : NO_MATERIAL,
+                .drawable = batch.drawable,
+                .materialSet = textureSetIt != textureSets.end() ? textureSetIt->second : tga::InputSet{},
+                .firstInstance = static_cast<uint32_t>(batch.first)
+            };
+        }
+        queues[rp].compile(passIdx, batches);
+    }
+
+    /* returns the instance's index among those of the same mesh */
     size_t addInstance(std::string name, const glm::mat4 &transform) {
         meshTable.load(name);
-        size_t idx = uploads.size();
-        tga::StagingBuffer sb = tgai.createStagingBuffer({ sizeof(glm::mat4), reinterpret_cast<const uint8_t*>(glm::value_ptr(transform)) });
-        tga::Buffer tb = tgai.createBuffer({ tga::BufferUsage::uniform, sizeof(glm::mat4), sb });
-        uploads.push_back({ sb, tb, sizeof(glm::mat4) });
-        mtoTransformBuffers[name].push_back(tb);
-        auto &inputSets = mtoTransforms[name];
-        inputSets.push_back(PerRP<tga::InputSet>{});
-        for(auto &[rp, bDesc] : registeredPasses) {
-            inputSets.back().emplace(rp, BindingSetInstance{bDesc}.assign("transform", tb).build(tgai, rp));
-        }
-        return idx;
-    }
-private:
-    void createInputSet(PerRP<tga::InputSet> &inputSets, tga::Buffer tb, tga::RenderPass rp, const BindingSetDescription &bDesc) {
-        inputSets.emplace(rp, BindingSetInstance{bDesc}.assign("transform", tb).build(tgai, rp));
+        InstanceBatch &batch = instances[name];
+        batch.initialTransforms.push_back(transform);
+        return batch.count++;
     }
 };
 
@@ -238,6 +355,9 @@ public:
         addInstance("plane", glm::scale(glm::mat4(1.0f), glm::vec3(100.0f)));
         addInstance("gnome", makeTransform(glm::vec3(-10.0, 0.0,  3.0), glm::vec3(3.0), glm::vec3(0.0, M_PI_2, 0.0)));
         addInstance("gnome", makeTransform(glm::vec3(-10.0, 0.0, -3.0), glm::vec3(3.0), glm::vec3(0.0, M_PI_2, 0.0)));
+        // a bank of mist around the gnomes and a haze filling the church
+        fogVolumes.push_back({ .shape = LocalFogShape::ellipsoid, .position = glm::vec3(-10.0, 1.0, 0.0), .halfExtents = glm::vec3(4.0, 2.0, 7.0), .density = 2.0f, .falloff = 0.5f, .noise = 1.0f });
+        fogVolumes.push_back({ .shape = LocalFogShape::box, .position = glm::vec3(0.0, 6.0, 0.0), .halfExtents = glm::vec3(6.0, 6.0, 12.0), .density = 0.5f, .falloff = 0.1f });
         settings = Settings{
         .demoIdx = 0,
         .lightDir = glm::vec3(1.0, -1.0, 0.0),
@@ -254,6 +374,7 @@ public:
     }
 
     void update(float dt) { static_cast<void>(dt); }
+    const char *name() const { return "Citadel"; }
 };
 
 class WindowDemo : public Demo {
@@ -284,6 +405,7 @@ public:
     }
 
     void update(float dt) { static_cast<void>(dt); }
+    const char *name() const { return "Window"; }
 };
 
 class AltarDemo : public Demo
@@ -316,29 +438,21 @@ public:
         };
     }
 
+    const char *name() const { return "Altar"; }
+
     void update(float dt) 
     {   
-        tga::StagingBuffer sb;
-        tga::Buffer tb; // not needed
-        size_t size;
-        glm::mat4* pSb;
         time += dt;
         float offset = 0.05f * glm::sin(0.1f * glm::radians(time));
         // Altar Move
         altarPos.y += offset;
-        std::tie(sb, tb, size) = uploads[0];
-        pSb = (glm::mat4*)(tgai.getMapping(sb));
-        *pSb = makeTransform(altarPos, glm::vec3(altarScale));
+        setTransform("altar", 0, makeTransform(altarPos, glm::vec3(altarScale)));
         // Gnome 1 Move
         gnome1Pos.y += offset;
-        std::tie(sb, tb, size) = uploads[1];
-        pSb = (glm::mat4*)(tgai.getMapping(sb));
-        *pSb = makeTransform(gnome1Pos, glm::vec3(gnome1Scale), glm::vec3(0.0, M_PI_2, 0.0));
+        setTransform("gnome", 0, makeTransform(gnome1Pos, glm::vec3(gnome1Scale), glm::vec3(0.0, M_PI_2, 0.0)));
         // Gnome 2 Move
         gnome2Pos.y += offset;
-        std::tie(sb, tb, size) = uploads[2];
-        pSb = (glm::mat4*)(tgai.getMapping(sb));
-        *pSb = makeTransform(gnome2Pos, glm::vec3(gnome2Scale), glm::vec3(0.0, M_PI_2, 0.0));
+        setTransform("gnome", 1, makeTransform(gnome2Pos, glm::vec3(gnome2Scale), glm::vec3(0.0, M_PI_2, 0.0)));
     }
 public:
     glm::vec3 altarPos; 
@@ -350,6 +464,248 @@ public:
     float time;
 };
 
+/* INSTANCE_COUNT gnomes scattered over a disc, to compare one instanced draw per mesh against one draw per instance.
+   With more meshes, they take turns */
+class StressDemo : public Demo {
+public:
+    StressDemo(int instanceCount = INSTANCE_COUNT, std::vector<std::string> meshTags = { "gnome" }, int demoIdx = 3)
+        : demoName{instanceCount == INSTANCE_COUNT ? "Stress" : "Stress " + std::to_string(instanceCount)} {
+        addInstance("plane", glm::scale(glm::mat4(1.0f), glm::vec3(PLACING_RADIUS)));
+        // fixed seed, so every run places the same crowd
+        std::mt19937 rng{1};
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for(int i = 0; i < instanceCount; i++) {
+            float r = PLACING_RADIUS * std::sqrt(unit(rng));
+            float phi = 2.0f * float(M_PI) * unit(rng);
+            float scale = 10.0f + 20.0f * unit(rng);
+            addInstance(meshTags[i % meshTags.size()], makeTransform(glm::vec3(r * std::sin(phi), 0.0, r * std::cos(phi)), glm::vec3(scale), glm::vec3(0.0, 2.0f * float(M_PI) * unit(rng), 0.0)));
+        }
+        settings = Settings{
+        .demoIdx = demoIdx,
+        .lightDir = glm::vec3(1.0, -1.0, 0.0),
+        .lightColor = glm::vec3(1.0, 0.7, 0.2),
+        .historyFactor = 0.9,
+        .density = 1.0,
+        .constantDensity = 0.175,
+        .anisotropy = -0.3,
+        .absorption = 0.3,
+        .height = 0.05,
+        .noise = true,
+        .skyBlendRatio = 1.0
+        };
+    }
+
+    void update(float dt) { static_cast<void>(dt); }
+    const char *name() const { return demoName.c_str(); }
+
+private:
+    std::string demoName;
+};
+
+/* built from a scene file, see SceneFile.h */
+class SceneDemo : public Demo {
+public:
+    SceneDemo(const SceneDescription &scene, int demoIdx) : sceneName{scene.name} {
+        fogVolumes = scene.fogVolumes;
+        typedef std::chrono::high_resolution_clock clock;
+        clock::time_point start = clock::now();
+        size_t count = 0;
+        for(const Placement &placement : scene.placements) {
+            meshTable.load(placement.mesh);
+            InstanceBatch &batch = instances[placement.mesh];
+            batch.initialTransforms.reserve(batch.initialTransforms.size() + placement.instanceCount());
+            placeInstances(placement, [&](const glm::mat4 &transform) {
+                batch.initialTransforms.push_back(transform);
+            });
+            batch.count = batch.initialTransforms.size();
+            count += placement.instanceCount();
+        }
+        std::printf("[Scene] %s: placed %zu instances in %.3f ms\n", sceneName.c_str(), count,
+            std::chrono::duration<double, std::milli>(clock::now() - start).count());
+
+        settings = Settings{
+        .demoIdx = demoIdx,
+        .lightDir = glm::vec3(1.0, -1.0, 0.0),
+        .lightColor = glm::vec3(1.0, 0.7, 0.2),
+        .historyFactor = 0.9,
+        .density = 1.0,
+        .constantDensity = 0.175,
+        .anisotropy = -0.3,
+        .absorption = 0.3,
+        .height = 0.05,
+        .noise = true,
+        .skyBlendRatio = 1.0
+        };
+        for(auto &[name, values] : scene.settings) {
+            applySetting(name, values);
+        }
+    }
+
+    void update(float dt) { static_cast<void>(dt); }
+    const char *name() const { return sceneName.c_str(); }
+
+private:
+    std::string sceneName;
+
+    void applySetting(const std::string &name, const std::vector<float> &values) {
+        std::unordered_map<std::string, float*> scalars = {
+            { "historyfactor", &settings.historyFactor },
+            { "density", &settings.density },
+            { "constantdensity", &settings.constantDensity },
+            { "anisotropy", &settings.anisotropy },
+            { "absorption", &settings.absorption },
+            { "height", &settings.height },
+            { "skyblendratio", &settings.skyBlendRatio },
+            { "fogrange", &settings.fogRange },
+            { "depthexponent", &settings.depthExponent },
+        };
+        std::unordered_map<std::string, glm::vec3*> vectors = {
+            { "lightdir", &settings.lightDir },
+            { "lightcolor", &settings.lightColor },
+        };
+        if(auto it = scalars.find(name); it != scalars.end() && values.size() == 1) {
+            *it->second = values[0];
+        } else if(auto it = vectors.find(name); it != vectors.end() && values.size() == 3) {
+            *it->second = glm::vec3(values[0], values[1], values[2]);
+        } else if(name == "noise" && values.size() == 1) {
+            settings.noise = values[0] != 0.0f;
+        } else {
+            std::printf("[Scene] %s: ignoring setting %s with %zu values\n", sceneName.c_str(), name.c_str(), values.size());
+        }
+    }
+};
+
+void writeTrace(const Profiler &profiler, const std::string &path)
+{
+    if(profiler.writeChromeTrace(path)) {
+        std::printf("[Profiler] wrote %s, %llu events recorded since start\n", path.c_str(), static_cast<unsigned long long>(profiler.recorded()));
+    } else {
+        std::printf("[Profiler] could not write %s\n", path.c_str());
+    }
+}
+
+/* what each demo's meshes hold in CPU geometry and textures, against one copy per mesh and slot with CPU geometry kept */
+void printMemoryReport()
+{
+    auto mib = [](size_t bytes) { return bytes / (1024.0 * 1024.0); };
+    for(auto &demo : demos) {
+        size_t geometryBefore = 0, geometryAfter = 0, texturesBefore = 0, texturesAfter = 0, textureSlots = 0;
+        size_t vertexFetch = 0, unpackedVertexFetch = 0;
+        std::unordered_set<uint64_t> uniqueTextures;
+        for(auto &[meshTag, batch] : demo->instances) {
+            const Mesh &mesh = meshTable.mesh(meshTag);
+            const Drawable &drawable = meshTable.mtoD.at(meshTag);
+            geometryBefore += meshTable.loadedCpuGeometryBytes.at(meshTag);
+            // every instance is drawn in the shadow pass (positions only) and the forward pass, each vertex fetched at least once
+            vertexFetch += batch.count * drawable.vertexCount() * (drawable.vertexStride() + drawable.positionStride());
+            unpackedVertexFetch += 2 * batch.count * drawable.vertexCount() * sizeof(tga::Vertex);
+            geometryAfter += cpuGeometryBytes(mesh);
+            for(uint64_t key : mesh.textureKeys) {
+                textureSlots++;
+                texturesBefore += meshTable.textures.bytes(key);
+                if(uniqueTextures.insert(key).second) {
+                    texturesAfter += meshTable.textures.bytes(key);
+                }
+            }
+        }
+        std::printf("[Memory] %s: CPU geometry %.2f MiB -> %.2f MiB, textures %zu -> %zu (%.2f MiB -> %.2f MiB)\n", demo->name(),
+            mib(geometryBefore), mib(geometryAfter), textureSlots, uniqueTextures.size(), mib(texturesBefore), mib(texturesAfter));
+        std::printf("[Memory] %s: vertex fetch per frame %.2f MiB (%.2f MiB with full unpacked vertices in both passes)\n", demo->name(), mib(vertexFetch), mib(unpackedVertexFetch));
+    }
+    std::printf("[Memory] All demos: %zu textures, %.2f MiB\n", meshTable.textures.textureCount(), mib(meshTable.textures.totalBytes()));
+}
+
+constexpr uint32_t CULLED = ~0u;
+
+struct PassStats {
+    size_t visible = 0;
+    size_t culled = 0;
+    size_t triangles = 0;
+    size_t draws = 0;
+    /* the visible ids have changed since they were last uploaded */
+    bool idsChanged = false;
+};
+
+/* what selectLods works in, kept between frames so it does not allocate; one per view, so views can be culled
+   concurrently */
+struct LodScratch {
+    BoundsBatch boxes;
+    std::vector<uint8_t> visible;
+    std::vector<uint32_t> instanceLods;
+    std::vector<uint32_t> ids;
+    LodSelection selection;
+};
+
+/* frustum culls all instances of the demo in one batch, picks a LOD for the visible ones and writes their ids to
+   rp's staging slot if they changed since the last upload. The selection lives in scratch until the next call. */
+const LodSelection &selectLods(Demo &demo, tga::RenderPass rp, uint32_t slot, const glm::mat4 &viewProjection, float viewportHeight, bool lod, bool cull, LodScratch &scratch, PassStats &stats)
+{
+    BoundsBatch &boxes = scratch.boxes;
+    std::vector<uint8_t> &visible = scratch.visible;
+    std::vector<uint32_t> &instanceLods = scratch.instanceLods;
+    boxes.clear();
+    for(auto &[meshTag, batch] : demo.instances) {
+        static_cast<void>(meshTag);
+        const Aabb &bounds = batch.drawable->bounds();
+        for(size_t i = 0; i < batch.count; ++i) {
+            boxes.push(transformAabb(bounds, demo.transforms->get(batch.first + i)));
+        }
+    }
+    if(cull) {
+        cullBoxes(Frustum{viewProjection}, boxes, visible);
+    } else {
+        visible.assign(boxes.size(), 1);
+    }
+
+    LodSelection &selection = scratch.selection;
+    selection.assign(demo.instances.size() * MAX_DRAW_LODS, 0);
+    stats = {};
+    size_t instance = 0;
+    // unused entries at the end of each mesh's range stay 0, so unchanged selections compare equal
+    std::vector<uint32_t> &ids = scratch.ids;
+    ids.assign(demo.transforms->size(), 0);
+    for(auto &[meshTag, batch] : demo.instances) {
+        static_cast<void>(meshTag);
+        const Drawable &drawable = *batch.drawable;
+        uint32_t *lodCounts = &selection[batch.index * MAX_DRAW_LODS];
+        size_t lodCount = std::min(drawable.lodCount(), MAX_DRAW_LODS);
+        instanceLods.resize(batch.count);
+        for(size_t i = 0; i < batch.count; ++i) {
+            if(!visible[instance++]) {
+                instanceLods[i] = CULLED;
+                stats.culled++;
+                continue;
+            }
+            instanceLods[i] = lod ? static_cast<uint32_t>(std::min(drawable.selectLod(demo.transforms->get(batch.first + i), viewProjection, viewportHeight), lodCount - 1)) : 0;
+            lodCounts[instanceLods[i]]++;
+            stats.visible++;
+            stats.triangles += drawable.triangleCount(instanceLods[i]);
+        }
+        // counting sort by LOD, so each LOD's instances are a contiguous range of gl_InstanceIndex
+        uint32_t next[MAX_DRAW_LODS];
+        next[0] = static_cast<uint32_t>(batch.first);
+        for(size_t l = 1; l < lodCount; ++l) {
+            next[l] = next[l - 1] + lodCounts[l - 1];
+        }
+        for(size_t i = 0; i < batch.count; ++i) {
+            if(instanceLods[i] != CULLED) {
+                ids[next[instanceLods[i]]++] = static_cast<uint32_t>(batch.first + i);
+            }
+        }
+        stats.draws += lodCount - std::count(lodCounts, lodCounts + lodCount, 0u);
+    }
+    VisibleInstances &passIds = demo.visibleInstances.at(rp);
+    if(ids != passIds.ids) {
+        passIds.ids = ids;
+        passIds.uploadPending = true;
+    }
+    if(passIds.uploadPending) {
+        passIds.staging.write(slot, ids.data(), ids.size() * sizeof(uint32_t));
+    }
+    stats.idsChanged = passIds.uploadPending;
+    return selection;
+}
+
 double getDeltaTime()
 {
     typedef std::chrono::high_resolution_clock clock;
@@ -422,12 +778,35 @@ void processInputs(const tga::Window& win, Scene& scene, double dt)
 
 }
 
-void setupDemos() {
+void setupDemos(const std::vector<std::string> &sceneFiles, tga::ComputePass scatterPass, bool recordBenchmark) {
     demos.emplace_back(std::make_unique<CitadelDemo>());
     currentDemo = demos.back().get();
     settings = currentDemo->settings;
     demos.emplace_back(std::make_unique<WindowDemo>());
     demos.emplace_back(std::make_unique<AltarDemo>());
+    demos.emplace_back(std::make_unique<StressDemo>());
+    for(const std::string &path : sceneFiles) {
+        SceneDescription scene;
+        std::string error;
+        if(!parseSceneFile(path, "../assets", scene, error)) {
+            std::cerr << "[Scene] " << error << "\n";
+            continue;
+        }
+        demos.emplace_back(std::make_unique<SceneDemo>(scene, static_cast<int>(demos.size())));
+    }
+    if(recordBenchmark) {
+        // the meshes of the other demos, so materials change between draws
+        demos.emplace_back(std::make_unique<StressDemo>(RECORD_BENCHMARK_INSTANCES, std::vector<std::string>{ "gnome", "altar", "church", "window", "ceiling" }, static_cast<int>(demos.size())));
+    }
+    for(auto &demo : demos) {
+        demo->createBuffers(scatterPass);
+        size_t instanceCount = 0;
+        for(auto &[_, batch] : demo->instances) {
+            instanceCount += batch.count;
+        }
+        std::printf("[Instancing] %s: %zu instances of %zu meshes, one instanced draw per mesh and LOD instead of %zu draws per pass\n",
+            demo->name(), instanceCount, demo->instances.size(), instanceCount);
+    }
 }
 
 bool handleDemoChange(int idx) {
@@ -439,18 +818,65 @@ bool handleDemoChange(int idx) {
     return false;
 }
 
+/* count coloured point lights a few metres above the ground, over a disc around the origin that grows with them so
+   about ten overlap anywhere on it; each reaches 12 to 17 m, see LightClusters */
+void scatterPointLights(Scene &scene, uint32_t count)
+{
+    // fixed seed, so every run lights the same
+    std::mt19937 rng{2};
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float radius = 5.0f * std::sqrt(static_cast<float>(count));
+    for(uint32_t i = 0; i < count; i++) {
+        float r = radius * std::sqrt(unit(rng));
+        float phi = 2.0f * float(M_PI) * unit(rng);
+        glm::vec3 position(r * std::sin(phi), 1.0f + 4.0f * unit(rng), r * std::cos(phi));
+        glm::vec3 color = glm::vec3(unit(rng), unit(rng), unit(rng)) * 2.0f;
+        scene.addPointLight(position, color, glm::vec3(1.0f, 0.7f, 1.8f));
+    }
+}
+
 int main(int argc, const char *argv[])
 {
     struct Flags {
         unsigned int changeDir : 1;
+        unsigned int fogParity : 1;
+        unsigned int recook : 1;
+        unsigned int keepCpuGeometry : 1;
+        unsigned int memoryReport : 1;
+        unsigned int packedVertices : 1;
+        unsigned int noLod : 1;
+        unsigned int noCulling : 1;
+        unsigned int recordBenchmark : 1;
+        unsigned int dumpFrameGraph : 1;
+        unsigned int headless : 1;
+        unsigned int syncFrames : 1;
     } flags = {};
+    FogPrecision fogPrecision = FogPrecision::half;
+    FogInterleave fogInterleave;
+    NoiseParams fogNoise;
+    // 0 leaves the froxel grid to the GUI
+    double fogBudget = 0.0;
+    // scattered over the ground for the light clusters to cull, see scatterPointLights
+    uint32_t pointLightCount = 0;
+    std::string tracePath;
+    // headless benchmark
+    std::array<uint32_t, 2> headlessResolution = { 1920, 1080 };
+    int headlessDemo = 0;
+    // 0 for 300, or as many as the played path takes
+    uint32_t benchmarkFrames = 0;
+    uint32_t warmupFrames = 60;
+    std::string summaryPath;
+    // camera paths
+    std::string recordPathFile;
+    std::string playPathFile;
 
     auto usage = [argc, argv]() {
-        std::cerr << "Usage: " << (argc > 0 ? argv[0] : "./ex4") << " [-c] [<file>]\n";
+        std::cerr << "Usage: " << (argc > 0 ? argv[0] : "./ex4") << " [-c] [--fog-parity] [--recook] [--keep-cpu-geometry] [--memory-report] [--packed-vertices] [--no-lod] [--no-culling] [--record-benchmark] [--frame-graph] [--sync-frames] [--fog-precision <full|half|packed>] [--fog-interleave <ways>] [--fog-interleave-order <checkerboard|slices>] [--fog-noise-size <texels>] [--fog-budget <ms>] [--point-lights <count>] [--trace <file>] [--record-path <file>] [--play-path <file>] [--scene <file>]... [--headless <width>x<height> [--demo <index>] [--frames <n>] [--warmup <n>] [--summary <file>]] [<file>]\n";
         exit(1);
     };
 
     std::vector<std::string_view> positionalArgs;
+    std::vector<std::string> sceneFiles;
     for(int argId = 1; argId < argc; argId++) {
         auto arg = std::string_view{argv[argId]};
         if(arg.empty()) {
@@ -461,6 +887,79 @@ int main(int argc, const char *argv[])
             positionalArgs.push_back(arg);
         } else if(arg == "-c") {
             flags.changeDir = 1;
+        } else if(arg == "--fog-parity") {
+            flags.fogParity = 1;
+        } else if(arg == "--recook") {
+            flags.recook = 1;
+        } else if(arg == "--keep-cpu-geometry") {
+            flags.keepCpuGeometry = 1;
+        } else if(arg == "--memory-report") {
+            flags.memoryReport = 1;
+        } else if(arg == "--packed-vertices") {
+            flags.packedVertices = 1;
+        } else if(arg == "--no-lod") {
+            flags.noLod = 1;
+        } else if(arg == "--no-culling") {
+            flags.noCulling = 1;
+        } else if(arg == "--record-benchmark") {
+            flags.recordBenchmark = 1;
+        } else if(arg == "--frame-graph") {
+            flags.dumpFrameGraph = 1;
+        } else if(arg == "--sync-frames") {
+            flags.syncFrames = 1;
+        } else if(arg == "--fog-precision" && argId + 1 < argc && parseFogPrecision(argv[argId + 1], fogPrecision)) {
+            argId++;
+        } else if(arg == "--fog-interleave" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &fogInterleave.ways) != 1 || fogInterleave.ways == 0) {
+                usage();
+            }
+        } else if(arg == "--fog-interleave-order" && argId + 1 < argc) {
+            if(!parseFogInterleaveOrder(argv[++argId], fogInterleave.order)) {
+                usage();
+            }
+        } else if(arg == "--fog-noise-size" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &fogNoise.size) != 1 || fogNoise.size == 0) {
+                usage();
+            }
+        } else if(arg == "--fog-budget" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%lf", &fogBudget) != 1 || fogBudget <= 0.0) {
+                usage();
+            }
+        } else if(arg == "--point-lights" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &pointLightCount) != 1) {
+                usage();
+            }
+        } else if(arg == "--trace" && argId + 1 < argc) {
+            // absolute, -c changes the working directory
+            tracePath = std::filesystem::absolute(argv[++argId]).string();
+        } else if(arg == "--headless" && argId + 1 < argc) {
+            flags.headless = 1;
+            if(std::sscanf(argv[++argId], "%ux%u", &headlessResolution[0], &headlessResolution[1]) != 2 || headlessResolution[0] == 0 || headlessResolution[1] == 0) {
+                usage();
+            }
+        } else if(arg == "--demo" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%d", &headlessDemo) != 1 || headlessDemo < 0) {
+                usage();
+            }
+        } else if(arg == "--frames" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &benchmarkFrames) != 1 || benchmarkFrames == 0) {
+                usage();
+            }
+        } else if(arg == "--warmup" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &warmupFrames) != 1) {
+                usage();
+            }
+        } else if(arg == "--summary" && argId + 1 < argc) {
+            // absolute, -c changes the working directory
+            summaryPath = std::filesystem::absolute(argv[++argId]).string();
+        } else if(arg == "--record-path" && argId + 1 < argc) {
+            // absolute, -c changes the working directory
+            recordPathFile = std::filesystem::absolute(argv[++argId]).string();
+        } else if(arg == "--play-path" && argId + 1 < argc) {
+            playPathFile = std::filesystem::absolute(argv[++argId]).string();
+        } else if(arg == "--scene" && argId + 1 < argc) {
+            // absolute, -c changes the working directory
+            sceneFiles.push_back(std::filesystem::absolute(argv[++argId]).string());
         } else {
             // Add more options here
             usage();
@@ -478,50 +977,63 @@ int main(int argc, const char *argv[])
             usage();
     }
 
+    CameraPath playedPath;
+    if(!playPathFile.empty()) {
+        std::string error;
+        if(!playedPath.load(playPathFile, error)) {
+            std::cerr << "[Camera path] " << error << "\n";
+            return 1;
+        }
+    }
+    CameraPath recordedPath;
+    // played paths and the headless benchmark advance by this, every run does the same work however fast the device is
+    constexpr double FIXED_DT = 1000.0 / 60.0;
+    if(benchmarkFrames == 0) {
+        benchmarkFrames = playedPath.empty() ? 300 : playedPath.frameCount(FIXED_DT);
+    }
+
     if (flags.changeDir && argc >= 0) {
         std::filesystem::path executable{argv[0]};
         std::filesystem::current_path(executable.parent_path());
     }
 
-    // Window with the resolution of your screen
-    auto [wWidth, wHeight] = tgai.screenResolution();
-    auto win = tgai.createWindow({ wWidth, wHeight, tga::PresentMode::immediate });
-    tgai.initGUI(win);
-    viewport = glm::uvec2(wWidth, wHeight);
+    // Window with the resolution of your screen, or an offscreen texture without one
+    typedef std::variant<tga::Texture, tga::Window, std::vector<tga::Texture>> RenderTarget;
+    tga::Window win;
+    tga::Texture offscreenTarget;
+    RenderTarget renderTarget;
+    if(flags.headless) {
+        offscreenTarget = tgai.createTexture({ headlessResolution[0], headlessResolution[1], tga::Format::r8g8b8a8_unorm });
+        renderTarget = offscreenTarget;
+        viewport = glm::uvec2(headlessResolution[0], headlessResolution[1]);
+    } else {
+        auto [wWidth, wHeight] = tgai.screenResolution();
+        win = tgai.createWindow({ wWidth, wHeight, tga::PresentMode::immediate });
+        tgai.initGUI(win);
+        renderTarget = win;
+        viewport = glm::uvec2(wWidth, wHeight);
+        framesInFlight = tgai.backbufferCount(win);
+    }
     // Scene
-    Scene scene(tgai);
+    Scene scene(tgai, framesInFlight);
     // Setup the camera
     scene.initCamera(glm::vec3(0.0f, 10.0f, 10.0f), 0.0f, 0.0f, 0.0f);
     scene.setAmbientFactor(0.1f);
     // Directional light
     scene.setDirLight(glm::normalize(glm::vec3(1.0f, -0.5f, -0.2f)), glm::vec3(0.85f, 0.6f, 0.0f));
-    static std::mt19937 rng(std::random_device{}());
-    //for(int i = 0; i < MAX_NR_OF_POINT_LIGHTS; ++i)
-    //{
-    //    std::uniform_real_distribution<float> posDist(-50, 50);
-    //    // std::uniform_real_distribution<float> colorDist(0, 100);
-    //    scene.addPointLight(glm::vec3(posDist(rng), posDist(rng), posDist(rng)), glm::vec3(1.0f), glm::vec3(1.0f, 0.007f, 0.0002f));
-    //}
+    scatterPointLights(scene, pointLightCount);
 
     // Update Camera Data at the beginning
     scene.updateSceneBufferCameraData(viewport);
 
     // Prepare the vertex layout for the meshes (all the obj loaded meshes share the same structure)
-    tga::VertexLayout vertexLayout(
-        sizeof(tga::Vertex),
-        {
-            {offsetof(tga::Vertex, position), tga::Format::r32g32b32_sfloat},
-            {offsetof(tga::Vertex, uv), tga::Format::r32g32_sfloat},
-            {offsetof(tga::Vertex, normal), tga::Format::r32g32b32_sfloat},
-            {offsetof(tga::Vertex, tangent), tga::Format::r32g32b32_sfloat},
-        }
-    );
+    tga::VertexLayout meshVertexLayout = vertexLayout(flags.packedVertices);
     
     // Prepare the Input (whole collection of sets) Layout (Descriptor Set(s))
-    // Set 0: Global Scene Data, Set 1: mesh data, Set 2: object data
-    tga::SetLayout meshDescriptorSet0Layout = tga::SetLayout{ {tga::BindingType::uniformBuffer, tga::BindingType::uniformBuffer, tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::uniformBuffer} };
-    tga::SetLayout meshDescriptorSet1Layout = tga::SetLayout{ {tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::sampler} };
-    tga::SetLayout meshDescriptorSet2Layout = tga::SetLayout{ {tga::BindingType::uniformBuffer} };
+    // Set 0: Global Scene Data, Set 1: mesh data, Set 2: instance transforms and visible instance ids
+    tga::SetLayout meshDescriptorSet0Layout = tga::SetLayout{ {tga::BindingType::uniformBuffer, tga::BindingType::uniformBuffer, tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::uniformBuffer, tga::BindingType::sampler, tga::BindingType::storageBuffer} };
+    tga::SetLayout meshDescriptorSet1Layout = tga::SetLayout{ {tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::sampler, tga::BindingType::uniformBuffer} };
+    tga::SetLayout meshDescriptorSet2Layout = tga::SetLayout{ {tga::BindingType::storageBuffer, tga::BindingType::storageBuffer} };
     tga::InputLayout meshDescriptorLayout = tga::InputLayout( { meshDescriptorSet0Layout, meshDescriptorSet1Layout, meshDescriptorSet2Layout } );
 
     // Load shader code from file
@@ -530,102 +1042,487 @@ int main(int argc, const char *argv[])
 
     constexpr uint32_t SHADOW_MAP_RESX = 4096;
     constexpr uint32_t SHADOW_MAP_RESY = 4096;
-    ShadowPass sp{ tgai, { SHADOW_MAP_RESX, SHADOW_MAP_RESY }, vertexLayout };
-    FogVolumeGenerationPass fp {tgai, { 512, 256, 256 }, sp};
+    // froxel grid resolutions to pick from, by hand or by the governor, coarsest first
+    const std::vector<std::array<uint32_t, 3>> FOG_GRID_LEVELS = { { 128, 64, 64 }, { 192, 96, 96 }, { 256, 128, 128 }, { 384, 192, 192 }, { 512, 256, 256 } };
+    FogGridGovernor fogGovernor{ FOG_GRID_LEVELS, FOG_GRID_LEVELS.size() - 1, fogBudget > 0.0 ? fogBudget : FogGridGovernor::DEFAULT_BUDGET_MS };
+    bool governFogGrid = fogBudget > 0.0;
+    int fogGridLevel = static_cast<int>(FOG_GRID_LEVELS.size() - 1);
+    const std::array<uint32_t, 3> FOG_VOLUME_RES = FOG_GRID_LEVELS.back();
+
+    // The frame's resources and the passes using them, in recording order. The graph is compiled before the passes
+    // are created, they are handed its transient textures
+    FrameGraph graph{tgai};
+    FrameGraph::Resource instanceData = graph.importResource("instance data");
+    FrameGraph::Resource constants = graph.importResource("constants");
+    FrameGraph::Resource shadowMap = graph.createTexture("shadow map", ShadowPass::shadowMapInfo({ SHADOW_MAP_RESX, SHADOW_MAP_RESY }), ShadowPass::shadowMapBytes({ SHADOW_MAP_RESX, SHADOW_MAP_RESY }));
+    FrameGraph::Resource fogLighting = graph.importResource("fog lighting");
+    FrameGraph::Resource fogScattering = graph.createTexture("fog scattering", FogVolumeGenerationPass::volumeInfo(FOG_VOLUME_RES, fogPrecision), fogVolumeBytes(FOG_VOLUME_RES, fogPrecision));
+    // packed volumes keep the alpha channel apart, otherwise it is part of the scattering volume
+    bool splitFogAlpha = fogPrecision == FogPrecision::packed;
+    FrameGraph::Resource fogTransmittance = splitFogAlpha
+        ? graph.createTexture("fog transmittance", FogVolumeGenerationPass::alphaVolumeInfo(FOG_VOLUME_RES), fogAlphaVolumeBytes(FOG_VOLUME_RES))
+        : fogScattering;
+    FrameGraph::Resource backbuffer = graph.importResource("backbuffer");
+    graph.markOutput(backbuffer);
+    FrameGraph::Pass uploadPass = graph.addPass("upload")
+        .write(instanceData, tga::PipelineStage::Transfer)
+        .write(instanceData, tga::PipelineStage::ComputeShader) // changed transforms are scattered by compute
+        .write(constants, tga::PipelineStage::Transfer);
+    FrameGraph::Pass shadowPass = graph.addPass("shadow")
+        .read(instanceData, tga::PipelineStage::VertexShader)
+        .read(constants, tga::PipelineStage::VertexShader)
+        .write(shadowMap, tga::PipelineStage::ColorAttachmentOutput);
+    FrameGraph::Pass fogLightingPass = graph.addPass("fog lighting")
+        .read(constants, tga::PipelineStage::ComputeShader)
+        .read(shadowMap, tga::PipelineStage::ComputeShader)
+        .read(fogLighting, tga::PipelineStage::ComputeShader) // last frame's volume, as history
+        .write(fogLighting, tga::PipelineStage::ComputeShader);
+    FrameGraph::PassBuilder fogRaymarchPass = graph.addPass("fog raymarch")
+        .read(constants, tga::PipelineStage::ComputeShader)
+        .read(fogLighting, tga::PipelineStage::ComputeShader)
+        .write(fogScattering, tga::PipelineStage::ComputeShader);
+    FrameGraph::PassBuilder forwardPass = graph.addPass("forward")
+        .read(instanceData, tga::PipelineStage::VertexShader)
+        .read(constants, tga::PipelineStage::VertexShader)
+        .read(constants, tga::PipelineStage::FragmentShader)
+        .read(shadowMap, tga::PipelineStage::FragmentShader)
+        .read(fogScattering, tga::PipelineStage::FragmentShader)
+        .write(backbuffer, tga::PipelineStage::ColorAttachmentOutput);
+    FrameGraph::PassBuilder skyPass = graph.addPass("sky")
+        .read(constants, tga::PipelineStage::FragmentShader)
+        .read(fogScattering, tga::PipelineStage::FragmentShader)
+        .write(backbuffer, tga::PipelineStage::ColorAttachmentOutput);
+    if(splitFogAlpha) {
+        fogRaymarchPass.write(fogTransmittance, tga::PipelineStage::ComputeShader);
+        forwardPass.read(fogTransmittance, tga::PipelineStage::FragmentShader);
+        skyPass.read(fogTransmittance, tga::PipelineStage::FragmentShader);
+    }
+    graph.compile();
+    if(flags.dumpFrameGraph) {
+        std::cout << graph.dump();
+    }
+
+    ShadowPass sp{ tgai, graph.texture(shadowMap), { SHADOW_MAP_RESX, SHADOW_MAP_RESY }, positionLayout(flags.packedVertices), framesInFlight };
+    // baked on the first run with these parameters and cached next to the textures, --recook bakes it again
+    NoiseVolume fogNoiseVolume = loadNoiseVolume("../assets/textures", fogNoise, flags.recook);
+    if(fogNoiseVolume.bakeMillis > 0.0) {
+        std::printf("[Noise] baked the %u^3 fog noise volume in %.1f ms\n", fogNoise.size, fogNoiseVolume.bakeMillis);
+    }
+    FogVolumeGenerationPass fp {tgai, FogGrid{ FOG_VOLUME_RES }, fogPrecision, sp, fogNoiseVolume, framesInFlight, scene.lightBuffer(), graph.texture(fogScattering), splitFogAlpha ? graph.texture(fogTransmittance) : tga::Texture{}};
+    fp.setInterleave(fogInterleave);
 
     // Create the Render pass
-    auto rpInfo = tga::RenderPassInfo{vs, fs, win}
+    auto rpInfo = tga::RenderPassInfo{vs, fs, renderTarget}
         .setClearOperations(tga::ClearOperation::all)
         .setPerPixelOperations(tga::PerPixelOperations{}.setDepthCompareOp(tga::CompareOperation::lessEqual))
         .setRasterizerConfig(tga::RasterizerConfig().setFrontFace(tga::FrontFace::counterclockwise).setCullMode(tga::CullMode::back))
         .setInputLayout(meshDescriptorLayout)
-        .setVertexLayout(vertexLayout);
+        .setVertexLayout(meshVertexLayout);
     auto rp = tgai.createRenderPass(rpInfo);
 
-    setupDemos();
-    meshTable.registerPass(rp, std::move(BindingSetDescription{1}.declare("albedo", 0, 0).declare("normal", 1, 0).declare("metallic", 2, 0).declare("roughness", 3, 0).declare("ao", 4, 0)));
+    typedef std::chrono::high_resolution_clock clock;
+    clock::time_point loadStart = clock::now();
+    meshTable.recook = flags.recook;
+    meshTable.keepCpuGeometry = flags.keepCpuGeometry;
+    meshTable.packedVertices = flags.packedVertices;
+    tga::ComputePass scatterPass = InstanceTransforms::createScatterPass(tgai);
+    setupDemos(sceneFiles, scatterPass, flags.recordBenchmark);
+    if(!playedPath.empty() && playedPath.maxDemoIdx() >= static_cast<int>(demos.size())) {
+        std::cerr << "[Camera path] " << playPathFile << " switches to demo " << playedPath.maxDemoIdx() << ", there are only " << demos.size() << "\n";
+        return 1;
+    }
+    meshTable.finishLoading();
+    std::cout << "[Startup] Loaded demos in " << std::chrono::duration<double, std::milli>(clock::now() - loadStart).count() << " ms using " << std::thread::hardware_concurrency() << " loader threads\n";
+    if(flags.memoryReport) {
+        printMemoryReport();
+    }
+    meshTable.registerPass(rp, std::move(BindingSetDescription{1}.declare("albedo", 0, 0).declare("normal", 1, 0).declare("metallic", 2, 0).declare("roughness", 3, 0).declare("ao", 4, 0).declare("vertexDecode", 5, 0)));
+    meshTable.registerPass(sp.renderPass(), std::move(BindingSetDescription{2}.declare("vertexDecode", 0, 0)));
     for(auto &demo : demos) {
-        demo->registerPass(rp, std::move(BindingSetDescription{2}.declare("transform", 0, 0)));
-        demo->registerPass(sp.renderPass(), std::move(BindingSetDescription{1}.declare("transform", 0, 0)));
+        demo->registerPass(rp, std::move(BindingSetDescription{2}.declare("transforms", 0, 0).declare("instances", 1, 0)));
+        demo->registerPass(sp.renderPass(), std::move(BindingSetDescription{1}.declare("transforms", 0, 0).declare("instances", 1, 0)));
     }
 
     // Load shader code from file
     auto skyVs = tga::loadShader("../shaders/sky_vert.spv", tga::ShaderType::vertex, tgai);
     auto skyFs = tga::loadShader("../shaders/sky_frag.spv", tga::ShaderType::fragment, tgai);
-    auto skyRpInfo = tga::RenderPassInfo{skyVs, skyFs, win}
+    auto skyRpInfo = tga::RenderPassInfo{skyVs, skyFs, renderTarget}
         .setClearOperations(tga::ClearOperation::none)
         .setPerPixelOperations(tga::PerPixelOperations{}.setDepthCompareOp(tga::CompareOperation::lessEqual))
         .setRasterizerConfig(tga::RasterizerConfig().setFrontFace(tga::FrontFace::counterclockwise).setCullMode(tga::CullMode::back))
-        .setInputLayout(tga::InputLayout( { tga::SetLayout { tga::BindingType::uniformBuffer, tga::BindingType::sampler, tga::BindingType::uniformBuffer } } ))
+        .setInputLayout(tga::InputLayout( { tga::SetLayout { tga::BindingType::uniformBuffer, tga::BindingType::sampler, tga::BindingType::uniformBuffer, tga::BindingType::sampler } } ))
         .setVertexLayout(tga::VertexLayout { 0, {} });
     auto skyRp = tgai.createRenderPass(skyRpInfo);
-    tga::InputSet skyInput = tgai.createInputSet({ skyRp, { tga::Binding(scene.buffer(), 0), tga::Binding(fp.scatteringVolume(), 1), tga::Binding(fp.inputBuffer(), 2) } , 0 });
-
+    tga::InputSet skyInput;
     // Create global input (descriptor) set
-    tga::InputSet globalInput = tgai.createInputSet({ rp, { tga::Binding(scene.buffer(), 0), tga::Binding(sp.inputBuffer(), 1), tga::Binding(sp.shadowMap(), 2), tga::Binding(fp.scatteringVolume(), 3), tga::Binding(fp.inputBuffer(), 4) } , 0 });
+    tga::InputSet globalInput;
+    // again whenever the fog grid's resolution, and with it the scattering volume, changes
+    auto createGlobalInputs = [&]() {
+        skyInput = tgai.createInputSet({ skyRp, { tga::Binding(scene.buffer(), 0), tga::Binding(fp.scatteringVolume(), 1), tga::Binding(fp.inputBuffer(), 2), tga::Binding(fp.scatteringAlphaVolume(), 3) } , 0 });
+        globalInput = tgai.createInputSet({ rp, { tga::Binding(scene.buffer(), 0), tga::Binding(sp.inputBuffer(), 1), tga::Binding(sp.shadowMap(), 2), tga::Binding(fp.scatteringVolume(), 3), tga::Binding(fp.inputBuffer(), 4), tga::Binding(fp.scatteringAlphaVolume(), 5), tga::Binding(scene.lightBuffer(), 6) } , 0 });
+    };
+    createGlobalInputs();
 
-    std::vector<tga::CommandBuffer> cmdBuffers(tgai.backbufferCount(win));
+    // offscreen, two command buffers still alternate the fog's lighting volumes
+    std::vector<tga::CommandBuffer> cmdBuffers(framesInFlight);
 
-    auto renderMeshes = [](tga::CommandRecorder &recorder, tga::RenderPass rp) {
-        for(auto [meshName, transforms] : currentDemo->mtoTransforms) {
-            auto textureSets = meshTable.mtoTextures.at(meshName);
-            auto textureSetIt = textureSets.find(rp);
-            if(textureSetIt != textureSets.end()) {
-                recorder.bindInputSet(textureSetIt->second);
-            } // else no textures needed for this pass
-            Drawable &drawable = meshTable.mtoD.at(meshName);
-            for(auto &transform : transforms) {
-                recorder.bindInputSet(transform.at(rp));
-                drawable.draw(recorder);
+    auto renderMeshes = [](tga::CommandRecorder &recorder, tga::RenderPass rp, bool positionsOnly, const LodSelection &lods) {
+        // the visible ids of all meshes share one set, the queue binds the per-mesh ones
+        recorder.bindInputSet(currentDemo->visibleInstances.at(rp).inputSet);
+        return currentDemo->queues.at(rp).record(recorder, lods, positionsOnly);
+    };
+
+    /* everything a recorded command buffer depends on, besides the contents of staging buffers */
+    struct FrameState {
+        LodSelection forwardLods, shadowLods;
+        size_t transformUpdates = 0;
+        std::array<size_t, 2> localFogUpload{};
+        std::array<size_t, 2> lightUpload{};
+        bool forwardIdsChanged = false;
+        bool shadowIdsChanged = false;
+
+        bool operator==(const FrameState &other) const = default;
+    };
+    // visibility and LODs are picked per frame, each command buffer remembers the state it was recorded with
+    FrameState frameState;
+    PassStats forwardStats, shadowStats;
+    LodScratch forwardScratch, shadowScratch;
+    RecordStats forwardRecord, shadowRecord;
+    std::vector<std::optional<FrameState>> recordedStates(cmdBuffers.size());
+    auto updateFrameState = [&](uint32_t slot) {
+        frameState.forwardLods = selectLods(*currentDemo, rp, slot, scene.viewProjection(), float(viewport.y), !flags.noLod, !flags.noCulling, forwardScratch, forwardStats);
+        // the shadow map's texels set the acceptable error there, not the screen's pixels. Its frustum is fitted
+        // around the camera's and reaches towards the light, so casters outside the view are kept
+        frameState.shadowLods = selectLods(*currentDemo, sp.renderPass(), slot, sp.lightViewProjection(), float(SHADOW_MAP_RESY), !flags.noLod, !flags.noCulling, shadowScratch, shadowStats);
+        frameState.transformUpdates = currentDemo->transforms->flush(slot);
+        frameState.localFogUpload = fp.localFogUpload();
+        frameState.lightUpload = scene.lightClusters().uploadExtent();
+        frameState.forwardIdsChanged = forwardStats.idsChanged;
+        frameState.shadowIdsChanged = shadowStats.idsChanged;
+    };
+    // per frame transfers of instance data, static scenes get by without any
+    auto instanceUploadBytes = [&]() {
+        size_t idBytes = currentDemo->transforms->size() * sizeof(uint32_t);
+        return InstanceTransforms::uploadBytes(frameState.transformUpdates)
+            + (frameState.forwardIdsChanged ? idBytes : 0) + (frameState.shadowIdsChanged ? idBytes : 0);
+    };
+
+    // CPU spans of the frame's stages and of recording each pass, the GPU's frame time and per frame counters
+    Profiler profiler;
+
+    graph.setExecute(uploadPass, [&](tga::CommandRecorder &recorder, uint32_t nf) {
+        ProfileScope scope{profiler, "upload"};
+        // Scene Buffer is global and every mesh using the pipeline (we only have 1) uses the same buffer so loading it once per frame.
+        scene.bufferUpload(recorder, nf);
+        currentDemo->transforms->record(recorder, frameState.transformUpdates, nf);
+        size_t idBytes = currentDemo->transforms->size() * sizeof(uint32_t);
+        for(auto [pass, changed] : { std::pair{ rp, frameState.forwardIdsChanged }, std::pair{ sp.renderPass(), frameState.shadowIdsChanged } }) {
+            if(changed) {
+                const VisibleInstances &visible = currentDemo->visibleInstances.at(pass);
+                recorder.bufferUpload(visible.staging.buffer(nf), visible.buffer, idBytes);
             }
         }
+        sp.upload(recorder, nf);
+        fp.upload(recorder, nf);
+    });
+    graph.setExecute(shadowPass, [&](tga::CommandRecorder &recorder, uint32_t nf) {
+        ProfileScope scope{profiler, "shadow pass"};
+        sp.bind(recorder, nf);
+        shadowRecord = renderMeshes(recorder, sp.renderPass(), true, frameState.shadowLods);
+    });
+    graph.setExecute(fogLightingPass, [&](tga::CommandRecorder &recorder, uint32_t nf) {
+        ProfileScope scope{profiler, "fog generation"};
+        fp.generate(recorder, nf);
+    });
+    graph.setExecute(fogRaymarchPass, [&](tga::CommandRecorder &recorder, uint32_t nf) {
+        ProfileScope scope{profiler, "fog raymarch"};
+        fp.raymarch(recorder, nf);
+    });
+    graph.setExecute(forwardPass, [&](tga::CommandRecorder &recorder, uint32_t nf) {
+        ProfileScope scope{profiler, "forward pass"};
+        recorder.setRenderPass(rp, nf, {0.0, 0.0, 0.0, 1.0});
+        recorder.bindInputSet(globalInput);
+        forwardRecord = renderMeshes(recorder, rp, false, frameState.forwardLods);
+    });
+    graph.setExecute(skyPass, [&](tga::CommandRecorder &recorder, uint32_t nf) {
+        ProfileScope scope{profiler, "sky pass"};
+        recorder.setRenderPass(skyRp, nf);
+        recorder.bindInputSet(skyInput);
+        recorder.draw(6, 0);
+    });
+
+    auto recordCmdBuffer = [&](size_t i) {
+        ProfileScope scope{profiler, "record"};
+        tgai.free(cmdBuffers[i]);
+        cmdBuffers[i] = {};
+        tga::CommandRecorder recorder = tga::CommandRecorder{ tgai, cmdBuffers[i] };
+        graph.execute(recorder, static_cast<uint32_t>(i));
+        cmdBuffers[i] = recorder.endRecording();
+        recordedStates[i] = frameState;
     };
-    
-    auto rebuildCmdBuffers = [&]() {
-        // Prepare the command buffers
-        for(size_t i = 0; i < cmdBuffers.size(); ++i)
-        {
-            tgai.free(cmdBuffers[i]);
-            cmdBuffers[i] = {};
-            tga::CommandRecorder recorder = tga::CommandRecorder{ tgai, cmdBuffers[i] };
-            // Scene Buffer is global and every mesh using the pipeline (we only have 1) uses the same buffer so loading it once per frame.
-            scene.bufferUpload(recorder);
-            for(auto [staging, target, size] : currentDemo->uploads) {
-                recorder.bufferUpload(staging, target, size);
-            }
 
-            sp.upload(recorder);
-            fp.upload(recorder);
+    // command buffers are recorded on demand, for the state of the frame they are used in
+    auto rebuildCmdBuffers = [&]() {
+        std::fill(recordedStates.begin(), recordedStates.end(), std::nullopt);
+    };
 
-            recorder.barrier(tga::PipelineStage::Transfer, tga::PipelineStage::VertexShader);
+    rebuildCmdBuffers();
 
-            // Shadow pass
-            sp.bind(recorder, i);
-            renderMeshes(recorder, sp.renderPass());
+    // Frames are not waited for after submission. A slot's command buffer and staging are only reused once its
+    // previous frame completed, so the CPU builds the next frames while the GPU works on the last ones
+    std::vector<std::optional<Profiler::clock::time_point>> slotSubmitted(cmdBuffers.size());
+    Profiler::clock::time_point lastCompleted{};
+    // Returns the GPU time of the slot's pending frame if its completion could be observed: TGA has no timestamp
+    // queries, so only a wait that blocks, or one right after submission (sync), shows when the frame completed
+    auto waitForSlot = [&](uint32_t nf, bool sync) -> std::optional<double> {
+        if(!slotSubmitted[nf]) {
+            return std::nullopt;
+        }
+        constexpr std::chrono::microseconds BLOCKED{100};
+        Profiler::clock::time_point waitStart = Profiler::clock::now();
+        {
+            ProfileScope scope{profiler, "wait for GPU"};
+            tgai.waitForCompletion(cmdBuffers[nf]);
+        }
+        Profiler::clock::time_point completed = Profiler::clock::now();
+        Profiler::clock::time_point submitted = *std::exchange(slotSubmitted[nf], std::nullopt);
+        if(!sync && completed - waitStart < BLOCKED) {
+            return std::nullopt;
+        }
+        // the GPU starts on a frame once it is submitted and the one before has completed
+        Profiler::clock::time_point started = std::max(submitted, lastCompleted);
+        lastCompleted = completed;
+        profiler.span("frame", Profiler::Track::gpu, started, completed);
+        return std::chrono::duration<double, std::milli>(completed - started).count();
+    };
+    auto waitForFrames = [&]() {
+        for(uint32_t nf = 0; nf < cmdBuffers.size(); ++nf) {
+            waitForSlot(nf, false);
+        }
+    };
 
-            // Volume compute pass
-            recorder.setRenderPass(tga::RenderPass{nullptr}, i);
-            recorder.barrier(tga::PipelineStage::ColorAttachmentOutput, tga::PipelineStage::ComputeShader);
-            fp.execute(recorder, i);
-            recorder.barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::FragmentShader);
-            recorder.barrier(tga::PipelineStage::ColorAttachmentOutput, tga::PipelineStage::FragmentShader);
+    // TGA has no timestamp queries, so the fog grid governor is fed the fog passes timed alone: every
+    // FOG_SAMPLE_INTERVAL frames the queue is drained and they are run again on the inputs of the frame just
+    // submitted, which they recompute unchanged. Frames stay in flight in between
+    constexpr uint32_t FOG_SAMPLE_INTERVAL = 15;
+    constexpr uint32_t FOG_SAMPLE_REPEATS = 4;
+    auto sampleFogCost = [&](uint32_t nf) {
+        ProfileScope scope{profiler, "fog cost sample"};
+        waitForFrames();
+        tga::CommandRecorder recorder{ tgai };
+        for(FrameGraph::Pass pass : { fogLightingPass, FrameGraph::Pass(fogRaymarchPass) }) {
+            graph.executeAlone(recorder, pass, nf, FOG_SAMPLE_REPEATS);
+        }
+        tga::CommandBuffer cmd = recorder.endRecording();
+        Profiler::clock::time_point start = Profiler::clock::now();
+        tgai.execute(cmd);
+        tgai.waitForCompletion(cmd);
+        double ms = std::chrono::duration<double, std::milli>(Profiler::clock::now() - start).count() / FOG_SAMPLE_REPEATS;
+        tgai.free(cmd);
+        return ms;
+    };
 
-            // Forward pass
-            recorder.setRenderPass(rp, i, {0.0, 0.0, 0.0, 1.0});
-            recorder.bindInputSet(globalInput);
-            renderMeshes(recorder, rp);
+    // between frames; waits for those in flight before replacing the volumes they use
+    auto applyFogGrid = [&](const FogGrid &grid) {
+        if(grid == fp.grid()) {
+            return;
+        }
+        if(grid.resolution == fp.grid().resolution) {
+            fp.setGrid(grid, fp.scatteringVolume(), splitFogAlpha ? fp.scatteringAlphaVolume() : tga::Texture{});
+            return;
+        }
+        waitForFrames();
+        graph.setTextureInfo(fogScattering, FogVolumeGenerationPass::volumeInfo(grid.resolution, fogPrecision), fogVolumeBytes(grid.resolution, fogPrecision));
+        if(splitFogAlpha) {
+            graph.setTextureInfo(fogTransmittance, FogVolumeGenerationPass::alphaVolumeInfo(grid.resolution), fogAlphaVolumeBytes(grid.resolution));
+        }
+        graph.compile();
+        fp.setGrid(grid, graph.texture(fogScattering), splitFogAlpha ? graph.texture(fogTransmittance) : tga::Texture{});
+        tgai.free(skyInput);
+        tgai.free(globalInput);
+        createGlobalInputs();
+        rebuildCmdBuffers();
+    };
 
-            //recorder.barrier(tga::PipelineStage::ColorAttachmentOutput, tga::PipelineStage::EarlyFragmentTests);
+    // CPU time of the render queue at RECORD_BENCHMARK_INSTANCES instances, from the initial camera
+    if(flags.recordBenchmark) {
+        currentDemo = demos.back().get();
+        settings = currentDemo->settings;
+        typedef std::chrono::duration<double, std::micro> micro;
+        auto mean = [](clock::time_point start) { return micro(clock::now() - start).count() / RECORD_BENCHMARK_ITERATIONS; };
+        clock::time_point start = clock::now();
+        for(int i = 0; i < RECORD_BENCHMARK_ITERATIONS; i++) {
+            currentDemo->compileQueues();
+        }
+        double compileTime = mean(start);
+        start = clock::now();
+        for(int i = 0; i < RECORD_BENCHMARK_ITERATIONS; i++) {
+            updateFrameState(0);
+        }
+        double selectTime = mean(start);
+        start = clock::now();
+        for(int i = 0; i < RECORD_BENCHMARK_ITERATIONS; i++) {
+            recordCmdBuffer(0);
+        }
+        double recordTime = mean(start);
+        std::printf("[RenderQueue] %s: %zu instances, %zu + %zu packets; forward %zu draws, %zu binds; shadow %zu draws, %zu binds\n",
+            currentDemo->name(), currentDemo->transforms->size(), currentDemo->queues.at(rp).packetCount(), currentDemo->queues.at(sp.renderPass()).packetCount(),
+            forwardRecord.draws, forwardRecord.binds, shadowRecord.draws, shadowRecord.binds);
+        std::printf("[RenderQueue] mean of %d: compile %.1f us, culling and LOD selection %.1f us, recording %.1f us\n",
+            RECORD_BENCHMARK_ITERATIONS, compileTime, selectTime, recordTime);
+        return 0;
+    }
 
-            recorder.setRenderPass(skyRp, i);
-            recorder.bindInputSet(skyInput);
-            recorder.draw(6, 0);
+    uint64_t frameNumber = 0;
+    const Demo *fogVolumesDemo = nullptr;
+    // the scene, shadow and fog inputs of the frame into its staging slot, after the scene was updated
+    auto updatePasses = [&](uint32_t nf) {
+        scene.stage(nf);
+        {
+            ProfileScope scope{profiler, "shadow update"};
+            sp.update(scene, 200.0f, nf);
+        }
+        {
+            ProfileScope scope{profiler, "fog update"};
+            if(fogVolumesDemo != currentDemo) {
+                fp.setLocalVolumes(currentDemo->fogVolumes);
+                fogVolumesDemo = currentDemo;
+            }
+            fp.update(scene, frameNumber++, nf, settings.historyFactor, settings.density, settings.constantDensity, settings.anisotropy, settings.absorption, settings.height, settings.noise, settings.skyBlendRatio);
+        }
+        {
+            ProfileScope scope{profiler, "light clusters"};
+            scene.clusterLights(fogFroxelFrustum(fp.inputs()), nf);
+        }
+    };
+    // culls, records the command buffer if needed and submits it without waiting; the slot must have been waited for
+    auto submitFrame = [&](uint32_t nf) {
+        {
+            ProfileScope scope{profiler, "culling and LOD selection"};
+            updateFrameState(nf);
+        }
+        if(recordedStates[nf] != frameState) {
+            // the slot's previous frame has completed, so this buffer is not in use any more
+            recordCmdBuffer(nf);
+        }
+        profiler.counter("draws", double(forwardStats.draws));
+        profiler.counter("shadow draws", double(shadowStats.draws));
+        profiler.counter("triangles", double(forwardStats.triangles + shadowStats.triangles));
+        profiler.counter("input set binds", double(forwardRecord.binds + shadowRecord.binds));
+        slotSubmitted[nf] = Profiler::clock::now();
+        tgai.execute(cmdBuffers[nf]);
+        for(auto &[pass, visible] : currentDemo->visibleInstances) {
+            visible.uploadPending = false;
+        }
+    };
 
-            cmdBuffers[i] = recorder.endRecording();
+    // the played path's camera and settings at t milliseconds; the fog noise follows t instead of the wall clock
+    auto playPath = [&](double t) {
+        CameraPath::Key key = playedPath.sample(t);
+        scene.setCameraPose(key.position, key.pitch, key.yaw, key.roll);
+        scene.updateSceneBufferCameraData(viewport);
+        const Settings &pathSettings = playedPath.settings(t);
+        if(handleDemoChange(pathSettings.demoIdx)) {
+            rebuildCmdBuffers();
         }
+        settings = pathSettings;
+        fp.setTime(t / 1000.0);
     };
 
-    rebuildCmdBuffers();
+    // a fixed number of frames from the initial camera or along the played path without a window, then each pass alone
+    if(flags.headless) {
+        if(headlessDemo >= static_cast<int>(demos.size())) {
+            std::cerr << "[Benchmark] there is no demo " << headlessDemo << ", only " << demos.size() << "\n";
+            return 1;
+        }
+        handleDemoChange(headlessDemo);
+        rebuildCmdBuffers();
+        constexpr uint32_t PASS_REPEATS = 10;
+        typedef std::chrono::duration<double, std::milli> milli;
+        std::vector<double> frameTimes, gpuTimes;
+        Profiler::clock::time_point measureStart = Profiler::clock::now();
+        for(uint32_t frame = 0; frame < warmupFrames + benchmarkFrames; ++frame) {
+            if(frame == warmupFrames) {
+                measureStart = Profiler::clock::now();
+            }
+            Profiler::clock::time_point frameStart = Profiler::clock::now();
+            std::optional<double> gpuTime;
+            {
+                ProfileScope frameScope{profiler, "frame"};
+                uint32_t nf = frame % cmdBuffers.size();
+                gpuTime = waitForSlot(nf, false);
+                {
+                    ProfileScope scope{profiler, "scene update"};
+                    // the warmup settles the history at the start of the path
+                    double t = frame < warmupFrames ? 0.0 : (frame - warmupFrames) * FIXED_DT;
+                    if(playedPath.empty()) {
+                        fp.setTime(t / 1000.0);
+                    } else {
+                        playPath(t);
+                    }
+                    scene.setDirLight(glm::normalize(settings.lightDir), settings.lightColor);
+                    currentDemo->update(FIXED_DT);
+                }
+                updatePasses(nf);
+                submitFrame(nf);
+                if(flags.syncFrames) {
+                    gpuTime = waitForSlot(nf, true);
+                }
+            }
+            if(frame >= warmupFrames) {
+                frameTimes.push_back(milli(Profiler::clock::now() - frameStart).count());
+                if(gpuTime) {
+                    gpuTimes.push_back(*gpuTime);
+                }
+            }
+            if(governFogGrid && frame % FOG_SAMPLE_INTERVAL == 0) {
+                fogGovernor.update(sampleFogCost(frame % cmdBuffers.size()));
+            }
+            applyFogGrid({ fogGovernor.resolution(), settings.fogRange, settings.depthExponent });
+        }
+
+        waitForFrames();
+        BenchmarkSummary summary{ currentDemo->name(), headlessResolution, fp.grid().resolution, fogPrecisionName(fogPrecision), fogInterleave.ways,
+                                  fogInterleaveOrderName(fogInterleave.order), warmupFrames,
+                                  flags.syncFrames ? 1 : framesInFlight, timingStats(frameTimes), timingStats(gpuTimes), profiler.cpuTotals(measureStart), {} };
+        for(auto &[name, total] : summary.cpuStages) {
+            total /= benchmarkFrames;
+        }
+        // includes one submission, spread over the repetitions
+        for(FrameGraph::Pass pass = 0; pass < graph.passCount(); ++pass) {
+            if(!graph.isKept(pass)) {
+                continue;
+            }
+            tga::CommandRecorder recorder{ tgai };
+            graph.executeAlone(recorder, pass, 0, PASS_REPEATS);
+            tga::CommandBuffer cmd = recorder.endRecording();
+            Profiler::clock::time_point start = Profiler::clock::now();
+            tgai.execute(cmd);
+            tgai.waitForCompletion(cmd);
+            summary.passes.emplace_back(graph.passName(pass), milli(Profiler::clock::now() - start).count() / PASS_REPEATS);
+            tgai.free(cmd);
+        }
+
+        std::printf("[Benchmark] %s at %ux%u, fog %ux%ux%u %s, %u frames after %u warmup, %u in flight\n", summary.demo.c_str(), headlessResolution[0], headlessResolution[1],
+            summary.fogGrid[0], summary.fogGrid[1], summary.fogGrid[2], summary.fogPrecision.c_str(), benchmarkFrames, warmupFrames, summary.framesInFlight);
+        if(summary.fogInterleave > 1) {
+            std::printf("[Benchmark] fog lit %u ways interleaved (%s)\n", summary.fogInterleave, summary.fogInterleaveOrder.c_str());
+        }
+        for(auto [label, stats] : { std::pair{ "frame", summary.frame }, std::pair{ "GPU", summary.gpu } }) {
+            std::printf("[Benchmark] %s: mean %.3f ms, median %.3f, p95 %.3f, p99 %.3f, min %.3f, max %.3f (%zu frames)\n", label, stats.mean, stats.median, stats.p95, stats.p99, stats.min, stats.max, stats.count);
+        }
+        for(const auto &[name, ms] : summary.passes) {
+            std::printf("[Benchmark] pass %s: %.3f ms\n", name.c_str(), ms);
+        }
+        if(!summaryPath.empty() && !writeBenchmarkSummary(summaryPath, summary)) {
+            std::printf("[Benchmark] could not write %s\n", summaryPath.c_str());
+            return 1;
+        }
+        if(!tracePath.empty()) {
+            writeTrace(profiler, tracePath);
+        }
+        return 0;
+    }
 
     // Frame limit parameters
     double targetFrequency = (1.0 / targetFPS) * 1000; // in ms
@@ -633,11 +1530,12 @@ int main(int argc, const char *argv[])
     std::chrono::system_clock::time_point prevFrameEnd;
     double smoothedFps = 0.0;
     constexpr float historyWeight = 0.9;
-    // Record and present until signal to close
+    // Record and present until signal to close, or the end of the played path
     double time = 0.0;
-    uint64_t frameNumber = 0;
-    while (!tgai.windowShouldClose(win))
+    uint32_t playedFrames = 0;
+    while (!tgai.windowShouldClose(win) && (playedPath.empty() || playedFrames < playedPath.frameCount(FIXED_DT)))
     {
+        ProfileScope frameScope{profiler, "frame"};
         if (handleDemoChange(settings.demoIdx)) {
             rebuildCmdBuffers();
         }
@@ -666,45 +1564,128 @@ int main(int argc, const char *argv[])
         std::stringstream sstream;
         sstream.setf(std::ios::fixed, std::ios::floatfield);
         sstream.precision(3);
-        sstream << "[FPS]: " << fps << " (Smoothed: " << smoothedFps << ")";
+        sstream << "[FPS]: " << fps << " (Smoothed: " << smoothedFps << ") [Draws]: " << forwardStats.draws << " (Shadow: " << shadowStats.draws << ")"
+                << " [Triangles]: " << forwardStats.triangles << " (Shadow: " << shadowStats.triangles << ")"
+                << " [Visible]: " << forwardStats.visible << "/" << forwardStats.visible + forwardStats.culled
+                << " (Shadow: " << shadowStats.visible << "/" << shadowStats.visible + shadowStats.culled << ")"
+                << " [Uploads]: " << instanceUploadBytes() / 1024.0 << " KiB"
+                << " [Fog]: " << fp.grid().resolution[0] << "x" << fp.grid().resolution[1] << "x" << fp.grid().resolution[2];
         tgai.setWindowTitle(win, sstream.str());//std::format("[FPS]: {} (Smoothed: {})", fps, smoothedFps));
-        processInputs(win, scene, dt);
-        scene.setDirLight(glm::normalize(settings.lightDir), settings.lightColor);
-        currentDemo->update(dt);
-        sp.update(scene, 200.0f);
-        fp.update(scene, frameNumber++, settings.historyFactor, settings.density, settings.constantDensity, settings.anisotropy, settings.absorption, settings.height, settings.noise, settings.skyBlendRatio);
         auto nf = tgai.nextFrame(win);
-        auto& cmd = cmdBuffers[nf];
-        tgai.execute(cmd);
+        waitForSlot(nf, false);
+        {
+            ProfileScope scope{profiler, "scene update"};
+            if(playedPath.empty()) {
+                processInputs(win, scene, dt);
+            } else {
+                playPath(playedFrames++ * FIXED_DT);
+            }
+            if(!recordPathFile.empty()) {
+                recordedPath.record(time, scene.camera(), settings);
+            }
+            scene.setDirLight(glm::normalize(settings.lightDir), settings.lightColor);
+            currentDemo->update(playedPath.empty() ? dt : FIXED_DT);
+        }
+        updatePasses(nf);
+        submitFrame(nf);
+
+        bool saveTrace = false;
+        {
+            ProfileScope scope{profiler, "gui pass"};
+            tga::CommandRecorder recorder = tga::CommandRecorder{ tgai };
+            recorder.guiPass(win, nf, [&](){
+                ImGui::Begin("Scene");
+                if(demos.size() > 1)
+                    ImGui::SliderInt(currentDemo->name(), &settings.demoIdx, 0, static_cast<int>(demos.size() - 1));
+
+                ImGui::Text("Directional Light");
+                ImGui::SliderFloat3("Direction: " , glm::value_ptr(settings.lightDir), -1.0f, 1.0f);
+                ImGui::SliderFloat3("Color: ", glm::value_ptr(settings.lightColor), 0.0f, 1.0f);
+
+                ImGui::Text("Volumetric Fog");
+                ImGui::SliderFloat("History Weight: ", &settings.historyFactor, 0.0f, 1.0f);
+                ImGui::SliderFloat("Density: ", &settings.density, 0.0f, 1.0f);
+                ImGui::SliderFloat("Constant Density: ", &settings.constantDensity, 0.0f, 1.0f);
+                ImGui::SliderFloat("Anisotropy: ", &settings.anisotropy, -0.9f, 0.9f);
+                ImGui::SliderFloat("Absorption: ", &settings.absorption, 0.0f, 1.0f);
+                ImGui::SliderFloat("Height: ", &settings.height, 0.0f, 1.0f);
+                ImGui::Checkbox("Noise: ", &settings.noise);
+                ImGui::SliderFloat("Sky Blend Ratio: ", &settings.skyBlendRatio, 0.0f, 1.0f);
+                ImGui::SliderFloat("Range: ", &settings.fogRange, 50.0f, 1000.0f);
+                ImGui::SliderFloat("Depth Exponent: ", &settings.depthExponent, 1.0f, 4.0f);
+                ImGui::Checkbox("Fog Budget: ", &governFogGrid);
+                if(governFogGrid) {
+                    float budget = static_cast<float>(fogGovernor.budget());
+                    if(ImGui::SliderFloat("Fog Budget (ms): ", &budget, 0.5f, 10.0f)) {
+                        fogGovernor.setBudget(budget);
+                    }
+                    ImGui::Text("Grid Level: %zu (%.2f ms)", fogGovernor.level(), fogGovernor.cost());
+                } else if(ImGui::SliderInt("Grid Level: ", &fogGridLevel, 0, static_cast<int>(FOG_GRID_LEVELS.size() - 1))) {
+                    fogGovernor.setLevel(static_cast<size_t>(fogGridLevel));
+                }
+                int interleaveWays = static_cast<int>(fogInterleave.ways);
+                int interleaveOrder = static_cast<int>(fogInterleave.order);
+                static const char *const INTERLEAVE_ORDERS[] = { "checkerboard", "slices" };
+                if(ImGui::SliderInt("Interleave: ", &interleaveWays, 1, 8) | ImGui::Combo("Interleave Order: ", &interleaveOrder, INTERLEAVE_ORDERS, 2)) {
+                    fogInterleave = { static_cast<uint32_t>(interleaveWays), static_cast<FogInterleaveOrder>(interleaveOrder) };
+                    fp.setInterleave(fogInterleave);
+                }
+                const LocalFogBins &localFog = fp.localFog();
+                ImGui::Text("Local Volumes: %zu, %zu references (%.3f ms)", localFog.volumes().size(), localFog.lists().references().size(), localFog.lists().binMillis());
+                const LightClusters &lightClusters = scene.lightClusters();
+                ImGui::Text("Point Lights: %zu, %zu references (%.3f ms)", lightClusters.lights().size(), lightClusters.lists().references().size(), lightClusters.lists().binMillis());
 
-        tga::CommandRecorder recorder = tga::CommandRecorder{ tgai };
-        recorder.guiPass(win, nf, [](){
-            ImGui::Begin("Scene");
-            if(demos.size() > 1)
-                ImGui::SliderInt("Demo", &settings.demoIdx, 0, static_cast<int>(demos.size() - 1));
 
-            ImGui::Text("Directional Light");
-            ImGui::SliderFloat3("Direction: " , glm::value_ptr(settings.lightDir), -1.0f, 1.0f);
-            ImGui::SliderFloat3("Color: ", glm::value_ptr(settings.lightColor), 0.0f, 1.0f);
+                ImGui::Text("Profiler");
+                if(ImGui::Button("Save Trace")) {
+                    saveTrace = true;
+                }
 
-            ImGui::Text("Volumetric Fog");
-            ImGui::SliderFloat("History Weight: ", &settings.historyFactor, 0.0f, 1.0f);
-            ImGui::SliderFloat("Density: ", &settings.density, 0.0f, 1.0f);
-            ImGui::SliderFloat("Constant Density: ", &settings.constantDensity, 0.0f, 1.0f);
-            ImGui::SliderFloat("Anisotropy: ", &settings.anisotropy, -0.9f, 0.9f);
-            ImGui::SliderFloat("Absorption: ", &settings.absorption, 0.0f, 1.0f);
-            ImGui::SliderFloat("Height: ", &settings.height, 0.0f, 1.0f);
-            ImGui::Checkbox("Noise: ", &settings.noise);
-            ImGui::SliderFloat("Sky Blend Ratio: ", &settings.skyBlendRatio, 0.0f, 1.0f);
+                ImGui::End();
+            });
+            tgai.execute(recorder.endRecording());
+        }
 
+        {
+            ProfileScope scope{profiler, "present"};
+            tgai.present(win, nf);
+        }
+        if(flags.syncFrames) {
+            waitForSlot(nf, true);
+        }
 
-            ImGui::End();
-        });
-        tgai.execute(recorder.endRecording());
+        // compare against the CPU reference once the temporal history has settled a bit
+        constexpr uint64_t FOG_PARITY_FRAME = 16;
+        if(flags.fogParity && frameNumber == FOG_PARITY_FRAME) {
+            waitForFrames();
+            FogParityCheck{tgai, fp, sp, scene.lightClusters()}.run(nf);
+        }
 
-        tgai.present(win, nf);
-        tgai.waitForCompletion(cmd);
+        if(governFogGrid && frameNumber % FOG_SAMPLE_INTERVAL == 0) {
+            fogGovernor.update(sampleFogCost(nf));
+            fogGridLevel = static_cast<int>(fogGovernor.level());
+        }
+        applyFogGrid({ fogGovernor.resolution(), settings.fogRange, settings.depthExponent });
+
+        if(saveTrace) {
+            writeTrace(profiler, tracePath.empty() ? "fog_trace.json" : tracePath);
+        }
     }
 
+    // the resources of the frames still in flight are freed on return
+    waitForFrames();
+    if(!playedPath.empty()) {
+        std::printf("[Camera path] played %u frames of %s\n", playedFrames, playPathFile.c_str());
+    }
+    if(!recordPathFile.empty()) {
+        if(recordedPath.save(recordPathFile)) {
+            std::printf("[Camera path] wrote %zu frames to %s\n", recordedPath.keyCount(), recordPathFile.c_str());
+        } else {
+            std::printf("[Camera path] could not write %s\n", recordPathFile.c_str());
+        }
+    }
+    if(!tracePath.empty()) {
+        writeTrace(profiler, tracePath);
+    }
     return 0;
 }
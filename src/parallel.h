@@ -0,0 +1,36 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/*
+ * Splits [0, count) into chunks of `grain` items and hands them out to one thread per hardware core.
+ * fn(begin, end) is called once per chunk, possibly concurrently.
+ */
+template<typename F>
+void parallelFor(size_t count, size_t grain, F &&fn) {
+    if(count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (count + grain - 1) / grain;
+    size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), chunks);
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for(size_t chunk = next++; chunk < chunks; chunk = next++) {
+            size_t begin = chunk * grain;
+            fn(begin, std::min(begin + grain, count));
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for(size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for(auto &thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+
+/*
+ * Minimal 4-wide float vector for the CPU-side fog and asset tools.
+ * SSE2 is part of every x86-64 target, so it is used unconditionally there; other architectures fall back to
+ * plain loops that the compiler is free to auto-vectorize.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace simd {
+
+struct float4 {
+#ifdef SIMD_SSE2
+    __m128 v;
+    float4() = default;
+    float4(__m128 v) : v{v} {}
+    float4(float s) : v{_mm_set1_ps(s)} {}
+    float4(float a, float b, float c, float d) : v{_mm_setr_ps(a, b, c, d)} {}
+    static float4 load(const float *p) { return _mm_loadu_ps(p); }
+    void store(float *p) const { _mm_storeu_ps(p, v); }
+    float operator[](int i) const { alignas(16) float tmp[4]; _mm_store_ps(tmp, v); return tmp[i]; }
+#else
+    float v[4];
+    float4() = default;
+    float4(float s) : v{s, s, s, s} {}
+    float4(float a, float b, float c, float d) : v{a, b, c, d} {}
+    static float4 load(const float *p) { return float4(p[0], p[1], p[2], p[3]); }
+    void store(float *p) const { std::copy(v, v + 4, p); }
+    float operator[](int i) const { return v[i]; }
+#endif
+};
+
+#ifdef SIMD_SSE2
+inline float4 operator+(float4 a, float4 b) { return _mm_add_ps(a.v, b.v); }
+inline float4 operator-(float4 a, float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline float4 operator*(float4 a, float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline float4 operator/(float4 a, float4 b) { return _mm_div_ps(a.v, b.v); }
+inline float4 operator-(float4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+inline float4 min(float4 a, float4 b) { return _mm_min_ps(a.v, b.v); }
+inline float4 max(float4 a, float4 b) { return _mm_max_ps(a.v, b.v); }
+inline float4 sqrt(float4 a) { return _mm_sqrt_ps(a.v); }
+inline float4 abs(float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+/* comparisons return all-ones lanes where true, for use with select() */
+inline float4 operator<(float4 a, float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline float4 operator<=(float4 a, float4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline float4 operator>(float4 a, float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline float4 operator>=(float4 a, float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline float4 operator&(float4 a, float4 b) { return _mm_and_ps(a.v, b.v); }
+inline float4 operator|(float4 a, float4 b) { return _mm_or_ps(a.v, b.v); }
+inline float4 select(float4 mask, float4 a, float4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+inline int movemask(float4 mask) { return _mm_movemask_ps(mask.v); }
+
+/* exact for |x| < 2^31, which covers every texture coordinate we feed it */
+inline float4 floor(float4 a) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)));
+}
+
+/* Cephes-style expf, max. relative error ~2 ulp in the range we use it for */
+inline float4 exp(float4 x) {
+    x = min(max(x, -87.3365f), 88.3762626647949f);
+    float4 fx = floor(x * 1.44269504088896341f + 0.5f);
+    x = x - fx * 0.693359375f;
+    x = x - fx * -2.12194440e-4f;
+    float4 y = 1.9875691500e-4f;
+    y = y * x + 1.3981999507e-3f;
+    y = y * x + 8.3334519073e-3f;
+    y = y * x + 4.1665795894e-2f;
+    y = y * x + 1.6666665459e-1f;
+    y = y * x + 5.0000001201e-1f;
+    y = y * (x * x) + x + 1.0f;
+    __m128i e = _mm_add_epi32(_mm_cvttps_epi32(fx.v), _mm_set1_epi32(0x7f));
+    return y * float4(_mm_castsi128_ps(_mm_slli_epi32(e, 23)));
+}
+
+inline void transpose(float4 &a, float4 &b, float4 &c, float4 &d) {
+    _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v);
+}
+#else
+namespace detail {
+template<typename F>
+inline float4 map(float4 a, float4 b, F f) { return float4(f(a.v[0], b.v[0]), f(a.v[1], b.v[1]), f(a.v[2], b.v[2]), f(a.v[3], b.v[3])); }
+template<typename F>
+inline float4 map(float4 a, F f) { return float4(f(a.v[0]), f(a.v[1]), f(a.v[2]), f(a.v[3])); }
+inline float mask(bool b) { uint32_t bits = b ? ~0u : 0u; float f; std::memcpy(&f, &bits, 4); return f; }
+inline uint32_t bits(float f) { uint32_t u; std::memcpy(&u, &f, 4); return u; }
+inline float fromBits(uint32_t u) { float f; std::memcpy(&f, &u, 4); return f; }
+}
+inline float4 operator+(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x + y; }); }
+inline float4 operator-(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x - y; }); }
+inline float4 operator*(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x * y; }); }
+inline float4 operator/(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x / y; }); }
+inline float4 operator-(float4 a) { return detail::map(a, [](float x) { return -x; }); }
+inline float4 min(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x < y ? x : y; }); }
+inline float4 max(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+inline float4 sqrt(float4 a) { return detail::map(a, [](float x) { return std::sqrt(x); }); }
+inline float4 abs(float4 a) { return detail::map(a, [](float x) { return std::fabs(x); }); }
+inline float4 floor(float4 a) { return detail::map(a, [](float x) { return std::floor(x); }); }
+inline float4 exp(float4 a) { return detail::map(a, [](float x) { return std::exp(x); }); }
+inline float4 operator<(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask(x < y); }); }
+inline float4 operator<=(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask(x <= y); }); }
+inline float4 operator>(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask(x > y); }); }
+inline float4 operator>=(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask(x >= y); }); }
+inline float4 operator&(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::fromBits(detail::bits(x) & detail::bits(y)); }); }
+inline float4 operator|(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::fromBits(detail::bits(x) | detail::bits(y)); }); }
+inline float4 select(float4 mask, float4 a, float4 b) {
+    return float4(detail::bits(mask.v[0]) ? a.v[0] : b.v[0], detail::bits(mask.v[1]) ? a.v[1] : b.v[1],
+                  detail::bits(mask.v[2]) ? a.v[2] : b.v[2], detail::bits(mask.v[3]) ? a.v[3] : b.v[3]);
+}
+inline int movemask(float4 mask) {
+    int m = 0;
+    for(int i = 0; i < 4; i++) {
+        m |= (detail::bits(mask.v[i]) >> 31) << i;
+    }
+    return m;
+}
+inline void transpose(float4 &a, float4 &b, float4 &c, float4 &d) {
+    float4 r0{a.v[0], b.v[0], c.v[0], d.v[0]};
+    float4 r1{a.v[1], b.v[1], c.v[1], d.v[1]};
+    float4 r2{a.v[2], b.v[2], c.v[2], d.v[2]};
+    float4 r3{a.v[3], b.v[3], c.v[3], d.v[3]};
+    a = r0; b = r1; c = r2; d = r3;
+}
+#endif
+
+inline float4 clamp(float4 a, float4 lo, float4 hi) { return min(max(a, lo), hi); }
+inline float4 mix(float4 a, float4 b, float4 t) { return a + (b - a) * t; }
+
+/* three float4 lanes forming four 3D vectors, structure-of-arrays */
+struct vec3x4 {
+    float4 x, y, z;
+};
+
+inline vec3x4 operator+(const vec3x4 &a, const vec3x4 &b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline vec3x4 operator-(const vec3x4 &a, const vec3x4 &b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline vec3x4 operator*(const vec3x4 &a, float4 s) { return { a.x * s, a.y * s, a.z * s }; }
+inline float4 dot(const vec3x4 &a, const vec3x4 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline vec3x4 normalize(const vec3x4 &a) { return a * (float4(1.0f) / sqrt(dot(a, a))); }
+
+}
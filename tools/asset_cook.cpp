@@ -0,0 +1,63 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+
+/*
+ * Cooks every mesh and texture under ../assets ahead of time, so the first run of fog does not pay for parsing,
+ * mip generation and block compression. Does not need a GPU.
+ */
+int main(int argc, const char *argv[])
+{
+    struct Flags {
+        unsigned int changeDir : 1;
+        unsigned int recook : 1;
+    } flags = {};
+
+    for(int argId = 1; argId < argc; argId++) {
+        auto arg = std::string_view{argv[argId]};
+        if(arg == "-c") {
+            flags.changeDir = 1;
+        } else if(arg == "--recook") {
+            flags.recook = 1;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [-c] [--recook]\n";
+            return 1;
+        }
+    }
+
+    if (flags.changeDir && argc >= 0) {
+        std::filesystem::path executable{argv[0]};
+        std::filesystem::current_path(executable.parent_path());
+    }
+
+    typedef std::chrono::high_resolution_clock clock;
+    clock::time_point start = clock::now();
+    size_t failed = 0;
+    for(const auto &entry : std::filesystem::recursive_directory_iterator("../assets")) {
+        std::string path = entry.path().string();
+        if(entry.path().extension() == ".obj") {
+            loadCookedMesh(path, flags.recook);
+            continue;
+        }
+        for(size_t slot = 0; slot < Mesh::TEXTURE_SUFFIXES.size(); ++slot) {
+            for(const char *candidate : { Mesh::TEXTURE_SUFFIXES[slot], Mesh::TEXTURE_FALLBACK_SUFFIXES[slot] }) {
+                std::string_view suffix = candidate ? candidate : "";
+                if(!suffix.empty() && path.size() > suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                    CookedTexture cooked = cookTexture(path, slot == Mesh::NORMAL_MAP_SLOT, flags.recook);
+                    // a texture held in memory was decoded but not cached, which is what this tool is for
+                    if(!cooked || !cooked.data.empty()) {
+                        std::cerr << "Could not cook " << path << "\n";
+                        failed++;
+                    }
+                }
+            }
+        }
+    }
+    std::cout << "Cooked assets in " << std::chrono::duration<double, std::milli>(clock::now() - start).count() << " ms\n";
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "CpuFogEngine.h"
+#include "util.h"
+
+/*
+ * Runs the fog generation and accumulation passes on the CPU for a fixed camera, to check fog output and measure
+ * its cost on machines without a GPU. There is no shadow pass on the CPU, so the volume is computed unshadowed.
+ * With --quality, it instead runs a full-precision and a reduced-precision engine side by side and reports how far
+ * the volumes stored at the reduced precision drift from the full-float ones, frame after frame.
+ * With --interleave, it runs an engine lighting every froxel per frame next to one lighting only a subset, while the
+ * camera pans and the noise drifts, and reports what the subset saves and how far its output lags behind.
+ * With --local-volumes, that many local fog volumes are scattered in front of the camera and binned each frame.
+ * With --point-lights, that many point lights are, and light the fog of the tiles they are binned to.
+ */
+
+// a component counts as visibly off beyond this, like in the fog parity check
+static constexpr float QUALITY_ABS_TOLERANCE = 1e-4f;
+static constexpr float QUALITY_REL_TOLERANCE = 2e-2f;
+
+// boxes and ellipsoids of a few metres, strewn over the first hundred metres in front of the camera
+static std::vector<LocalFogVolume> scatterLocalVolumes(const Camera &camera, uint32_t count)
+{
+    std::vector<LocalFogVolume> volumes;
+    uint32_t state = 1;
+    auto random = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / float(1u << 24);
+    };
+    glm::mat4 invView = glm::inverse(camera.view());
+    for(uint32_t i = 0; i < count; i++) {
+        LocalFogVolume volume;
+        volume.shape = i % 2 ? LocalFogShape::ellipsoid : LocalFogShape::box;
+        float distance = 5.0f + 95.0f * random();
+        glm::vec3 view{ (random() * 2.0f - 1.0f) * distance * 0.8f, (random() * 2.0f - 1.0f) * distance * 0.4f, -distance };
+        volume.position = glm::vec3(invView * glm::vec4(view, 1.0f));
+        volume.halfExtents = glm::vec3(1.0f + 4.0f * random(), 1.0f + 2.0f * random(), 1.0f + 4.0f * random());
+        volume.rotation = glm::vec3(0.0f, random() * 6.2831853f, 0.0f);
+        volume.density = 0.5f + random();
+        volume.noise = random();
+        volumes.push_back(volume);
+    }
+    return volumes;
+}
+
+// small coloured lights reaching 12 to 17 m, strewn like the local volumes but over the whole fog range
+static std::vector<PointLight> scatterPointLights(const Camera &camera, uint32_t count)
+{
+    std::vector<PointLight> lights;
+    uint32_t state = 2;
+    auto random = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / float(1u << 24);
+    };
+    glm::mat4 invView = glm::inverse(camera.view());
+    for(uint32_t i = 0; i < count; i++) {
+        float distance = 5.0f + 295.0f * random();
+        glm::vec3 view{ (random() * 2.0f - 1.0f) * distance * 0.8f, (random() * 2.0f - 1.0f) * distance * 0.4f, -distance };
+        glm::vec3 color = glm::vec3(random(), random(), random()) * 2.0f;
+        lights.push_back({ glm::vec3(invView * glm::vec4(view, 1.0f)), color, glm::vec3(1.0f, 0.7f, 1.8f) });
+    }
+    return lights;
+}
+
+// what a binning put where, and what it cost
+static void reportTiles(const char *name, size_t count, const char *what, const FroxelTileLists &lists)
+{
+    size_t occupied = 0;
+    for(const auto &tile : lists.tiles()) {
+        occupied += tile[1] > 0;
+    }
+    std::cout << name << ": " << count << " " << what << ", " << lists.references().size() << " references over " << occupied << " of "
+              << FROXEL_TILE_COUNT << " tiles (" << double(lists.references().size()) / std::max<size_t>(occupied, 1) << " per occupied tile), "
+              << lists.droppedReferences() << " dropped, binned in " << lists.binMillis() << " ms\n";
+}
+
+static int runQuality(const CpuFogEngine::Inputs &baseInputs, const NoiseVolume &noise, FogPrecision precision, uint32_t frameCount)
+{
+    std::array<uint32_t, 3> resolution = baseInputs.resolution;
+    CpuFogEngine reference{ resolution, noise };
+    CpuFogEngine reduced{ resolution, noise };
+    reduced.setPrecision(precision);
+
+    // two lighting volumes for the history and the scattering volume
+    for(FogPrecision p : { FogPrecision::full, precision }) {
+        size_t bytes = 3 * (fogVolumeBytes(resolution, p) + (p == FogPrecision::packed ? fogAlphaVolumeBytes(resolution) : 0));
+        std::cout << "Volumes at " << fogPrecisionName(p) << " precision: " << bytes / (1024.0 * 1024.0) << " MiB\n";
+    }
+    std::cout << "Reduction: " << float(fogPrecisionBytes(FogPrecision::full)) / fogPrecisionBytes(precision) << "x\n";
+
+    CpuFogEngine::Inputs inputs = baseInputs;
+    bool passed = true;
+    for(uint32_t frame = 0; frame < frameCount; frame++) {
+        inputs.frameNumber = static_cast<int>(frame);
+        // like FogVolumeGenerationPass::update(), the first frame has no history
+        inputs.historyFactor = frame == 0 ? 0.0f : baseInputs.historyFactor;
+        for(CpuFogEngine *engine : { &reference, &reduced }) {
+            engine->generate(inputs, glm::mat4(1.0f));
+            engine->accumulate();
+        }
+        FogParityReport lighting = compareFogVolumes(reference.lightingVolume().data(), reduced.lightingVolume().data(), reference.lightingVolume().size(), QUALITY_ABS_TOLERANCE, QUALITY_REL_TOLERANCE);
+        FogParityReport scattering = compareFogVolumes(reference.scatteringVolume().data(), reduced.scatteringVolume().data(), reference.scatteringVolume().size(), QUALITY_ABS_TOLERANCE, QUALITY_REL_TOLERANCE);
+        std::cout << "Frame " << frame << ": lighting volume   " << lighting << "\n";
+        std::cout << "Frame " << frame << ": scattering volume " << scattering << "\n";
+        passed = passed && lighting.passed() && scattering.passed();
+    }
+    return passed ? 0 : 1;
+}
+
+// the camera turns by this per frame in the interleave report, so froxels are reprojected rather than kept in place
+static constexpr float INTERLEAVE_PAN = 0.005f;
+
+static int runInterleave(const CpuFogEngine::Inputs &baseInputs, const NoiseVolume &noise, Camera camera, const FogInterleave &interleave, uint32_t frameCount)
+{
+    std::array<uint32_t, 3> resolution = baseInputs.resolution;
+    CpuFogEngine reference{ resolution, noise };
+    CpuFogEngine interleaved{ resolution, noise };
+
+    typedef std::chrono::high_resolution_clock clock;
+    typedef std::chrono::duration<double, std::milli> duration;
+    CpuFogEngine::Inputs inputs = baseInputs;
+    glm::mat4 prevFrameVP = camera.projection() * camera.view();
+    double totalReference = 0.0, totalInterleaved = 0.0, totalRms = 0.0;
+    float maxRms = 0.0f;
+    // the first frame from which on the interleaved volume stayed within tolerance of the reference
+    std::optional<uint32_t> settled;
+    for(uint32_t frame = 0; frame < frameCount; frame++) {
+        camera.setPose(camera.getPosition(), camera.getPitch(), camera.getYaw() + (frame == 0 ? 0.0f : INTERLEAVE_PAN), camera.getRoll());
+        setFogCameraInputs(inputs, camera);
+        inputs.prevFrameVP = prevFrameVP;
+        prevFrameVP = camera.projection() * camera.view();
+        inputs.frameNumber = static_cast<int>(frame);
+        // like FogVolumeGenerationPass::update() at 60 frames per second
+        inputs.time = static_cast<float>(std::fmod(-(frame / 60.0) / 60.0, 1.0));
+        inputs.historyFactor = frame == 0 ? 0.0f : baseInputs.historyFactor;
+
+        double times[2];
+        for(int i = 0; i < 2; i++) {
+            CpuFogEngine &engine = i == 0 ? reference : interleaved;
+            inputs.interleave = i == 0 ? 1 : interleave.ways;
+            inputs.interleaveOrder = static_cast<uint32_t>(interleave.order);
+            clock::time_point start = clock::now();
+            engine.generate(inputs, glm::mat4(1.0f));
+            times[i] = duration(clock::now() - start).count();
+            engine.accumulate();
+        }
+        totalReference += times[0];
+        totalInterleaved += times[1];
+        FogParityReport scattering = compareFogVolumes(reference.scatteringVolume().data(), interleaved.scatteringVolume().data(), reference.scatteringVolume().size(), QUALITY_ABS_TOLERANCE, QUALITY_REL_TOLERANCE);
+        totalRms += scattering.rmsError;
+        maxRms = std::max(maxRms, scattering.rmsError);
+        if(!scattering.passed()) {
+            settled.reset();
+        } else if(!settled) {
+            settled = frame;
+        }
+        std::cout << "Frame " << frame << ": generation " << times[0] << " ms, interleaved " << times[1] << " ms, scattering volume " << scattering << "\n";
+    }
+    if(frameCount == 0) {
+        return 0;
+    }
+    std::cout << "Interleave: " << interleave.ways << " ways, " << fogInterleaveOrderName(interleave.order) << "\n";
+    std::cout << "Cost: generation " << totalReference / frameCount << " ms, interleaved " << totalInterleaved / frameCount << " ms ("
+              << totalReference / totalInterleaved << "x faster)\n";
+    // a froxel keeps historyFactor of its value per update, so it takes 1 / (1 - historyFactor) updates to follow a change
+    float updates = 1.0f / (1.0f - baseInputs.historyFactor);
+    std::cout << "Convergence: " << updates << " frames, interleaved " << updates * interleave.ways << " frames\n";
+    std::cout << "Quality: mean rms error " << totalRms / frameCount << ", max " << maxRms << ", ";
+    if(settled) {
+        std::cout << "within tolerance from frame " << *settled << "\n";
+    } else {
+        std::cout << "not within tolerance at the end\n";
+    }
+    return 0;
+}
+
+int main(int argc, const char *argv[])
+{
+    struct Flags {
+        unsigned int changeDir : 1;
+        unsigned int noNoise : 1;
+    } flags = {};
+    std::optional<FogPrecision> quality;
+    FogInterleave interleave;
+    std::array<uint32_t, 3> resolution = { 512, 256, 256 };
+    uint32_t frameCount = 4;
+    uint32_t localVolumes = 0;
+    uint32_t pointLights = 0;
+
+    auto usage = [argc, argv]() {
+        std::cerr << "Usage: " << (argc > 0 ? argv[0] : "./fog_cpu") << " [-c] [-r <width>x<height>x<depth>] [-n <frames>] [--no-noise] [--quality <full|half|packed>] [--interleave <ways> [--interleave-order <checkerboard|slices>]] [--local-volumes <count>] [--point-lights <count>]\n";
+        exit(1);
+    };
+
+    for(int argId = 1; argId < argc; argId++) {
+        auto arg = std::string_view{argv[argId]};
+        if(arg == "-c") {
+            flags.changeDir = 1;
+        } else if(arg == "--no-noise") {
+            flags.noNoise = 1;
+        } else if(arg == "-r" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%ux%ux%u", &resolution[0], &resolution[1], &resolution[2]) != 3) {
+                usage();
+            }
+        } else if(arg == "--quality" && argId + 1 < argc) {
+            FogPrecision precision;
+            if(!parseFogPrecision(argv[++argId], precision)) {
+                usage();
+            }
+            quality = precision;
+        } else if(arg == "--interleave" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &interleave.ways) != 1 || interleave.ways == 0) {
+                usage();
+            }
+        } else if(arg == "--interleave-order" && argId + 1 < argc) {
+            if(!parseFogInterleaveOrder(argv[++argId], interleave.order)) {
+                usage();
+            }
+        } else if(arg == "--local-volumes" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &localVolumes) != 1) {
+                usage();
+            }
+        } else if(arg == "--point-lights" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &pointLights) != 1) {
+                usage();
+            }
+        } else if(arg == "-n" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &frameCount) != 1) {
+                usage();
+            }
+        } else {
+            usage();
+        }
+    }
+
+    if (flags.changeDir && argc >= 0) {
+        std::filesystem::path executable{argv[0]};
+        std::filesystem::current_path(executable.parent_path());
+    }
+
+    // the same cached volume the GPU samples
+    NoiseVolume noise = loadNoiseVolume("../assets/textures", NoiseParams{});
+
+    // same starting camera and fog settings as the Citadel demo
+    Camera camera{ glm::vec3(0.0f, 10.0f, 10.0f), 0.0f, 0.0f, 0.0f };
+    camera.setViewport({ 1920, 1080 });
+    CpuFogEngine::Inputs inputs{};
+    setFogCameraInputs(inputs, camera);
+    inputs.resolution = resolution;
+    inputs.prevFrameVP = camera.projection() * camera.view();
+    inputs.dirLight = { glm::normalize(glm::vec3(1.0, -1.0, 0.0)), glm::vec3(1.0, 0.7, 0.2) };
+    inputs.time = 0.0f;
+    inputs.historyFactor = 0.9f;
+    inputs.density = 1.0f;
+    inputs.constantDensity = 0.175f;
+    inputs.anisotropy = -0.3f;
+    inputs.absorptionFactor = 0.3f;
+    inputs.height = 0.05f;
+    inputs.noise = !flags.noNoise;
+    inputs.skyBlendRatio = 1.0f;
+    inputs.fogRange = FogGrid{}.range;
+    inputs.depthPackExponent = FogGrid{}.depthExponent;
+    inputs.interleave = 1;
+
+    if(quality) {
+        return runQuality(inputs, noise, *quality, frameCount);
+    }
+    if(interleave.ways > 1) {
+        return runInterleave(inputs, noise, camera, interleave, frameCount);
+    }
+
+    CpuFogEngine engine{ resolution, noise };
+    LocalFogBins localFog;
+    if(localVolumes > 0) {
+        localFog.setVolumes(scatterLocalVolumes(camera, localVolumes));
+        engine.setLocalFog(&localFog);
+    }
+    LightClusters lights;
+    if(pointLights > 0) {
+        lights.setLights(scatterPointLights(camera, pointLights));
+        engine.setLights(&lights);
+    }
+
+    typedef std::chrono::high_resolution_clock clock;
+    typedef std::chrono::duration<double, std::milli> duration;
+    double froxels = double(resolution[0]) * resolution[1] * resolution[2];
+    double totalGeneration = 0.0, totalAccumulation = 0.0;
+    for(uint32_t frame = 0; frame < frameCount; frame++) {
+        inputs.frameNumber = static_cast<int>(frame);
+        if(localVolumes > 0) {
+            localFog.bin(fogFroxelFrustum(inputs));
+        }
+        if(pointLights > 0) {
+            lights.bin(fogFroxelFrustum(inputs));
+        }
+        clock::time_point start = clock::now();
+        engine.generate(inputs, glm::mat4(1.0f));
+        clock::time_point generated = clock::now();
+        engine.accumulate();
+        clock::time_point accumulated = clock::now();
+        double generation = duration(generated - start).count();
+        double accumulation = duration(accumulated - generated).count();
+        totalGeneration += generation;
+        totalAccumulation += accumulation;
+        std::cout << "Frame " << frame << ": generation " << generation << " ms (" << froxels / generation * 1e-6 << " Gfroxel/s), accumulation " << accumulation << " ms\n";
+    }
+    if(localVolumes > 0) {
+        reportTiles("Local fog", localFog.volumes().size(), "volumes", localFog.lists());
+    }
+    if(pointLights > 0) {
+        reportTiles("Point lights", lights.lights().size(), "lights", lights.lists());
+    }
+    if(frameCount > 0) {
+        std::cout << "Average: generation " << totalGeneration / frameCount << " ms, accumulation " << totalAccumulation / frameCount << " ms\n";
+    }
+
+    // summarize the last slice, i.e. what a fragment at the end of the fog range gets
+    const std::vector<glm::vec4> &scattering = engine.scatteringVolume();
+    size_t sliceSize = size_t(resolution[0]) * resolution[1];
+    glm::vec4 mean = glm::vec4(0.0f);
+    for(size_t i = scattering.size() - sliceSize; i < scattering.size(); i++) {
+        mean += scattering[i] / static_cast<float>(sliceSize);
+    }
+    std::cout << "Far slice mean in-scattering: (" << mean.x << ", " << mean.y << ", " << mean.z << "), transmittance: " << mean.w << "\n";
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+#include "NoiseVolume.h"
+
+/*
+ * Bakes the fog's tileable noise volume into the cache under ../assets/textures, where fog and fog_cpu look it up
+ * by its parameters, and reports the bake time, the value distribution and how smoothly it wraps. Does not need a
+ * GPU.
+ */
+int main(int argc, const char *argv[])
+{
+    struct Flags {
+        unsigned int changeDir : 1;
+    } flags = {};
+    NoiseParams params;
+
+    auto usage = [argc, argv]() {
+        std::cerr << "Usage: " << (argc > 0 ? argv[0] : "./noise_bake") << " [-c] [-s <texels>] [-o <octaves>] [-p <period>] [-w <worley weight>] [--seed <n>]\n";
+        exit(1);
+    };
+
+    for(int argId = 1; argId < argc; argId++) {
+        auto arg = std::string_view{argv[argId]};
+        if(arg == "-c") {
+            flags.changeDir = 1;
+        } else if(arg == "-s" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &params.size) != 1 || params.size == 0) {
+                usage();
+            }
+        } else if(arg == "-o" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &params.octaves) != 1 || params.octaves == 0) {
+                usage();
+            }
+        } else if(arg == "-p" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &params.period) != 1 || params.period == 0) {
+                usage();
+            }
+        } else if(arg == "-w" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%f", &params.worley) != 1 || params.worley < 0.0f || params.worley > 1.0f) {
+                usage();
+            }
+        } else if(arg == "--seed" && argId + 1 < argc) {
+            if(std::sscanf(argv[++argId], "%u", &params.seed) != 1) {
+                usage();
+            }
+        } else {
+            usage();
+        }
+    }
+
+    if (flags.changeDir && argc >= 0) {
+        std::filesystem::path executable{argv[0]};
+        std::filesystem::current_path(executable.parent_path());
+    }
+
+    NoiseVolume volume = loadNoiseVolume("../assets/textures", params, true);
+    double texels = double(volume.texels.size());
+    std::cout << "Baked " << params.size << "^3 texels, " << params.octaves << " octaves from period " << params.period << ", Worley weight "
+              << params.worley << " in " << volume.bakeMillis << " ms (" << texels / volume.bakeMillis * 1e-3 << " Mtexel/s)\n";
+    std::cout << "Wrote " << noiseVolumePath("../assets/textures", params) << " (" << texels / 1024.0 << " KiB)\n";
+
+    double sum = 0.0, squares = 0.0;
+    uint8_t low = 255, high = 0;
+    for(uint8_t texel : volume.texels) {
+        sum += texel;
+        squares += double(texel) * texel;
+        low = std::min(low, texel);
+        high = std::max(high, texel);
+    }
+    double mean = sum / texels;
+    std::cout << "Values: mean " << mean / 255.0 << ", deviation " << std::sqrt(std::max(squares / texels - mean * mean, 0.0)) / 255.0
+              << ", range [" << low / 255.0 << ", " << high / 255.0 << "]\n";
+
+    // across the wrap, neighbouring texels should differ no more than anywhere else
+    int32_t size = static_cast<int32_t>(params.size);
+    double seam = 0.0, inside = 0.0;
+    for(int32_t z = 0; z < size; z++) {
+        for(int32_t y = 0; y < size; y++) {
+            seam += std::abs(volume.texel(size - 1, y, z) - volume.texel(size, y, z));
+            inside += std::abs(volume.texel(size / 2 - 1, y, z) - volume.texel(size / 2, y, z));
+        }
+    }
+    std::cout << "Mean step across the wrap " << seam / (size * size) << ", inside " << inside / (size * size) << "\n";
+    return 0;
+}